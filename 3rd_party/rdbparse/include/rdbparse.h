@@ -73,15 +73,19 @@ namespace RdbParser {
 
     using KeyValStr = std::pair<std::string, std::string>;
     typedef std::vector<std::string> EntryStream;
+    typedef std::map<EntryID, EntryStream, EntryCmp> Stream;
+
+    /// add new entry stream built from XADD argv @param data. auto generate the entry id
+    int AddStreamEntry(Stream &stream, const std::vector<std::string> &data, EntryID &entry_id);
 
     struct ParsedResult {
-        ParsedResult() : expire_time(-1) {}
+        ParsedResult() : db_num(0), idle(0), freq(0), expire_time(-1) {}
 
         ParsedResult(const std::string &k, const std::string &v, int64_t expire_ts = -1) :
-                key(k), kv_value(v), expire_time(expire_ts), type("string") {}
+                key(k), kv_value(v), db_num(0), idle(0), freq(0), expire_time(expire_ts), type("string") {}
 
         ParsedResult(const std::string &data_type, int64_t expire_ts = -1) :
-                expire_time(expire_ts), type(data_type) {}
+                db_num(0), idle(0), freq(0), expire_time(expire_ts), type(data_type) {}
 
 
         std::string type;
@@ -131,7 +135,7 @@ namespace RdbParser {
 
         void Debug();
 
-        std::map<EntryID, EntryStream, EntryCmp> stream;
+        Stream stream;
 
         /// add new entry stream. auto generate the 
         int AddStream(const std::vector<std::string> &data, EntryID &entry_id);
@@ -259,6 +259,8 @@ Status RdbParseImpl::LoadEncLzf(std::string *result) {
 }
 void RdbParseImpl::ResetResult() {
   result_->expire_time = -1;
+  result_->idle = 0;
+  result_->freq = 0;
   result_->type.clear();
   result_->key.clear(); 
   result_->kv_value.clear(); 
@@ -590,9 +592,14 @@ Status RdbParseImpl::LoadEntryValue(uint8_t type) {
       s = LoadZsetOrHashZiplist(&(result_->map_value));
       break;
     case kRdbList:
-    case kRdbSet:                
       s = LoadListOrSet(&(result_->list_value));
       break;
+    case kRdbSet: {
+      std::list<std::string> members;
+      s = LoadListOrSet(&members);
+      result_->set_value.insert(members.begin(), members.end());
+      break;
+    }
     case kRdbHash:
       s = LoadHash(&(result_->map_value));
       break;
@@ -814,6 +821,11 @@ static EntryID GetEntryStreamId(const std::string& id, const EntryID &prev_entry
 }
 
 int ParsedResult::AddStream(const std::vector<std::string>& data, EntryID& entry_id)
+{
+  return AddStreamEntry(stream, data, entry_id);
+}
+
+int AddStreamEntry(Stream& stream, const std::vector<std::string>& data, EntryID& entry_id)
 {
   /// validate input
   if (data.empty() || (data.size() % 2 == 0)) {
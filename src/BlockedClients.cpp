@@ -0,0 +1,165 @@
+//
+// Created by Manh Nguyen Viet on 9/25/25.
+//
+
+#include "BlockedClients.h"
+#include "Client.h"
+#include "Database.h"
+#include "RespWriter.h"
+#include "Server.h"
+
+void BlockedClients::Block(const std::shared_ptr<Client> &client, BlockedPop pop) {
+    auto &blocked = blocked_[client.get()];
+    blocked.client = client;
+    blocked.pop = std::move(pop);
+    for (auto &key: blocked.pop.keys) {
+        auto &waiters = waiters_[{blocked.pop.db, key}];
+        blocked.positions.push_back(waiters.insert(waiters.end(), client.get()));
+    }
+
+    if (blocked.pop.deadline == std::chrono::steady_clock::time_point::max()) {
+        blocked.deadline = deadlines_.end();
+    } else {
+        blocked.deadline = deadlines_.emplace(blocked.pop.deadline, client.get());
+    }
+
+    client->SetBlocked(true);
+    ArmTimer();
+}
+
+void BlockedClients::Unblock(const Client *client) {
+    auto it = blocked_.find(client);
+    if (it == blocked_.end())
+        return;
+
+    Release(it, false);
+    ArmTimer();
+}
+
+void BlockedClients::MarkReady(int db, std::string_view key) {
+    DbKey db_key(db, key);
+    if (waiters_.count(db_key))
+        ready_.insert(std::move(db_key));
+}
+
+void BlockedClients::ServeReady() {
+    /// BLMOVE pushes to its destination, which may become ready in turn
+    while (!ready_.empty()) {
+        DbKey key = std::move(ready_.extract(ready_.begin()).value());
+        for (;;) {
+            auto waiters = waiters_.find(key);
+            if (waiters == waiters_.end())
+                break;
+
+            auto it = blocked_.find(waiters->second.front());
+            if (!Serve(it->second, key.second))
+                break;
+            Release(it, true);
+        }
+    }
+
+    ArmTimer();
+}
+
+bool BlockedClients::Serve(Blocked &blocked, const std::string &key) {
+    const BlockedPop &pop = blocked.pop;
+    auto db = Database::GetInstance();
+    int selected_db = Database::SelectedDb();
+    Database::SelectDb(pop.db);
+
+    std::string reply;
+    RespWriter writer(reply);
+    bool served = false;
+    if (pop.cmd_type == BLMoveCmd) {
+        std::string element;
+        int ret = db->ListMove(key, pop.destination, pop.from_head, pop.to_head, element);
+        if (ret < 0) {
+            /// the source or the destination is not a list anymore, the client gets the error rather than waiting on
+            writer.AppendRaw(RESP_WRONGTYPE);
+            served = true;
+        } else if (ret > 0) {
+            writer.AppendBulkStr(element);
+            /// the replicas apply the pop that was actually done
+            Server::GetInstance()->PropagateCommand({"LMOVE", key, pop.destination, pop.from_head ? "LEFT" : "RIGHT",
+                                                     pop.to_head ? "LEFT" : "RIGHT"});
+            db->SignalModifiedKey(key);
+            db->SignalModifiedKey(pop.destination);
+            MarkReady(pop.db, pop.destination);
+            served = true;
+        }
+    } else {
+        bool head = pop.cmd_type == BLPopCmd;
+        std::vector<std::string> elements;
+        if (db->ListPop(key, 1, head, elements) > 0 && !elements.empty()) {
+            writer.AppendArrayHeader(2).AppendBulkStr(key).AppendBulkStr(elements[0]);
+            Server::GetInstance()->PropagateCommand({head ? "LPOP" : "RPOP", key});
+            db->SignalModifiedKey(key);
+            served = true;
+        }
+    }
+
+    Database::SelectDb(selected_db);
+    if (served)
+        blocked.client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    return served;
+}
+
+void BlockedClients::Release(BlockedMap::iterator it, bool resume) {
+    Blocked &blocked = it->second;
+    for (size_t i = 0; i < blocked.positions.size(); ++i) {
+        auto waiters = waiters_.find({blocked.pop.db, blocked.pop.keys[i]});
+        waiters->second.erase(blocked.positions[i]);
+        if (waiters->second.empty())
+            waiters_.erase(waiters);
+    }
+    if (blocked.deadline != deadlines_.end())
+        deadlines_.erase(blocked.deadline);
+
+    std::shared_ptr<Client> client = std::move(blocked.client);
+    blocked_.erase(it);
+    client->SetBlocked(false);
+    if (!resume)
+        return;
+
+    /// not from within the command that served it
+    std::weak_ptr<Client> weak_client = client;
+    asio::post(client->Socket().get_executor(), [weak_client]() {
+        if (auto client = weak_client.lock())
+            client->ProcessPendingCommands();
+    });
+}
+
+void BlockedClients::ArmTimer() {
+    if (deadlines_.empty()) {
+        if (armed_ != std::chrono::steady_clock::time_point::max()) {
+            timer_.cancel();
+            armed_ = std::chrono::steady_clock::time_point::max();
+        }
+        return;
+    }
+
+    auto earliest = deadlines_.begin()->first;
+    if (earliest == armed_)
+        return;
+
+    /// re-arming cancels the wait for the previous deadline
+    armed_ = earliest;
+    timer_.expires_at(earliest);
+    timer_.async_wait([this](const std::error_code &ec) {
+        if (!ec)
+            HandleTimeouts();
+    });
+}
+
+void BlockedClients::HandleTimeouts() {
+    armed_ = std::chrono::steady_clock::time_point::max();
+    auto now = std::chrono::steady_clock::now();
+    while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+        auto it = blocked_.find(deadlines_.begin()->second);
+        it->second.client->WriteAsync(it->second.pop.cmd_type == BLMoveCmd ? RESP_NIL : RESP_NIL_ARRAY,
+                                      APP_RECV | MASTER_SEND);
+        Release(it, true);
+    }
+
+    ArmTimer();
+}
@@ -0,0 +1,112 @@
+//
+// Created by Manh Nguyen Viet on 9/25/25.
+//
+
+#ifndef REDIS_CRAFT_BLOCKEDCLIENTS_H
+#define REDIS_CRAFT_BLOCKEDCLIENTS_H
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Utils.h"
+#include "asio.hpp"
+
+class Client;
+
+/// what a client blocked by BLPOP, BRPOP or BLMOVE does once one of its keys holds a list
+typedef struct BlockedPop {
+    CommandType cmd_type;                   /// BLPopCmd, BRPopCmd or BLMoveCmd
+    std::vector<std::string> keys;          /// the lists, tried in this order
+    std::string destination;                /// BLMOVE only
+    bool from_head = true;                  /// BLMOVE: LEFT or RIGHT of the source
+    bool to_head = true;                    /// BLMOVE: LEFT or RIGHT of the destination
+    int db = 0;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();  /// max: none
+} BlockedPop;
+
+/*
+ * The clients blocked on lists by BLPOP, BRPOP and BLMOVE.
+ *
+ * Every key waited on has the list of its waiters, in the order they blocked. A write command marks its keys with
+ * SignalKeyReady(), and ServeReadyKeys() runs right after it: the first waiters of the ready keys pop the elements
+ * as long as there are some, their replies are written on the spot and they go on with their next commands. A worker
+ * waiting on a queue gets an element as soon as it is pushed, and costs nothing while the queue is empty.
+ *
+ * The deadlines of all the blocked clients are kept in order under a single timer, armed for the earliest one.
+ *
+ * Only used from the event loop, not thread safe.
+ * */
+class BlockedClients {
+public:
+    explicit BlockedClients(asio::io_context &io_ctx) : timer_(io_ctx) {}
+
+    BlockedClients(const BlockedClients &) = delete;
+
+    BlockedClients &operator=(const BlockedClients &) = delete;
+
+    /// block @param client on the keys of @param pop until one of them can be served, or until its deadline
+    void Block(const std::shared_ptr<Client> &client, BlockedPop pop);
+
+    /// forget @param client without replying, when it disconnects
+    void Unblock(const Client *client);
+
+    /// @param key of @param db was written, its waiters are served by the next ServeReadyKeys()
+    void SignalKeyReady(int db, std::string_view key) {
+        if (!waiters_.empty())
+            MarkReady(db, key);
+    }
+
+    /// serve the waiters of the keys signaled since the last call, oldest first, while their lists have elements
+    void ServeReadyKeys() {
+        if (!ready_.empty())
+            ServeReady();
+    }
+
+private:
+    typedef std::pair<int, std::string> DbKey;
+    typedef std::list<Client *> Waiters;
+    typedef std::multimap<std::chrono::steady_clock::time_point, Client *> Deadlines;
+
+    typedef struct Blocked {
+        std::shared_ptr<Client> client;
+        BlockedPop pop;
+        std::vector<Waiters::iterator> positions;   /// its node in the waiters of every key of pop
+        Deadlines::iterator deadline;               /// deadlines_.end() when it waits forever
+    } Blocked;
+
+    using BlockedMap = std::unordered_map<const Client *, Blocked>;
+
+    void MarkReady(int db, std::string_view key);
+
+    void ServeReady();
+
+    /// pop for @param blocked from @param key and reply. Return false when there was nothing to pop, the client
+    /// then keeps waiting
+    bool Serve(Blocked &blocked, const std::string &key);
+
+    /// remove @param it from the waiters and the deadlines. With @param resume, the client goes on with the
+    /// commands it sent meanwhile
+    void Release(BlockedMap::iterator it, bool resume);
+
+    /// arm the timer for the earliest deadline
+    void ArmTimer();
+
+    /// reply nil to the clients past their deadline
+    void HandleTimeouts();
+
+    BlockedMap blocked_;
+    std::map<DbKey, Waiters> waiters_;
+    std::set<DbKey> ready_;
+    Deadlines deadlines_;
+    asio::steady_timer timer_;
+    std::chrono::steady_clock::time_point armed_ = std::chrono::steady_clock::time_point::max();
+};
+
+#endif //REDIS_CRAFT_BLOCKEDCLIENTS_H
@@ -23,15 +23,18 @@ void Client::ReadAsync() {
                               } else if (error == asio::error::eof) {
                                   /// FIXME: handle this case
                                   LOG_ERROR(TAG, "Peer was closed, socket %d", sock_.native_handle());
+                                  /// nothing is popped for a client that is gone
+                                  Server::GetInstance()->GetBlockedClients().Unblock(this);
                               } else {
                                   LOG_ERROR(TAG, "error receive data %s on sock %d", error.message().c_str(),
                                             sock_.native_handle());
+                                  Server::GetInstance()->GetBlockedClients().Unblock(this);
                                   /// FIXME: handle other error
                               }
                           });
 }
 
-void Client::WriteAsync(const std::string &reply, int flags) {
+void Client::WriteAsync(std::string reply, int flags) {
     // LOG_INFO("Client", "write reply %s, sock %d, write_flags %d, flags %d", reply.c_str(),
     //          sock_.native_handle(), write_flags_, flags);
 
@@ -45,13 +48,40 @@ void Client::WriteAsync(const std::string &reply, int flags) {
     }
 
     LOG_INFO("Client", "write reply %s, sock %d, client type %d", reply.c_str(), sock_.native_handle(), client_type_);
-    sock_.async_write_some(asio::buffer(reply), [reply](const std::error_code &error, const size_t byte_transferred) {
-        if (!error) {
-            LOG_INFO("WriteAsync", "complete write %s, transferred %zu bytes socket", reply.c_str(), byte_transferred);
-        } else {
-            LOG_ERROR(TAG, "Send reply %s fail %d: %s", reply.c_str(), error.value(), error.message().c_str());
-        }
-    });
+    /// take over the encoded reply without copying when nothing is pending
+    if (reply_buf_.empty()) {
+        reply_buf_ = std::move(reply);
+    } else {
+        reply_buf_.append(reply);
+    }
+
+    if (!writing_ && !batching_) {
+        FlushReplyBuffer();
+    }
+}
+
+void Client::FlushReplyBuffer() {
+    if (reply_buf_.empty()) {
+        writing_ = false;
+        return;
+    }
+
+    writing_ = true;
+    reply_inflight_.clear();
+    std::swap(reply_inflight_, reply_buf_);
+
+    auto self(shared_from_this());
+    asio::async_write(sock_, asio::buffer(reply_inflight_),
+                      [this, self](const std::error_code &error, const size_t byte_transferred) {
+                          if (!error) {
+                              LOG_DEBUG("WriteAsync", "complete write %zu bytes to sock %d", byte_transferred,
+                                        sock_.native_handle());
+                              FlushReplyBuffer();
+                          } else {
+                              LOG_ERROR(TAG, "Send reply fail %d: %s", error.value(), error.message().c_str());
+                              writing_ = false;
+                          }
+                      });
 }
 
 void Client::ReadBulkAsyncWriteFile(const size_t total_size, size_t current_read, FILE *pfile) {
@@ -53,7 +53,8 @@ public:
 
     void ReadAsync();
 
-    void WriteAsync(const std::string &reply, int flags = 0);
+    /// append @param reply to the output buffer of this client, start sending if no write is in flight
+    void WriteAsync(std::string reply, int flags = 0);
 
     /// read data from tcp::socket and write to stream @param pfile .
     /// @param total_size: maximum size need to read from
@@ -77,6 +78,44 @@ public:
 
     void SetSlaveState(const int state) { slave_state_ = state; }
 
+    /// the logical database selected by SELECT
+    int Db() const { return db_; }
+
+    void SetDb(int db) { db_ = db; }
+
+    /// bytes of the output buffer, the reply being sent included
+    size_t OutputBufferSize() const { return reply_buf_.capacity() + reply_inflight_.capacity(); }
+
+    size_t QueryBufferSize() const { return executor_.QueryBufferSize(); }
+
+    /// execute the commands that waited for spilled values
+    void ResumeCommands() { executor_.Resume(shared_from_this()); }
+
+    /// the transaction started by MULTI
+    MultiState &Multi() { return executor_.Multi(); }
+
+    void ExecTransaction() { executor_.ExecTransaction(shared_from_this()); }
+
+    /// blocked by BLPOP, BRPOP or BLMOVE, see BlockedClients. Its next commands wait until it is served
+    bool Blocked() const { return blocked_; }
+
+    void SetBlocked(bool blocked) { blocked_ = blocked; }
+
+    /// a blocking command of a transaction or of the master replies at once instead of blocking
+    bool DenyBlocking() const { return client_type_ == TypeMaster || executor_.InTransaction(); }
+
+    /// execute the commands received while the client was blocked
+    void ProcessPendingCommands() { executor_.ReceiveDataAndExecute("", shared_from_this()); }
+
+    /// hold the replies in the output buffer until EndReplyBatch(), so they leave in one write
+    void BeginReplyBatch() { batching_ = true; }
+
+    void EndReplyBatch() {
+        batching_ = false;
+        if (!writing_)
+            FlushReplyBuffer();
+    }
+
     void PropagateRdb(const std::string &rdb_path);
 
     /// only used when client is a replica server
@@ -160,6 +199,9 @@ private:
 
     void CloseFile();
 
+    /// send all pending data in reply_buf_, chain the next write when it completes
+    void FlushReplyBuffer();
+
 private:
     asio::io_context &io_context_;
     tcp::socket sock_;
@@ -182,6 +224,12 @@ private:
     int fd_;
 
     std::array<char, BULK_SIZE> out_buf_;
+
+    /// output buffer: replies are appended to reply_buf_ and swapped to reply_inflight_ while being sent
+    std::string reply_buf_;
+    std::string reply_inflight_;
+    bool writing_ = false;
+    bool batching_ = false;     /// see BeginReplyBatch()
     std::vector<char> bulk_;
 
     CommandExecutor executor_; /// the executor for this client
@@ -198,6 +246,10 @@ private:
 
     uint num_good_replicas_, min_good_replicas_;
 
+    int db_ = 0;
+
+    bool blocked_ = false;
+
 };
 
 
@@ -3,111 +3,325 @@
 //
 
 #include "CommandExecutor.h"
+#include "HotKeys.h"
 #include "RedisError.h"
 #include "Server.h"
 
 int CommandExecutor::ReceiveDataAndExecute(const std::string &buffer, std::shared_ptr<Client> client) {
     /// append new data to the last. Useful in case that remain data in the previous request
-    data_ = data_ + buffer;
+    data_.append(buffer);
     LOG_DEBUG(TAG, "Received buffer %s, new data %s", buffer.c_str(), data_.c_str());
 
+    /// keep the order of the commands, Resume() or the end of the blocking command executes them
+    if (waiting_values_ || client->Blocked())
+        return 0;
+
+    /// 1. decode all complete commands of this read
+    batch_.clear();
+    batch_ends_.clear();
+    int ret = 0;
     size_t offset = 0;
     while (offset < data_.size()) {
-        /// FIXME: avoid to call strdup() this char array
-        const char *remain_buf = strdup(data_.substr(offset).c_str());
         size_t remain_len = data_.size() - offset;
-        resp::result res = decoder_.decode(remain_buf, remain_len);
+        resp::result res = decoder_.decode(data_.data() + offset, remain_len);
         if (res == resp::incompleted) {
-            LOG_DEBUG(TAG, "Incompleted RESP with remainder buf %s", remain_buf);
-            data_ = data_.substr(offset);
-            return IncompletedCommand;
+            LOG_DEBUG(TAG, "Incompleted RESP with remainder %zu bytes", remain_len);
+            /// the remainder is decoded again from its beginning when more data comes, drop the partial state
+            decoder_ = resp::decoder();
+            ret = IncompletedCommand;
+            break;
         } else if (res == resp::error) {
-            LOG_ERROR(TAG, "Invalid RESP with remainder buf %s", remain_buf);
-            return Error::InvalidCommandError;
+            LOG_ERROR(TAG, "Invalid RESP with remainder %zu bytes", remain_len);
+            decoder_ = resp::decoder();
+            ret = InvalidCommandError;
+            break;
         }
 
-        delete remain_buf;
-
-        /// build the command
-        ResetQuery(query_);
-
+        Query query;
         resp::unique_value rep = res.value();
-        /// create query and executor of this command
-        int ret = BuildRedisCommand(rep);
-        if (ret < 0) {
-            LOG_ERROR(TAG, "NOT found the suitable cmd, err %d", ret);
+        /// create query of this command
+        int build_ret = BuildRedisCommand(rep, query);
+        if (build_ret < 0) {
+            LOG_ERROR(TAG, "NOT found the suitable cmd, err %d", build_ret);
 #if HARDCODE
-            query_.cmd = new RedisCmd(UnknownCmd, READ_CMD | APP_RECV);
+            static RedisCmd unknown_cmd(UnknownCmd, READ_CMD | APP_RECV);
+            query.cmd = &unknown_cmd;
 #else // HARDCODE
-            return ret;
+            ret = build_ret;
+            break;
 #endif // HARDCODE
         } else {
-            LOG_INFO(TAG, "build cmd %d success flag %llu", query_.cmd->cmd_type, query_.cmd->flags);
+            LOG_INFO(TAG, "build cmd %d success flag %llu", query.cmd->cmd_type, query.cmd->flags);
         }
 
         if (client->ClientType() == ClientType::TypeMaster) {
             /// this command was propagated from its master, so it is replicated command
-            query_.flags |= REPL_CMD;
-        }
-
-        ret = BuildExecutor();
-        if (ret < 0) {
-            LOG_ERROR(TAG, "Build executor fail, error %d", ret);
-            data_ = data_.substr(offset);
-            return ret;
+            query.flags |= REPL_CMD;
         }
 
-        /// execute the current command, fill the response to the output buffer of client
-        internal_executor_->execute(query_, client);
+        batch_.push_back(std::move(query));
         /// increase the offset in the next decoding
         offset += res.size();
-        LOG_DEBUG("Executor", "remain data %s", data_.c_str());
+        batch_ends_.push_back(offset);
+    }
+
+    /// 2. overlap the memory latency of all lookups in the batch
+    if (batch_.size() > 1) {
+        Database::SelectDb(client->Db());
+        PrefetchBatch();
+    }
 
-        /// propagate this command to the slaves if need to propagate this command
-        int need_propagate = ((query_.flags & WRITE_CMD) | (query_.flags & REPL_CMD)) ? 1 : 0;
+    /// 3. execute the batch in order
+    size_t executed = 0;
+    for (auto &query: batch_) {
+        int exec_ret = ExecuteQuery(query, client);
+        if (exec_ret == WaitingSpilledValues)
+            break;
+        if (exec_ret < 0) {
+            ret = exec_ret;
+            break;
+        }
+        ++executed;
+        /// the commands after a blocking one wait until it is served
+        if (client->Blocked())
+            break;
+    }
 
-        /// first, encode the command to a list of RESP string
-        std::vector<std::string> resp_arr = encoder_.encode_arr(query_.cmd_args);
+    if (executed < batch_.size()) {
+        /// keep the commands that could not be executed, they are decoded again in the next read
+        offset = (executed > 0) ? batch_ends_[executed - 1] : 0;
+    }
+
+    data_.erase(0, offset);
+    LOG_DEBUG("Executor", "remain data %s", data_.c_str());
+
+    return (ret == IncompletedCommand) ? ret : ((ret < 0) ? ret : 0);
+}
+
+void CommandExecutor::PrefetchBatch() {
+    batch_keys_.clear();
+    for (auto &query: batch_) {
+        GetQueryKeys(query, batch_keys_);
+    }
+
+    if (!batch_keys_.empty()) {
+        Database::GetInstance()->PrefetchKeys(batch_keys_);
+    }
+}
 
-        /// second, concat all argv to get the entire resp_data
-        std::string resp_data;
-        for (auto &argv: resp_arr) {
-            resp_data += argv;
+int CommandExecutor::ExecuteQuery(Query &query, const std::shared_ptr<Client> &client) {
+    /// between MULTI and EXEC the commands are only queued, EXEC runs them
+    if (multi_.active && !(query.flags & MULTI_CMD)) {
+        QueueCommand(query, client);
+        return 0;
+    }
+
+    int ret = BuildExecutor(query);
+    if (ret < 0) {
+        LOG_ERROR(TAG, "Build executor fail, error %d", ret);
+        return ret;
+    }
+
+    /// every command of this thread applies to the database the client selected
+    Database::SelectDb(client->Db());
+
+    /// a command on spilled values waits for the disk in the background, the event loop goes on
+    if (!values_loaded_ && WaitSpilledValues(query, client))
+        return WaitingSpilledValues;
+    values_loaded_ = false;
+
+    /// make room first, refuse a command that may grow the dataset when nothing can be evicted.
+    /// The commands of the master are always applied
+    if (client->ClientType() != TypeMaster && Database::GetInstance()->PerformEvictions() == OutOfMemoryError &&
+        (query.flags & DENYOOM_CMD)) {
+        /// the command is answered, the batch goes on
+        client->WriteAsync(RESP_OOM, APP_RECV | MASTER_SEND);
+        return 0;
+    }
+
+    /// execute the current command, fill the response to the output buffer of client
+    internal_executor_->execute(query, client);
+    if (query.flags & WRITE_CMD)
+        SignalModifiedKeys(query);
+    RecordKeyAccesses(query);
+
+    Propagate(query, client);
+
+    /// after the write is propagated, so the replicas get the pops of the blocked clients it served after it
+    Server::GetInstance()->GetBlockedClients().ServeReadyKeys();
+    return 0;
+}
+
+bool CommandExecutor::WaitSpilledValues(const Query &query, const std::shared_ptr<Client> &client) {
+    query_keys_.clear();
+    GetQueryKeys(query, query_keys_);
+    /// EXEC brings in the values of the whole transaction, it must not stop half way
+    if (query.cmd->cmd_type == ExecCmd && multi_.active) {
+        for (auto &queued: multi_.queue) {
+            GetQueryKeys(queued, query_keys_);
         }
+    }
+    if (query_keys_.empty())
+        return false;
 
-        /// update offset
-        if (need_propagate || client->ClientType() == TypeMaster)
-            Server::GetInstance()->AddBackLogBuffer(resp_data);
-
-        /// move next loop if this cmd no need to propagate
-        if (!need_propagate)
-            continue;
-
-        /// FIXME: handle case replica server received the command from its master
-        if (client->ClientType() == TypeMaster)
-            continue;
-
-        /// third, loop and fill entire resp_data to output buffer of slaves
-        auto clients = Server::GetInstance()->GetClients();
-        LOG_DEBUG(TAG, "There are %lu clients of this server", clients.size());
-        for (const auto &cli: clients) {
-            if (cli->ClientType() == ClientType::TypeSlave) {
-                /// FIXME: handle case copy the resp_data to output buffer fail
-                LOG_DEBUG(TAG, "Propagate command %s through sock %d", resp_data.c_str(),
-                          cli->Socket().native_handle());
-                cli->WriteAsync(resp_data, MASTER_SEND | SLAVE_RECV);
-            }
+    std::weak_ptr<Client> weak_client = client;
+    auto loop = client->Socket().get_executor();
+    waiting_values_ = Database::GetInstance()->LoadSpilledKeys(query_keys_, [weak_client, loop]() {
+        asio::post(loop, [weak_client]() {
+            if (auto client = weak_client.lock())
+                client->ResumeCommands();
+        });
+    });
+    return waiting_values_;
+}
+
+void CommandExecutor::Resume(const std::shared_ptr<Client> &client) {
+    waiting_values_ = false;
+    /// if they were spilled again meanwhile, the command reads them on the event loop rather than waiting forever
+    values_loaded_ = true;
+    ReceiveDataAndExecute("", client);
+}
+
+void CommandExecutor::QueueCommand(Query &query, const std::shared_ptr<Client> &client) {
+    if (!query.cmd || query.cmd->cmd_type == UnknownCmd) {
+        multi_.failed = true;
+        client->WriteAsync(RESP_UNKNOWN_COMMAND, APP_RECV | MASTER_SEND);
+        return;
+    }
+
+    multi_.queue.push_back(std::move(query));
+    client->WriteAsync(RESP_QUEUED, APP_RECV | MASTER_SEND);
+}
+
+bool CommandExecutor::WatchedKeysChanged(const std::vector<WatchedKey> &watched_keys) {
+    auto db = Database::GetInstance();
+    return std::any_of(watched_keys.begin(), watched_keys.end(), [db](const WatchedKey &watched) {
+        return db->KeyVersion(watched.db, watched.key) != watched.version;
+    });
+}
+
+void CommandExecutor::ExecTransaction(const std::shared_ptr<Client> &client) {
+    if (!multi_.active) {
+        client->WriteAsync(RESP_EXEC_WITHOUT_MULTI, APP_RECV | MASTER_SEND);
+        return;
+    }
+
+    MultiState multi = std::move(multi_);
+    multi_.Reset();
+    if (multi.failed) {
+        client->WriteAsync(RESP_EXECABORT, APP_RECV | MASTER_SEND);
+        return;
+    }
+
+    /// a replica applies what its master already committed
+    bool from_master = client->ClientType() == TypeMaster;
+    if (!from_master && WatchedKeysChanged(multi.watched)) {
+        client->WriteAsync(RESP_NIL_ARRAY, APP_RECV | MASTER_SEND);
+        return;
+    }
+
+    bool deny_oom = std::any_of(multi.queue.begin(), multi.queue.end(),
+                                [](const Query &queued) { return queued.flags & DENYOOM_CMD; });
+    if (!from_master && Database::GetInstance()->PerformEvictions() == OutOfMemoryError && deny_oom) {
+        client->WriteAsync(RESP_OOM, APP_RECV | MASTER_SEND);
+        return;
+    }
+
+    /// one reply and one MULTI ... EXEC block for the replicas, around the first write
+    client->BeginReplyBatch();
+    std::string header;
+    RespWriter(header).AppendArrayHeader(multi.queue.size());
+    client->WriteAsync(std::move(header), APP_RECV | MASTER_SEND);
+
+    bool propagated_multi = false;
+    in_transaction_ = true;
+    for (auto &queued: multi.queue) {
+        Database::SelectDb(client->Db());
+        if (!propagated_multi && !from_master && (queued.flags & WRITE_CMD)) {
+            Server::GetInstance()->PropagateCommand({"MULTI"});
+            propagated_multi = true;
         }
+
+        /// its own executor, the one of EXEC is still running
+        auto executor = AbstractInternalCommandExecutor::createCommandExecutor(queued.cmd->cmd_type);
+        executor->execute(queued, client);
+        if (queued.flags & WRITE_CMD)
+            SignalModifiedKeys(queued);
+        RecordKeyAccesses(queued);
+        Propagate(queued, client);
     }
 
-    data_ = data_.substr(offset);
+    in_transaction_ = false;
 
-    return 0;
+    if (propagated_multi)
+        Server::GetInstance()->PropagateCommand({"EXEC"});
+    client->EndReplyBatch();
 }
 
-int CommandExecutor::BuildRedisCommand(const resp::unique_value &rep) {
+void CommandExecutor::SignalModifiedKeys(const Query &query) {
+    query_keys_.clear();
+    GetQueryKeys(query, query_keys_);
+    auto &blocked_clients = Server::GetInstance()->GetBlockedClients();
+    for (auto key: query_keys_) {
+        Database::GetInstance()->SignalModifiedKey(key);
+        blocked_clients.SignalKeyReady(Database::SelectedDb(), key);
+    }
+}
+
+void CommandExecutor::RecordKeyAccesses(const Query &query) {
+    auto hot_keys = HotKeys::GetInstance();
+    auto db = Database::GetInstance();
+    if (!hot_keys->Enabled() && !db->KeyspaceStatsEnabled())
+        return;
+
+    query_keys_.clear();
+    GetQueryKeys(query, query_keys_);
+    if (query_keys_.empty())
+        return;
+
+    bool write = query.flags & WRITE_CMD;
+    if (hot_keys->Enabled()) {
+        for (auto key: query_keys_) {
+            hot_keys->Record(key, write);
+        }
+    }
+    if (db->KeyspaceStatsEnabled())
+        db->CountPrefixOps(query_keys_, write);
+}
+
+void CommandExecutor::Propagate(const Query &query, const std::shared_ptr<Client> &client) {
+    /// propagate this command to the slaves if need to propagate this command
+    int need_propagate = ((query.flags & WRITE_CMD) | (query.flags & REPL_CMD)) ? 1 : 0;
+
+    if (!need_propagate && client->ClientType() != TypeMaster)
+        return;
+
+    /// first, encode the command to RESP in a single pass
+    std::string resp_data;
+    RespWriter(resp_data).AppendCommand(query.cmd_args);
+
+    /// the replicas apply it to the same database
+    if (need_propagate && client->ClientType() != TypeMaster)
+        Server::GetInstance()->PropagateSelectDb(Database::SelectedDb());
+
+    /// update offset
+    Server::GetInstance()->AddBackLogBuffer(resp_data);
+
+    /// move next loop if this cmd no need to propagate
+    if (!need_propagate)
+        return;
+
+    /// FIXME: handle case replica server received the command from its master
+    if (client->ClientType() == TypeMaster)
+        return;
+
+    /// second, fill entire resp_data to output buffer of slaves
+    Server::GetInstance()->PropagateToSlaves(resp_data);
+}
+
+int CommandExecutor::BuildRedisCommand(const resp::unique_value &rep, Query &query) {
     /// clean all argv of previous cmd
-    ResetQuery(query_);
+    ResetQuery(query);
 
     resp::unique_array<resp::unique_value> arr = rep.array();
     if (arr.size() < 1) {
@@ -116,12 +330,13 @@ int CommandExecutor::BuildRedisCommand(const resp::unique_value &rep) {
     }
 
     /// fill the cmd argv
+    query.cmd_args.reserve(arr.size());
     for (int i = 0; i < arr.size(); ++i) {
-        query_.cmd_args.emplace_back(arr[i].bulkstr().data(), arr[i].bulkstr().size());
+        query.cmd_args.emplace_back(arr[i].bulkstr().data(), arr[i].bulkstr().size());
     }
 
     /// mapping with the declared cmds, find the cmd type
-    std::string &cmd_name = query_.cmd_args[0];
+    std::string &cmd_name = query.cmd_args[0];
     std::transform(cmd_name.begin(), cmd_name.end(), cmd_name.begin(), ::tolower);
     auto rcmd = Server::GetInstance()->GetRedisCommand(cmd_name);
     if (rcmd == nullptr) {
@@ -132,35 +347,35 @@ int CommandExecutor::BuildRedisCommand(const resp::unique_value &rep) {
     /// update the cmd type
     int has_subcmd = (rcmd->subcmd_dict.empty()) ? 0 : 1;
     if (has_subcmd) {
-        if (query_.cmd_args.size() <= 1) {
+        if (query.cmd_args.size() <= 1) {
             return InvalidCommandError;
         } else {
-            std::string &subcmd = query_.cmd_args[1];
+            std::string &subcmd = query.cmd_args[1];
             std::transform(subcmd.begin(), subcmd.end(), subcmd.begin(), ::tolower);
             auto it = rcmd->subcmd_dict.find(subcmd);
             if (it == rcmd->subcmd_dict.end()) {
                 return InvalidCommandError;
             } else {
-                query_.cmd = it->second;
-                query_.flags = it->second->flags;
+                query.cmd = it->second;
+                query.flags = it->second->flags;
             }
         }
     } else {
-        query_.cmd = rcmd;
-        query_.flags = rcmd->flags;
+        query.cmd = rcmd;
+        query.flags = rcmd->flags;
     }
 
     return 0;
 }
 
-int CommandExecutor::BuildExecutor() {
-    if (!query_.cmd)
+int CommandExecutor::BuildExecutor(const Query &query) {
+    if (!query.cmd)
         return BuildExecutorError;
 
     /// create the executor by cmd_type
-    internal_executor_ = AbstractInternalCommandExecutor::createCommandExecutor(query_.cmd->cmd_type);
+    internal_executor_ = AbstractInternalCommandExecutor::createCommandExecutor(query.cmd->cmd_type);
     if (!internal_executor_)
         return BuildExecutorError;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -10,8 +10,32 @@
 
 #include "all.hpp"
 #include "InternalCommandExecutor.h"
+#include "RespWriter.h"
 #include "Utils.h"
 
+/// a key of WATCH, with the version it had then, see Database::KeyVersion()
+typedef struct WatchedKey {
+    int db;
+    std::string key;
+    uint64_t version;
+} WatchedKey;
+
+/// the transaction of a client, from MULTI to EXEC or DISCARD
+typedef struct MultiState {
+    bool active = false;
+    bool failed = false;            /// a command could not be queued, EXEC discards the transaction
+    std::vector<Query> queue;
+    std::vector<WatchedKey> watched;
+
+    /// forget the transaction and the watched keys
+    void Reset() {
+        active = false;
+        failed = false;
+        queue.clear();
+        watched.clear();
+    }
+} MultiState;
+
 /*
  * Receive the command, execute and return the response
  * */
@@ -24,21 +48,71 @@ public:
     ~CommandExecutor() = default;
 
     /// append available data to buffer.
-    /// One by one, try to decode a command from buffer, execute it utils could not decode new command
+    /// Decode every complete command in the buffer as one batch, prefetch the keys of the batch, then execute the
+    /// commands one by one in their order
     int ReceiveDataAndExecute(const std::string &buffer, std::shared_ptr<Client> client);
 
+    /// go on with the commands left when one waited for its values to be read back from the value log
+    void Resume(const std::shared_ptr<Client> &client);
+
+    MultiState &Multi() { return multi_; }
+
+    /// EXEC: run the commands queued since MULTI back to back, their replies sent as one array. Nothing runs when a
+    /// watched key changed since WATCH
+    void ExecTransaction(const std::shared_ptr<Client> &client);
+
+    /// whether EXEC is running the queued commands
+    bool InTransaction() const { return in_transaction_; }
+
+    /// bytes held by the query buffer and the decoded batch
+    size_t QueryBufferSize() const {
+        return data_.capacity() + batch_.capacity() * sizeof(Query) + batch_ends_.capacity() * sizeof(size_t) +
+               batch_keys_.capacity() * sizeof(std::string_view);
+    }
+
 private:
     /// private method
-    int BuildRedisCommand(const resp::unique_value &rep);
+    int BuildRedisCommand(const resp::unique_value &rep, Query &query);
+
+    int BuildExecutor(const Query &query);
+
+    /// hash all keys of the decoded batch and prefetch their slots in the keyspace before executing
+    void PrefetchBatch();
+
+    /// execute one decoded command and propagate it if needed
+    int ExecuteQuery(Query &query, const std::shared_ptr<Client> &client);
+
+    /// start reading back the spilled values of the keys of @param query. Return true if the command has to wait
+    /// for them, Resume() is then posted to the event loop of @param client once they are in memory
+    bool WaitSpilledValues(const Query &query, const std::shared_ptr<Client> &client);
+
+    /// put @param query in the transaction of @param client instead of executing it
+    void QueueCommand(Query &query, const std::shared_ptr<Client> &client);
+
+    /// whether one of @param watched_keys changed since WATCH
+    static bool WatchedKeysChanged(const std::vector<WatchedKey> &watched_keys);
+
+    /// bump the WATCH versions of the keys written by @param query
+    void SignalModifiedKeys(const Query &query);
+
+    /// count the accesses to the keys of @param query, for HotKeys and the keyspace stats per prefix
+    void RecordKeyAccesses(const Query &query);
 
-    int BuildExecutor();
+    /// fill the command to the backlog and the output buffer of slaves
+    void Propagate(const Query &query, const std::shared_ptr<Client> &client);
 
 private:
-    resp::encoder<std::string> encoder_;
     resp::decoder decoder_;
     std::string data_;
 
-    Query query_;
+    std::vector<Query> batch_;                 /// decoded commands of the current read
+    std::vector<size_t> batch_ends_;           /// end offset in data_ of every command in batch_
+    std::vector<std::string_view> batch_keys_; /// keys of batch_, reused between reads
+    std::vector<std::string_view> query_keys_; /// keys of the command being executed
+    bool waiting_values_ = false;   /// a command waits for its spilled values, the data received meanwhile waits too
+    bool values_loaded_ = false;    /// the values of the next command were just read back, it does not wait again
+    MultiState multi_;
+    bool in_transaction_ = false;
     std::shared_ptr<AbstractInternalCommandExecutor> internal_executor_;
 };
 
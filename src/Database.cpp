@@ -3,52 +3,505 @@
 //
 
 #include "Database.h"
+#include "Epoch.h"
 #include "GlobMatcher.hpp"
 #include "rdbparse.h"
 #include "status.h"
 #include "Server.h"
+#include "LazyFree.h"
+#include "Zmalloc.h"
 
+#include <cmath>
 #include <filesystem>
+#include <strings.h>
 #include <unistd.h>
+#include <unordered_set>
 
-// Initialize static member outside the class
-Database *Database::instance_ = nullptr;
-std::mutex Database::m_;
+thread_local int Database::selected_db_ = 0;
+
+/// select a database on the calling thread for the scope, e.g for the DEL propagated by a deletion of the cron
+class ScopedDb {
+public:
+    explicit ScopedDb(int db) : saved_(Database::SelectedDb()) { Database::SelectDb(db); }
+
+    ~ScopedDb() { Database::SelectDb(saved_); }
+
+private:
+    int saved_;
+};
+
+Database::Database() {
+    for (int i = 0; i < DEFAULT_DATABASES; ++i) {
+        dbs_.push_back(std::make_unique<Keyspace>());
+    }
+}
 
 Database *Database::GetInstance() {
-    std::lock_guard lock(m_);
-    if (instance_ == nullptr) {
-        instance_ = new Database();
+    /// initialized once in a thread safe way, then every call is a plain load
+    static Database *instance = new Database();
+    return instance;
+}
+
+std::vector<std::unique_lock<SeqMutex>> Database::LockShards(std::span<const std::string> keys, size_t step) {
+    std::array<bool, DB_SHARDS> wanted{};
+    for (size_t i = 0; i < keys.size(); i += step) {
+        wanted[ShardIndex(Table::Hash(keys[i]))] = true;
     }
 
-    return instance_;
+    std::vector<std::unique_lock<SeqMutex>> locks;
+    for (size_t i = 0; i < DB_SHARDS; ++i) {
+        if (wanted[i])
+            locks.emplace_back(Shards()[i].m);
+    }
+    return locks;
 }
 
-void Database::SetKeyVal(const std::string &key, const std::string &val, int on_exist, int64_t expired_ts) {
-    std::lock_guard lock(m_);
+void Database::SetKeyVal(const std::string &key, const std::string &val, int on_exist, int64_t expired_ts,
+                         bool keep_ttl) {
+    RedisObject obj = CreateStringValue(val);
+
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto old = LookupKey(shard, key);
     /// return when require the key exist before but actually not
-    if (on_exist == 0 && table_.find(key) != table_.end())
+    if (on_exist == 0 && old)
         return;
 
     /// return when require the key not exist before but actually yes
-    if (on_exist == 1 && table_.find(key) == table_.end())
+    if (on_exist == 1 && !old)
         return;
 
     LOG_DEBUG(TAG, "Set key %s, val %s, expire_time %lld", key.c_str(), val.c_str(), expired_ts);
-    table_[key] = std::make_shared<RdbParser::ParsedResult>(key, val, expired_ts);
+    if (keep_ttl) {
+        /// the deadline is already in the expire index
+        expired_ts = old ? old->Expire() : 0;
+    } else if (expired_ts > 0) {
+        shard.expires.Add(key, expired_ts);
+    }
+
+    obj.SetExpire(expired_ts);
+    SetKey(shard, key, std::move(obj));
+}
+
+int Database::IncrBy(const std::string &key, int64_t delta, int64_t &result) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj) {
+        SetKey(shard, key, RedisObject::CreateInteger(delta));
+        result = delta;
+        return 0;
+    }
+
+    if (obj->Type() != ObjString)
+        return WrongTypeError;
+
+    int64_t value;
+    if (!obj->GetInteger(value))
+        return NotIntegerError;
+
+    if (__builtin_add_overflow(value, delta, &result))
+        return IncrOverflowError;
+
+    /// update in place, the expire time is kept
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    obj->SetInteger(result);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return 0;
+}
+
+int Database::IncrByFloat(const std::string &key, long double delta, std::string &result) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    long double value = 0;
+    int64_t expire_ts = 0;
+    auto obj = LookupKey(shard, key);
+    if (obj) {
+        if (obj->Type() != ObjString)
+            return WrongTypeError;
+
+        if (!StringToLongDouble(obj->String(), value))
+            return NotFloatError;
+
+        expire_ts = obj->Expire();
+    }
+
+    value += delta;
+    if (std::isnan(value) || std::isinf(value))
+        return IncrNanOrInfinityError;
+
+    result = LongDoubleToString(value);
+    SetKey(shard, key, RedisObject::CreateString(result, expire_ts));
+    return 0;
+}
+
+bool Database::SetHashField(RedisObject &hash, std::string_view field, std::string_view value) const {
+    return hash.HashSet(field, value, rdb_cfg_->hash_max_listpack_entries, rdb_cfg_->hash_max_listpack_value);
+}
+
+int Database::HashSet(const std::string &key, std::span<const std::string> pairs) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    int added = 0;
+    if (!obj) {
+        RedisObject hash = RedisObject::CreateHash();
+        for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+            added += SetHashField(hash, pairs[i], pairs[i + 1]) ? 1 : 0;
+        }
+        SetKey(shard, key, std::move(hash));
+        return added;
+    }
+
+    if (obj->Type() != ObjHash)
+        return WrongTypeError;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+        added += SetHashField(*obj, pairs[i], pairs[i + 1]) ? 1 : 0;
+    }
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return added;
+}
+
+int Database::HashDelete(const std::string &key, std::span<const std::string> fields) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return 0;
+
+    if (obj->Type() != ObjHash)
+        return WrongTypeError;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    int deleted = 0;
+    for (auto &field: fields) {
+        deleted += obj->HashDelete(field) ? 1 : 0;
+    }
+
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+
+    /// no empty hash is left behind
+    if (obj->HashLength() == 0) {
+        RedisObject old;
+        PopKey(shard, key, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+    }
+    return deleted;
+}
+
+int Database::HashIncrBy(const std::string &key, const std::string &field, int64_t delta, int64_t &result) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (obj && obj->Type() != ObjHash)
+        return WrongTypeError;
+
+    int64_t value = 0;
+    char buf[OBJ_INT_STR_LEN];
+    std::string_view current;
+    if (obj && obj->HashGet(field, current, buf) && !StringToInt64(current, value))
+        return HashValueNotIntegerError;
+
+    if (__builtin_add_overflow(value, delta, &result))
+        return IncrOverflowError;
+
+    std::string formatted = std::to_string(result);
+    if (!obj) {
+        RedisObject hash = RedisObject::CreateHash();
+        SetHashField(hash, field, formatted);
+        SetKey(shard, key, std::move(hash));
+        return 0;
+    }
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    SetHashField(*obj, field, formatted);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return 0;
+}
+
+RedisObject Database::CreateListValue() const {
+    return RedisObject::CreateList(rdb_cfg_->list_max_listpack_size, rdb_cfg_->list_compress_depth);
+}
+
+int64_t Database::ListPush(const std::string &key, std::span<const std::string> elements, bool head) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (obj && obj->Type() != ObjList)
+        return WrongTypeError;
+
+    auto push = [&elements, head](RedisObject &list) {
+        for (auto &e: elements) {
+            if (head)
+                list.GetList()->PushHead(e);
+            else
+                list.GetList()->PushTail(e);
+        }
+        return static_cast<int64_t>(list.GetList()->Length());
+    };
+
+    if (!obj) {
+        RedisObject list = CreateListValue();
+        int64_t len = push(list);
+        SetKey(shard, key, std::move(list));
+        return len;
+    }
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    int64_t len = push(*obj);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return len;
+}
+
+int Database::ListPop(const std::string &key, size_t count, bool head, std::vector<std::string> &elements) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return 0;
+
+    if (obj->Type() != ObjList)
+        return WrongTypeError;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    RedisObject::List *list = obj->GetList();
+    count = std::min(count, list->Length());
+    elements.resize(count);
+    for (auto &e: elements) {
+        if (head)
+            list->PopHead(e);
+        else
+            list->PopTail(e);
+    }
+
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+
+    /// no empty list is left behind
+    if (list->Length() == 0) {
+        RedisObject old;
+        PopKey(shard, key, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+    }
+    return 1;
+}
+
+int Database::ListTrim(const std::string &key, int64_t start, int64_t stop) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return 0;
+
+    if (obj->Type() != ObjList)
+        return WrongTypeError;
+
+    RedisObject::List *list = obj->GetList();
+    auto len = static_cast<int64_t>(list->Length());
+    if (start < 0)
+        start = std::max<int64_t>(start + len, 0);
+    if (stop < 0)
+        stop += len;
+    stop = std::min(stop, len - 1);
+
+    if (start > stop) {
+        RedisObject old;
+        PopKey(shard, key, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+        return 0;
+    }
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    /// the tail first, the start index stays valid
+    list->DeleteRange(stop + 1, len - stop - 1);
+    list->DeleteRange(0, start);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return 0;
+}
+
+int Database::ListMove(const std::string &src, const std::string &dst, bool from_head, bool to_head,
+                       std::string &element) {
+    Shard &src_shard = ShardOf(src);
+    Shard &dst_shard = ShardOf(dst);
+    /// in the order of the stripes, as LockShards() takes them
+    std::unique_lock first_lock(&src_shard < &dst_shard ? src_shard.m : dst_shard.m);
+    std::unique_lock<SeqMutex> second_lock;
+    if (&src_shard != &dst_shard)
+        second_lock = std::unique_lock(&src_shard < &dst_shard ? dst_shard.m : src_shard.m);
+
+    auto obj = LookupKey(src_shard, src);
+    if (!obj)
+        return 0;
+    if (obj->Type() != ObjList)
+        return WrongTypeError;
+
+    auto dst_obj = LookupKey(dst_shard, dst);
+    if (dst_obj && dst_obj->Type() != ObjList)
+        return WrongTypeError;
+
+    /// removing the expired destination may have moved the source in the table
+    obj = src_shard.table.Find(src);
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(src, *obj) : 0;
+    if (from_head)
+        obj->GetList()->PopHead(element);
+    else
+        obj->GetList()->PopTail(element);
+    if (UseKeyspaceStats())
+        AccountKey(src_shard, src, 0, AccountedBytes(src, *obj) - bytes);
+
+    if (obj->GetList()->Length() == 0) {
+        RedisObject old;
+        PopKey(src_shard, src, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+    }
+
+    /// looked up again, for the same reason, and gone if it was the source holding a single element
+    dst_obj = dst_shard.table.Find(dst);
+    if (!dst_obj) {
+        RedisObject list = CreateListValue();
+        list.GetList()->PushHead(element);
+        SetKey(dst_shard, dst, std::move(list));
+        return 1;
+    }
+
+    bytes = UseKeyspaceStats() ? AccountedBytes(dst, *dst_obj) : 0;
+    if (to_head)
+        dst_obj->GetList()->PushHead(element);
+    else
+        dst_obj->GetList()->PushTail(element);
+    if (UseKeyspaceStats())
+        AccountKey(dst_shard, dst, 0, AccountedBytes(dst, *dst_obj) - bytes);
+    return 1;
+}
+
+int Database::ReadObject(const std::string &key, int type, const std::function<void(const RedisObject *)> &fn) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (obj && obj->Type() != type)
+        return WrongTypeError;
+
+    fn(obj);
+    return 0;
+}
+
+int Database::ReadObjects(std::span<const std::string> keys, int type,
+                          const std::function<void(const std::vector<const RedisObject *> &)> &fn) {
+    auto locks = LockShards(keys);
+    int64_t now = CurrentTimeMs();
+    std::vector<bool> found(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto obj = LookupKey(ShardOf(keys[i]), keys[i], now);
+        if (obj && obj->Type() != type)
+            return WrongTypeError;
+        found[i] = obj != nullptr;
+    }
+
+    /// removing an expired key may have moved the ones looked up before it in the table, they are found again once
+    /// nothing is removed anymore
+    std::vector<const RedisObject *> objs;
+    objs.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        objs.push_back(found[i] ? ShardOf(keys[i]).table.Find(keys[i]) : nullptr);
+    }
+
+    fn(objs);
+    return 0;
+}
+
+bool Database::AddSetMember(RedisObject &set, std::string_view member) const {
+    return set.SetAdd(member, rdb_cfg_->set_max_intset_entries);
+}
+
+int Database::SetAdd(const std::string &key, std::span<const std::string> members) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    int added = 0;
+    if (!obj) {
+        RedisObject set = RedisObject::CreateSet();
+        for (auto &member: members) {
+            added += AddSetMember(set, member) ? 1 : 0;
+        }
+        SetKey(shard, key, std::move(set));
+        return added;
+    }
+
+    if (obj->Type() != ObjSet)
+        return WrongTypeError;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    for (auto &member: members) {
+        added += AddSetMember(*obj, member) ? 1 : 0;
+    }
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    return added;
+}
+
+int Database::SetRemove(const std::string &key, std::span<const std::string> members) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return 0;
+
+    if (obj->Type() != ObjSet)
+        return WrongTypeError;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    int removed = 0;
+    for (auto &member: members) {
+        removed += obj->SetRemove(member) ? 1 : 0;
+    }
+
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+
+    /// no empty set is left behind
+    if (obj->SetLength() == 0) {
+        RedisObject old;
+        PopKey(shard, key, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+    }
+    return removed;
 }
 
 int Database::XAdd(const VString &argv, RdbParser::EntryID &entry_id) {
     std::string stream_key = argv[1];
 
-    if (table_.find(stream_key) == table_.end()) {
-        auto stream = std::make_shared<RdbParser::ParsedResult>("stream");
-        table_[stream_key] = stream;
+    Shard &shard = ShardOf(stream_key);
+    std::lock_guard lock(shard.m);
+    LookupKey(shard, stream_key);
+    auto &obj = shard.table[stream_key];
+    if (obj.Empty()) {
+        obj = RedisObject::CreateStream();
+        InitLru(obj);
+        if (UseKeyIndex())
+            shard.key_index.Insert(stream_key);
+        if (UseKeyspaceStats())
+            AccountKey(shard, stream_key, 1, AccountedBytes(stream_key, obj));
+    } else if (obj.Type() != ObjStream) {
+        return WrongTypeError;
     }
 
-    int ret = table_[stream_key]->AddStream(argv, entry_id);
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(stream_key, obj) : 0;
+    int ret = RdbParser::AddStreamEntry(*obj.GetStream(), argv, entry_id);
     if (ret < 0) {
         LOG_ERROR("Stream", "Add stream fail %d", ret);
+        /// do not leave an empty stream behind
+        if (obj.GetStream()->empty()) {
+            RedisObject empty;
+            PopKey(shard, stream_key, empty);
+        }
         if (ret == -1) {
             return NonMonotonicEntryIdError;
         } else if (ret == -2) {
@@ -57,31 +510,901 @@ int Database::XAdd(const VString &argv, RdbParser::EntryID &entry_id) {
         return UnknownError;
     }
 
+    if (UseKeyspaceStats())
+        AccountKey(shard, stream_key, 0, AccountedBytes(stream_key, obj) - bytes);
     return 0;
 }
 
+bool Database::ReadStringConcurrent(Shard &shard, const std::string &key, std::string &value) {
+    Epoch::Guard guard;
+    int64_t now = CurrentTimeMs();
+    for (int attempt = 0; attempt < DB_CONCURRENT_READ_ATTEMPTS; ++attempt) {
+        uint64_t seq = shard.m.ReadBegin();
+        if (SeqMutex::IsWriting(seq))
+            continue;
+
+        bool valid;
+        auto found = shard.table.FindConcurrent(key, [&shard, seq]() { return shard.m.Validate(seq); }, valid);
+        if (!valid)
+            continue;
+        if (!found) {
+            value.clear();
+            return true;
+        }
+
+        /// a bitwise copy, owning nothing, that only counts once validated. The string buffer it points to cannot be
+        /// freed while the guard holds, and is never modified in place
+        alignas(RedisObject) unsigned char image[sizeof(RedisObject)];
+        std::memcpy(image, static_cast<const void *>(found), sizeof(RedisObject));
+        if (!shard.m.Validate(seq))
+            continue;
+
+        auto &obj = *reinterpret_cast<const RedisObject *>(image);
+        if (obj.IsExpired(now) || obj.Encoding() == EncSpilled || AccessedLru(obj) != obj.Lru())
+            return false;
+
+        value = (obj.Type() == ObjString) ? obj.String() : "";
+        return true;
+    }
+    return false;
+}
+
 std::string Database::RetrieveValueOfKey(const std::string &key) {
-    std::lock_guard lock(m_);
+    Shard &shard = ShardOf(key);
+    std::string value;
+    if (ReadStringConcurrent(shard, key, value))
+        return value;
+
+    std::lock_guard lock(shard.m);
     try {
-        int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-        auto p = table_.at(key);
-        if (p->expire_time > 0 && p->expire_time < now) {
-            LOG_INFO(TAG, "Key %s has expired at %lld, now %lld, removing it from the database",
-                     key.c_str(), p->expire_time, now);
+        auto slot = LookupKey(shard, key);
+        if (!slot)
             return "";
-        }
 
-        LOG_DEBUG(TAG, "Key %s has expired at %lld, now %lld", key.c_str(), p->expire_time, now);
-        return p->kv_value;
+        auto &p = *slot;
+        LOG_DEBUG(TAG, "Key %s expires at %lld", key.c_str(), p.Expire());
+        return (p.Type() == ObjString) ? p.String() : "";
     }
     catch (std::exception &ex) {
         return "";
     }
 }
 
+uint64_t Database::KeyVersion(int db, std::string_view key) {
+    uint64_t hash = Table::Hash(key);
+    return dbs_[db]->shards[ShardIndex(hash)].versions[hash % DB_WATCH_SLOTS].load(std::memory_order_relaxed);
+}
+
+void Database::SignalModifiedKey(std::string_view key) {
+    uint64_t hash = Table::Hash(key);
+    BumpVersion(Shards()[ShardIndex(hash)], hash);
+}
+
+void Database::PrefetchKeys(const std::vector<std::string_view> &keys) {
+    /// two passes: the control bytes of all home groups first, then the matching slots once those lines arrived. No
+    /// stripe lock is taken, the tables are read as ReadStringConcurrent() does and a stripe being written is skipped
+    thread_local std::vector<uint64_t> hashes;
+    hashes.clear();
+    Epoch::Guard guard;
+    for (auto &key: keys) {
+        uint64_t hash = Table::Hash(key);
+        Shards()[ShardIndex(hash)].table.PrefetchGroup(hash);
+        hashes.push_back(hash);
+    }
+
+    for (auto hash: hashes) {
+        Shard &shard = Shards()[ShardIndex(hash)];
+        uint64_t seq = shard.m.ReadBegin();
+        if (!SeqMutex::IsWriting(seq))
+            shard.table.PrefetchSlots(hash, [&shard, seq]() { return shard.m.Validate(seq); });
+    }
+}
+
+int Database::ActiveRehash(int ms) {
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::milliseconds(ms);
+    int rehashes = 0;
+    for (auto &db: dbs_) {
+        for (auto &shard: db->shards) {
+            std::lock_guard lock(shard.m);
+            if (!shard.table.IsRehashing())
+                continue;
+
+            auto left = budget - (std::chrono::steady_clock::now() - start);
+            if (left <= std::chrono::steady_clock::duration::zero())
+                return rehashes;
+            rehashes += shard.table.RehashMilliseconds(std::max<int>(
+                    1, static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(left).count())));
+        }
+    }
+    return rehashes;
+}
+
+RedisObject *Database::LookupKey(Shard &shard, const std::string &key, int64_t now) {
+    auto obj = shard.table.Find(key);
+    if (!obj)
+        return nullptr;
+
+    if (!obj->IsExpired(now)) {
+        /// the commands of the clients read their spilled values back in the background first, see
+        /// LoadSpilledKeys(). What is still spilled here is read on this thread
+        if (obj->Encoding() == EncSpilled && !LoadSpilledValue(shard, *obj, key))
+            return nullptr;
+
+        TouchKey(*obj);
+        return obj;
+    }
+
+    /// a replica waits for the DEL of its master, so both keep the same dataset
+    if (!Server::GetInstance()->IsReplica()) {
+        LOG_INFO(TAG, "Key %s has expired at %lld, now %lld, removing it from the database",
+                 key.c_str(), obj->Expire(), now);
+        DeleteExpiredKey(shard, key);
+    }
+
+    return nullptr;
+}
+
+bool Database::PopKey(Shard &shard, const std::string &key, RedisObject &obj) {
+    if (!shard.table.Pop(key, obj))
+        return false;
+
+    BumpVersion(shard, Table::Hash(key));
+    if (UseKeyIndex())
+        shard.key_index.Erase(key);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, -1, -AccountedBytes(key, obj));
+    return true;
+}
+
+void Database::DeleteExpiredKey(Shard &shard, const std::string &key) {
+    RedisObject obj;
+    if (PopKey(shard, key, obj)) {
+        LazyFree::GetInstance()->FreeObject(std::move(obj), IsLazy(&RedisConfig::lazyfree_lazy_expire));
+    }
+    Server::GetInstance()->PropagateCommand({"DEL", key});
+}
+
+void Database::SetKey(Shard &shard, const std::string &key, RedisObject &&obj) {
+    InitLru(obj);
+    BumpVersion(shard, Table::Hash(key));
+    auto [slot, inserted] = shard.table.Emplace(key, RedisObject());
+    if (UseKeyspaceStats()) {
+        AccountKey(shard, key, inserted ? 1 : 0,
+                   AccountedBytes(key, obj) - (inserted ? 0 : AccountedBytes(key, *slot)));
+    }
+    if (!inserted) {
+        LazyFree::GetInstance()->FreeObject(std::move(*slot), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+    } else if (UseKeyIndex()) {
+        shard.key_index.Insert(key);
+    }
+    *slot = std::move(obj);
+}
+
+RedisObject Database::CreateStringValue(std::string_view val) const {
+    RedisObject obj = RedisObject::CreateString(val);
+    if (rdb_cfg_ && rdb_cfg_->string_compression_threshold > 0)
+        obj.Compress(rdb_cfg_->string_compression_threshold);
+    return obj;
+}
+
+static bool IsLfuPolicy(int policy) {
+    return policy == MaxMemoryAllKeysLfu || policy == MaxMemoryVolatileLfu;
+}
+
+static bool IsVolatilePolicy(int policy) {
+    return policy == MaxMemoryVolatileLru || policy == MaxMemoryVolatileLfu || policy == MaxMemoryVolatileRandom ||
+           policy == MaxMemoryVolatileTtl;
+}
+
+void Database::InitLru(RedisObject &obj) const {
+    if (rdb_cfg_ && IsLfuPolicy(rdb_cfg_->maxmemory_policy)) {
+        obj.SetLru((LfuTimeInMinutes() << 8) | LFU_INIT_VAL);
+    } else {
+        obj.SetLru(LruClock());
+    }
+}
+
+uint32_t Database::AccessedLru(const RedisObject &obj) const {
+    if (rdb_cfg_ && IsLfuPolicy(rdb_cfg_->maxmemory_policy)) {
+        uint8_t counter = LfuDecrAndReturn(obj, rdb_cfg_->lfu_decay_time);
+        counter = LfuLogIncr(counter, rdb_cfg_->lfu_log_factor);
+        return ((LfuTimeInMinutes() << 8) | counter) & 0xFFFFFF;
+    }
+    return LruClock() & 0xFFFFFF;
+}
+
+uint64_t Database::EvictionScore(const RedisObject &obj, int policy) const {
+    switch (policy) {
+        case MaxMemoryAllKeysLfu:
+        case MaxMemoryVolatileLfu:
+            /// the least frequently used first
+            return 255 - LfuDecrAndReturn(obj, rdb_cfg_->lfu_decay_time);
+        case MaxMemoryVolatileTtl:
+            /// the one expiring first
+            return UINT64_MAX - static_cast<uint64_t>(obj.Expire());
+        default:
+            return EstimateObjectIdleTime(obj);
+    }
+}
+
+void Database::EvictionPoolPopulate(int policy) {
+    bool only_volatile = IsVolatilePolicy(policy);
+    /// a random stripe of a random database, or the next ones when it has no candidate
+    size_t stripes = dbs_.size() * DB_SHARDS;
+    size_t first = rng_();
+    for (size_t i = 0; i < stripes; ++i) {
+        size_t idx = (first + i) % stripes;
+        int db = static_cast<int>(idx / DB_SHARDS);
+        Shard &shard = dbs_[db]->shards[idx % DB_SHARDS];
+        std::lock_guard lock(shard.m);
+        size_t sampled = shard.table.Sample(rng_(), rdb_cfg_->maxmemory_samples, [&](Table::Entry &entry) {
+            if (only_volatile && entry.value.Expire() <= 0)
+                return false;
+
+            evict_pool_.Insert(entry.key, EvictionScore(entry.value, policy), db);
+            return true;
+        });
+        if (sampled > 0)
+            return;
+    }
+}
+
+std::string Database::SelectEvictionKey(int policy, int &db) {
+    bool only_volatile = IsVolatilePolicy(policy);
+    if (policy == MaxMemoryAllKeysRandom || policy == MaxMemoryVolatileRandom) {
+        std::string key;
+        size_t stripes = dbs_.size() * DB_SHARDS;
+        size_t first = rng_();
+        for (size_t i = 0; i < stripes && key.empty(); ++i) {
+            size_t idx = (first + i) % stripes;
+            db = static_cast<int>(idx / DB_SHARDS);
+            Shard &shard = dbs_[db]->shards[idx % DB_SHARDS];
+            std::lock_guard lock(shard.m);
+            shard.table.Sample(rng_(), 1, [&](Table::Entry &entry) {
+                if (only_volatile && entry.value.Expire() <= 0)
+                    return false;
+
+                key = entry.key;
+                return true;
+            });
+        }
+        return key;
+    }
+
+    EvictionPoolPopulate(policy);
+    while (!evict_pool_.Empty()) {
+        auto candidate = evict_pool_.PopBest();
+        /// the candidates may have been deleted or persisted since they entered the pool, or their database swapped
+        if (candidate.db >= Databases())
+            continue;
+
+        Shard &shard = dbs_[candidate.db]->shards[ShardIndex(Table::Hash(candidate.key))];
+        std::lock_guard lock(shard.m);
+        auto obj = shard.table.Find(candidate.key);
+        if (obj && (!only_volatile || obj->Expire() > 0)) {
+            db = candidate.db;
+            return candidate.key;
+        }
+    }
+
+    return "";
+}
+
+int Database::PerformEvictions() {
+    /// a replica follows its master, which evicts for both
+    if (!rdb_cfg_ || rdb_cfg_->maxmemory == 0 || Server::GetInstance()->IsReplica())
+        return 0;
+
+    /// the replication backlog and the output buffers of the replicas are not part of the dataset, evicting keys
+    /// for them would only grow them with more DELs
+    size_t not_counted = Server::GetInstance()->ReplicationBufferSize() +
+                         Server::GetInstance()->SlavesOutputBufferSize();
+    auto used_memory = [not_counted]() {
+        size_t used = ZmallocUsedMemory();
+        return (used > not_counted) ? used - not_counted : 0;
+    };
+
+    if (used_memory() <= rdb_cfg_->maxmemory)
+        return 0;
+
+    int policy = rdb_cfg_->maxmemory_policy;
+    if (policy == MaxMemoryNoEviction)
+        return OutOfMemoryError;
+
+    std::lock_guard evict_lock(evict_m_);
+    auto start = std::chrono::steady_clock::now();
+    bool lazy = IsLazy(&RedisConfig::lazyfree_lazy_eviction);
+    for (int evicted = 1; used_memory() > rdb_cfg_->maxmemory; ++evicted) {
+        int db = 0;
+        std::string key = SelectEvictionKey(policy, db);
+        if (key.empty()) {
+            LOG_ERROR(TAG, "Used memory %zu over maxmemory %zu, but no key to evict", used_memory(),
+                      rdb_cfg_->maxmemory);
+            /// the values being freed in the background will bring the memory down soon
+            return LazyFree::GetInstance()->Pending() ? 0 : OutOfMemoryError;
+        }
+
+        /// the DEL is propagated in the database of the key
+        ScopedDb scoped_db(db);
+        Shard &shard = ShardOf(key);
+        std::unique_lock lock(shard.m);
+        RedisObject obj;
+        /// another thread may have deleted it since it was selected
+        if (!PopKey(shard, key, obj))
+            continue;
+        Server::GetInstance()->PropagateCommand({"DEL", key});
+        lock.unlock();
+
+        LazyFree::GetInstance()->FreeObject(std::move(obj), lazy);
+        ++stat_evicted_keys_;
+
+        /// do not block the command too long, the next one continues
+        if ((evicted & 0xF) == 0 && std::chrono::steady_clock::now() - start >=
+                                    std::chrono::microseconds(EVICTION_TIME_LIMIT_US))
+            break;
+    }
+
+    return 0;
+}
+
+bool Database::LoadSpilledValue(Shard &shard, RedisObject &obj, const std::string &key) {
+    uint64_t location;
+    uint32_t len;
+    obj.GetSpilled(location, len);
+
+    int encoding;
+    std::string payload;
+    if (!ValueLog::GetInstance()->Read(location, len, key, encoding, payload)) {
+        LOG_ERROR(TAG, "Cannot read the value of key %s back from the value log", key.c_str());
+        return false;
+    }
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, obj) : 0;
+    obj.Unspill(encoding, payload);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, obj) - bytes);
+    ++stat_loaded_values_;
+    return true;
+}
+
+void Database::InstallSpilledValue(int db, const std::string &key, uint64_t location, int encoding,
+                                   std::string_view payload) {
+    if (db >= Databases())
+        return;
+
+    Shard &shard = dbs_[db]->shards[ShardIndex(Table::Hash(key))];
+    std::lock_guard lock(shard.m);
+    auto obj = shard.table.Find(key);
+    uint64_t current;
+    uint32_t len;
+    if (!obj || !obj->GetSpilled(current, len) || current != location)
+        return;
+
+    int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+    obj->Unspill(encoding, payload);
+    if (UseKeyspaceStats())
+        AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+    TouchKey(*obj);
+    ++stat_loaded_values_;
+}
+
+bool Database::LoadSpilledKeys(const std::vector<std::string_view> &keys, std::function<void()> done) {
+    if (!UseTieredStorage())
+        return false;
+
+    typedef struct SpilledKey {
+        std::string key;
+        uint64_t location;
+        uint32_t len;
+    } SpilledKey;
+
+    std::vector<SpilledKey> spilled;
+    for (auto key: keys) {
+        Shard &shard = ShardOf(key);
+        std::lock_guard lock(shard.m);
+        auto obj = shard.table.Find(key);
+        uint64_t location;
+        uint32_t len;
+        if (obj && obj->GetSpilled(location, len))
+            spilled.push_back({std::string(key), location, len});
+    }
+
+    if (spilled.empty())
+        return false;
+
+    /// the reads complete in order on the single thread of the value log, the last one calls done
+    int db = selected_db_;
+    auto remaining = std::make_shared<size_t>(spilled.size());
+    auto on_done = std::make_shared<std::function<void()>>(std::move(done));
+    for (auto &entry: spilled) {
+        ValueLog::GetInstance()->ReadAsync(
+                entry.location, entry.len, entry.key,
+                [this, db, key = entry.key, location = entry.location, remaining, on_done](
+                        bool ok, int encoding, std::string &&payload) {
+                    /// a failed read is retried on the thread of the command by LookupKey()
+                    if (ok)
+                        InstallSpilledValue(db, key, location, encoding, payload);
+                    if (--*remaining == 0)
+                        (*on_done)();
+                });
+    }
+    return true;
+}
+
+int Database::SpillColdValues(int ms) {
+    /// the values handed over last time are not stubs yet, the memory does not show them gone
+    if (!UseTieredStorage() || spills_in_flight_ > 0)
+        return 0;
+
+    /// the same memory as maxmemory counts
+    size_t not_counted = Server::GetInstance()->ReplicationBufferSize() +
+                         Server::GetInstance()->SlavesOutputBufferSize();
+    size_t used = ZmallocUsedMemory();
+    if (used <= not_counted || used - not_counted <= rdb_cfg_->tiered_max_memory)
+        return 0;
+    size_t excess = used - not_counted - rdb_cfg_->tiered_max_memory;
+
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::milliseconds(ms);
+    int policy = IsLfuPolicy(rdb_cfg_->maxmemory_policy) ? MaxMemoryAllKeysLfu : MaxMemoryAllKeysLru;
+    auto min_size = static_cast<size_t>(rdb_cfg_->tiered_min_value_size);
+    thread_local std::minstd_rand rng(std::random_device{}());
+    size_t stripes = dbs_.size() * DB_SHARDS;
+    /// the entries do not move meanwhile, only this thread inserts and erases
+    std::unordered_set<const Table::Entry *> picked;
+    size_t picked_bytes = 0;
+    int spilled = 0;
+    /// stop after a round of stripes without any value big enough
+    for (size_t misses = 0; misses < stripes && picked_bytes < excess;) {
+        size_t idx = rng() % stripes;
+        Shard &shard = dbs_[idx / DB_SHARDS]->shards[idx % DB_SHARDS];
+        std::lock_guard lock(shard.m);
+
+        /// the coldest of a few sampled values, as the eviction picks its candidates
+        Table::Entry *coldest = nullptr;
+        uint64_t coldest_score = 0;
+        shard.table.Sample(rng(), rdb_cfg_->maxmemory_samples, [&](Table::Entry &entry) {
+            int encoding;
+            std::string_view payload;
+            if (!entry.value.GetSpillPayload(encoding, payload) || payload.size() < min_size ||
+                picked.contains(&entry))
+                return false;
+
+            uint64_t score = EvictionScore(entry.value, policy);
+            if (!coldest || score > coldest_score) {
+                coldest = &entry;
+                coldest_score = score;
+            }
+            return true;
+        });
+
+        if (!coldest) {
+            ++misses;
+            continue;
+        }
+        misses = 0;
+
+        /// the write goes to the thread of the value log with a copy of the value, the stub is installed after it
+        int encoding;
+        std::string_view payload;
+        coldest->value.GetSpillPayload(encoding, payload);
+        picked.insert(coldest);
+        picked_bytes += payload.size();
+        ++spills_in_flight_;
+        ValueLog::GetInstance()->Submit(
+                [this, db = static_cast<int>(idx / DB_SHARDS), key = coldest->key, encoding,
+                        payload = std::string(payload)]() {
+                    uint64_t location;
+                    uint32_t len;
+                    if (ValueLog::GetInstance()->Append(key, encoding, payload, location, len))
+                        InstallSpill(db, key, encoding, payload, location, len);
+                    --spills_in_flight_;
+                });
+        ++spilled;
+
+        if ((spilled & 0xF) == 0 && std::chrono::steady_clock::now() - start >= budget)
+            break;
+    }
+    return spilled;
+}
+
+void Database::InstallSpill(int db, const std::string &key, int encoding, std::string_view payload,
+                            uint64_t location, uint32_t len) {
+    if (db < Databases()) {
+        Shard &shard = dbs_[db]->shards[ShardIndex(Table::Hash(key))];
+        std::lock_guard lock(shard.m);
+        auto obj = shard.table.Find(key);
+        int current_encoding;
+        std::string_view current;
+        if (obj && obj->GetSpillPayload(current_encoding, current) && current_encoding == encoding &&
+            current == payload) {
+            int64_t bytes = UseKeyspaceStats() ? AccountedBytes(key, *obj) : 0;
+            obj->Spill(location, len);
+            if (UseKeyspaceStats())
+                AccountKey(shard, key, 0, AccountedBytes(key, *obj) - bytes);
+            ++stat_spilled_values_;
+            return;
+        }
+    }
+
+    /// the value was deleted or changed while it was written, nothing points at the record
+    ValueLog::GetInstance()->Discard(location, len);
+}
+
+int Database::CompactValueLog(int ms) {
+    /// a pass ends once its relocations are done, so a segment is only picked again if a stub escaped it
+    if (!UseTieredStorage() || relocations_in_flight_ > 0)
+        return 0;
+
+    auto vlog = ValueLog::GetInstance();
+    int stripes = Databases() * DB_SHARDS;
+    /// the last pass is over once its relocations are done. The segment went away with its last live record, unless
+    /// it had none left to relocate
+    if (compact_stripe_ >= stripes) {
+        vlog->DropDeadSegment(compact_segment_);
+        compact_stripe_ = -1;
+    }
+
+    if (compact_stripe_ < 0) {
+        if (!vlog->PickCompaction(rdb_cfg_->tiered_compact_percent, compact_segment_))
+            return 0;
+        compact_stripe_ = 0;
+        compact_cursor_ = 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::milliseconds(ms);
+    int queued = 0;
+    for (int steps = 1; compact_stripe_ < stripes; ++steps) {
+        int db = compact_stripe_ / DB_SHARDS;
+        Shard &shard = dbs_[db]->shards[compact_stripe_ % DB_SHARDS];
+        {
+            std::lock_guard lock(shard.m);
+            compact_cursor_ = shard.table.Scan(compact_cursor_, [&](Table::Entry &entry) {
+                uint64_t location;
+                uint32_t len;
+                if (!entry.value.GetSpilled(location, len) || ValueLog::SegmentOf(location) != compact_segment_)
+                    return;
+
+                ++queued;
+                ++relocations_in_flight_;
+                vlog->Submit([this, db, key = entry.key, location, len]() {
+                    RelocateSpilledValue(db, key, location, len);
+                    --relocations_in_flight_;
+                });
+            });
+        }
+
+        if (compact_cursor_ == 0)
+            ++compact_stripe_;
+        if (queued >= DB_COMPACT_BATCH ||
+            ((steps & 0xF) == 0 && std::chrono::steady_clock::now() - start >= budget))
+            return queued;
+    }
+
+    if (relocations_in_flight_ == 0) {
+        vlog->DropDeadSegment(compact_segment_);
+        compact_stripe_ = -1;
+    }
+    return queued;
+}
+
+void Database::RelocateSpilledValue(int db, const std::string &key, uint64_t location, uint32_t len) {
+    /// a failed copy leaves the stub and its segment as they are, the segment is picked again later
+    auto vlog = ValueLog::GetInstance();
+    int encoding;
+    std::string payload;
+    uint64_t new_location;
+    uint32_t new_len;
+    if (!vlog->Read(location, len, key, encoding, payload) ||
+        !vlog->Append(key, encoding, payload, new_location, new_len))
+        return;
+
+    if (db < Databases()) {
+        Shard &shard = dbs_[db]->shards[ShardIndex(Table::Hash(key))];
+        std::lock_guard lock(shard.m);
+        auto obj = shard.table.Find(key);
+        uint64_t current;
+        uint32_t current_len;
+        /// the copy has the same length, only the location of the stub changes
+        if (obj && obj->GetSpilled(current, current_len) && current == location) {
+            obj->Relocate(new_location);
+            vlog->Discard(location, len);
+            return;
+        }
+    }
+
+    vlog->Discard(new_location, new_len);
+}
+
+int Database::ActiveExpireCycle(int ms) {
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::milliseconds(ms);
+    int64_t now = CurrentTimeMs();
+    bool is_replica = Server::GetInstance()->IsReplica();
+    int deleted = 0;
+
+    /// a cycle that ran out of time resumes with the stripe it stopped at, so every stripe gets its turn
+    int stripes = Databases() * DB_SHARDS;
+    int first = expire_shard_ % stripes;
+    for (int i = 0; i < stripes; ++i) {
+        int idx = (first + i) % stripes;
+        ScopedDb scoped_db(idx / DB_SHARDS);
+        Shard &shard = Shards()[idx % DB_SHARDS];
+        std::lock_guard lock(shard.m);
+
+        /// deadlines strictly before now, the same rule as RedisObject::IsExpired()
+        shard.expires.Advance(now - 1);
+        for (int checked = 1; shard.expires.HasDue(); ++checked) {
+            auto entry = shard.expires.PopDue();
+
+            /// skip the stale entries: the key was deleted, overwritten, persisted or got another expire time since
+            auto obj = shard.table.Find(entry.key);
+            if (obj && obj->Expire() == entry.when && !is_replica) {
+                DeleteExpiredKey(shard, entry.key);
+                ++deleted;
+            }
+
+            /// check the clock only once in a while, the rest stays due for the next cron
+            if ((checked & 0xF) == 0 && std::chrono::steady_clock::now() - start >= budget) {
+                expire_shard_ = idx;
+                return deleted;
+            }
+        }
+    }
+
+    return deleted;
+}
+
+bool Database::DeleteKey(const std::string &key, bool lazy) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    return PopUserKey(shard, key, CurrentTimeMs(), lazy);
+}
+
+bool Database::PopUserKey(Shard &shard, const std::string &key, int64_t now, bool lazy) {
+    /// not LookupKey(): a replica keeps its expired keys until this DEL of its master comes
+    auto found = shard.table.Find(key);
+    if (!found)
+        return false;
+
+    bool expired = found->IsExpired(now);
+    RedisObject obj;
+    PopKey(shard, key, obj);
+    LazyFree::GetInstance()->FreeObject(std::move(obj), lazy);
+    return !expired;
+}
+
+int Database::DeleteKeys(const std::vector<std::string> &keys, bool lazy) {
+    auto locks = LockShards(keys);
+    int64_t now = CurrentTimeMs();
+    int deleted = 0;
+    for (auto &key: keys) {
+        deleted += PopUserKey(ShardOf(key), key, now, lazy) ? 1 : 0;
+    }
+    return deleted;
+}
+
+void Database::MultiGet(std::span<const std::string> keys, const std::function<void(const RedisObject *)> &fn) {
+    auto locks = LockShards(keys);
+    int64_t now = CurrentTimeMs();
+    for (auto &key: keys) {
+        auto obj = LookupKey(ShardOf(key), key, now);
+        fn((obj && obj->Type() == ObjString) ? obj : nullptr);
+    }
+}
+
+bool Database::MultiSet(std::span<const std::string> pairs, bool nx) {
+    std::vector<RedisObject> values;
+    values.reserve(pairs.size() / 2);
+    for (size_t i = 1; i < pairs.size(); i += 2) {
+        values.push_back(CreateStringValue(pairs[i]));
+    }
+
+    auto locks = LockShards(pairs, 2);
+    if (nx) {
+        int64_t now = CurrentTimeMs();
+        for (size_t i = 0; i < pairs.size(); i += 2) {
+            if (LookupKey(ShardOf(pairs[i]), pairs[i], now))
+                return false;
+        }
+    }
+
+    /// a repeated key takes its last value, as with consecutive SETs
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+        SetKey(ShardOf(pairs[i]), pairs[i], std::move(values[i / 2]));
+    }
+    return true;
+}
+
+void Database::FlushShard(Shard &shard, bool async) {
+    BumpAllVersions(shard);
+    shard.prefix_stats.Clear();
+    if (!async) {
+        shard.table.Clear();
+        shard.expires.Clear();
+        shard.key_index.Clear();
+        return;
+    }
+
+    /// swap the tables out in O(1), the destructors walk them on the lazy free thread
+    auto old_table = new Table();
+    old_table->Swap(shard.table);
+    auto old_expires = new ExpireIndex(std::move(shard.expires));
+    shard.expires = ExpireIndex(CurrentTimeMs());
+    auto old_key_index = new KeyIndex();
+    old_key_index->Swap(shard.key_index);
+    LazyFree::GetInstance()->Submit([old_table, old_expires, old_key_index]() {
+        delete old_table;
+        delete old_expires;
+        delete old_key_index;
+    });
+}
+
+void Database::FlushAll(bool async) {
+    /// all the stripes at once, so no command sees a half flushed keyspace
+    std::vector<std::unique_lock<SeqMutex>> locks;
+    for (auto &db: dbs_) {
+        for (auto &shard: db->shards) {
+            locks.emplace_back(shard.m);
+        }
+    }
+
+    for (auto &db: dbs_) {
+        for (auto &shard: db->shards) {
+            FlushShard(shard, async);
+        }
+    }
+}
+
+void Database::FlushDb(bool async) {
+    std::vector<std::unique_lock<SeqMutex>> locks;
+    for (auto &shard: Shards()) {
+        locks.emplace_back(shard.m);
+    }
+
+    for (auto &shard: Shards()) {
+        FlushShard(shard, async);
+    }
+}
+
+int Database::MoveKey(const std::string &key, int db) {
+    /// the key has the same stripe in both databases
+    size_t idx = ShardIndex(Table::Hash(key));
+    Shard &src = Shards()[idx];
+    Shard &dst = dbs_[db]->shards[idx];
+    std::unique_lock first_lock(selected_db_ < db ? src.m : dst.m);
+    std::unique_lock second_lock(selected_db_ < db ? dst.m : src.m);
+
+    if (!LookupKey(src, key))
+        return 0;
+
+    {
+        ScopedDb scoped_db(db);
+        if (LookupKey(dst, key))
+            return 0;
+    }
+
+    /// the value moves as it is, with its expire time and access history
+    RedisObject obj;
+    PopKey(src, key, obj);
+    if (obj.Expire() > 0)
+        dst.expires.Add(key, obj.Expire());
+    if (UseKeyIndex())
+        dst.key_index.Insert(key);
+    BumpVersion(dst, Table::Hash(key));
+    if (UseKeyspaceStats())
+        AccountKey(dst, key, 1, AccountedBytes(key, obj));
+    dst.table.Set(key, std::move(obj));
+    return 1;
+}
+
+void Database::SwapDb(int db1, int db2) {
+    if (db1 == db2)
+        return;
+
+    auto &low = dbs_[std::min(db1, db2)]->shards;
+    auto &high = dbs_[std::max(db1, db2)]->shards;
+    std::vector<std::unique_lock<SeqMutex>> locks;
+    for (auto &shard: low) {
+        locks.emplace_back(shard.m);
+    }
+    for (auto &shard: high) {
+        locks.emplace_back(shard.m);
+    }
+
+    /// the Keyspace objects stay in place, only the content of their stripes is exchanged
+    for (size_t i = 0; i < DB_SHARDS; ++i) {
+        low[i].table.Swap(high[i].table);
+        std::swap(low[i].expires, high[i].expires);
+        low[i].key_index.Swap(high[i].key_index);
+        low[i].prefix_stats.Swap(high[i].prefix_stats);
+        BumpAllVersions(low[i]);
+        BumpAllVersions(high[i]);
+    }
+}
+
+int Database::SetExpire(const std::string &key, int64_t when, ExpireCondition cond, bool &deleted) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    deleted = false;
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return 0;
+
+    int64_t current = obj->Expire();
+    bool has_expire = current > 0;
+    switch (cond) {
+        case ExpireNx:
+            if (has_expire)
+                return 0;
+            break;
+        case ExpireXx:
+            if (!has_expire)
+                return 0;
+            break;
+        case ExpireGt:
+            if (!has_expire || when <= current)
+                return 0;
+            break;
+        case ExpireLt:
+            if (has_expire && when >= current)
+                return 0;
+            break;
+        default:
+            break;
+    }
+
+    if (when <= CurrentTimeMs() && !Server::GetInstance()->IsReplica()) {
+        RedisObject old;
+        PopKey(shard, key, old);
+        LazyFree::GetInstance()->FreeObject(std::move(old), IsLazy(&RedisConfig::lazyfree_lazy_server_del));
+        deleted = true;
+        return 1;
+    }
+
+    obj->SetExpire(when);
+    shard.expires.Add(key, when);
+    return 1;
+}
+
+int64_t Database::GetTtlMs(const std::string &key) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    int64_t now = CurrentTimeMs();
+    auto obj = LookupKey(shard, key, now);
+    if (!obj)
+        return -2;
+
+    if (obj->Expire() <= 0)
+        return -1;
+
+    return std::max<int64_t>(obj->Expire() - now, 0);
+}
+
+int Database::Persist(const std::string &key) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj || obj->Expire() <= 0)
+        return 0;
+
+    /// the entry left in the expire index becomes stale
+    obj->SetExpire(0);
+    return 1;
+}
+
 int Database::SetConfig(RedisConfig *cfg) {
     rdb_cfg_ = cfg;
+    dbs_.resize(cfg->databases);
+    for (auto &db: dbs_) {
+        if (!db)
+            db = std::make_unique<Keyspace>();
+    }
+
+    if (cfg->tiered_max_memory > 0 && !ValueLog::GetInstance()->Open(cfg->dir_path, cfg->tiered_segment_size))
+        LOG_ERROR(TAG, "Cannot open the value log in %s, tiered storage disabled", cfg->dir_path.c_str());
 
     /// Onload new config
     std::string rdb_file_path = GetRdbPath();
@@ -89,7 +1412,7 @@ int Database::SetConfig(RedisConfig *cfg) {
     if (!file.exists() || !file.is_regular_file()) {
         // blank database 
         LOG_INFO(TAG, "RDB file %s does not exist, creating a new empty database.", rdb_file_path.c_str());
-        table_.clear();
+        FlushAll(false);
     } else {
         /// read rdb file + load data to the memory
         RdbParser::RdbParse *parse;
@@ -114,7 +1437,49 @@ int Database::SetConfig(RedisConfig *cfg) {
                 continue; // skip empty keys
             }
 
-            table_[key] = RdbParser::ResultMove(value);
+            RedisObject obj = rdb_cfg_ ? RedisObject::FromParsedResult(*value, rdb_cfg_->list_max_listpack_size,
+                                                                       rdb_cfg_->list_compress_depth)
+                                       : RedisObject::FromParsedResult(*value);
+            if (obj.Empty()) {
+                LOG_ERROR(TAG, "Skip key %s of unsupported type %s", key.c_str(), value->type.c_str());
+                continue;
+            }
+
+            if (rdb_cfg_ && rdb_cfg_->string_compression_threshold > 0)
+                obj.Compress(rdb_cfg_->string_compression_threshold);
+            /// the parser gives every hash as a map, the small ones go back to a listpack
+            if (rdb_cfg_ && obj.Type() == ObjHash)
+                obj.CompactHash(rdb_cfg_->hash_max_listpack_entries, rdb_cfg_->hash_max_listpack_value);
+            /// and every set as strings, the small ones of integers go back to an intset
+            if (rdb_cfg_ && obj.Type() == ObjSet)
+                obj.CompactSet(rdb_cfg_->set_max_intset_entries);
+
+            /// restore the access history saved with the key
+            if (rdb_cfg_ && IsLfuPolicy(rdb_cfg_->maxmemory_policy)) {
+                obj.SetLru((LfuTimeInMinutes() << 8) | std::min<uint32_t>(value->freq, 255));
+            } else {
+                obj.SetLru((LruClock() - value->idle) & LRU_CLOCK_MAX);
+            }
+
+            /// a master does not load the keys already expired, a replica keeps them until the master's DEL
+            if (obj.IsExpired(CurrentTimeMs()) && !Server::GetInstance()->IsReplica())
+                continue;
+
+            if (value->db_num >= dbs_.size()) {
+                LOG_ERROR(TAG, "Skip key %s of DB %u, only %d databases", key.c_str(), value->db_num, Databases());
+                continue;
+            }
+
+            ScopedDb scoped_db(static_cast<int>(value->db_num));
+            Shard &shard = ShardOf(key);
+            std::lock_guard lock(shard.m);
+            if (obj.Expire() > 0)
+                shard.expires.Add(key, obj.Expire());
+            if (UseKeyIndex())
+                shard.key_index.Insert(key);
+            if (UseKeyspaceStats())
+                AccountKey(shard, key, 1, AccountedBytes(key, obj));
+            shard.table.Set(key, std::move(obj));
         }
         delete parse;
     }
@@ -122,11 +1487,63 @@ int Database::SetConfig(RedisConfig *cfg) {
 }
 
 std::string Database::GetConfigFromName(const std::string &property) {
-    std::lock_guard lock(m_);
+    /// the config is only written at startup
     if (property == "dir") {
         return rdb_cfg_->dir_path;
     } else if (property == "dbfilename") {
         return rdb_cfg_->dbfilename;
+    } else if (property == "lazyfree-lazy-expire") {
+        return rdb_cfg_->lazyfree_lazy_expire ? "yes" : "no";
+    } else if (property == "lazyfree-lazy-server-del") {
+        return rdb_cfg_->lazyfree_lazy_server_del ? "yes" : "no";
+    } else if (property == "lazyfree-lazy-user-del") {
+        return rdb_cfg_->lazyfree_lazy_user_del ? "yes" : "no";
+    } else if (property == "lazyfree-lazy-user-flush") {
+        return rdb_cfg_->lazyfree_lazy_user_flush ? "yes" : "no";
+    } else if (property == "replica-lazy-flush") {
+        return rdb_cfg_->replica_lazy_flush ? "yes" : "no";
+    } else if (property == "lazyfree-lazy-eviction") {
+        return rdb_cfg_->lazyfree_lazy_eviction ? "yes" : "no";
+    } else if (property == "maxmemory") {
+        return std::to_string(rdb_cfg_->maxmemory);
+    } else if (property == "maxmemory-policy") {
+        return MaxMemoryPolicyName(rdb_cfg_->maxmemory_policy);
+    } else if (property == "maxmemory-samples") {
+        return std::to_string(rdb_cfg_->maxmemory_samples);
+    } else if (property == "lfu-log-factor") {
+        return std::to_string(rdb_cfg_->lfu_log_factor);
+    } else if (property == "lfu-decay-time") {
+        return std::to_string(rdb_cfg_->lfu_decay_time);
+    } else if (property == "key-index") {
+        return rdb_cfg_->key_index ? "yes" : "no";
+    } else if (property == "databases") {
+        return std::to_string(rdb_cfg_->databases);
+    } else if (property == "string-compression-threshold") {
+        return std::to_string(rdb_cfg_->string_compression_threshold);
+    } else if (property == "tiered-max-memory") {
+        return std::to_string(rdb_cfg_->tiered_max_memory);
+    } else if (property == "tiered-min-value-size") {
+        return std::to_string(rdb_cfg_->tiered_min_value_size);
+    } else if (property == "tiered-segment-size") {
+        return std::to_string(rdb_cfg_->tiered_segment_size);
+    } else if (property == "tiered-compact-percent") {
+        return std::to_string(rdb_cfg_->tiered_compact_percent);
+    } else if (property == "hotkeys-sample-rate") {
+        return std::to_string(rdb_cfg_->hotkeys_sample_rate);
+    } else if (property == "hotkeys-top-k") {
+        return std::to_string(rdb_cfg_->hotkeys_top_k);
+    } else if (property == "hash-max-listpack-entries") {
+        return std::to_string(rdb_cfg_->hash_max_listpack_entries);
+    } else if (property == "hash-max-listpack-value") {
+        return std::to_string(rdb_cfg_->hash_max_listpack_value);
+    } else if (property == "set-max-intset-entries") {
+        return std::to_string(rdb_cfg_->set_max_intset_entries);
+    } else if (property == "list-max-listpack-size") {
+        return std::to_string(rdb_cfg_->list_max_listpack_size);
+    } else if (property == "list-compress-depth") {
+        return std::to_string(rdb_cfg_->list_compress_depth);
+    } else if (property == "keyspace-stats-delimiter") {
+        return rdb_cfg_->keyspace_stats_delimiter;
     } else {
         return "";
     }
@@ -135,31 +1552,340 @@ std::string Database::GetConfigFromName(const std::string &property) {
 std::vector<std::string> Database::RetrieveKeysMatchPattern(const std::string &pattern) {
     std::vector<std::string> matched_keys;
 
-    std::lock_guard lock(m_);
-    for (auto &p: table_) {
-        std::string key = p.first;
-        if (matchGlob(key, pattern)) {
-            matched_keys.push_back(key);
+    GlobMatcher matcher(pattern);
+    int64_t now = CurrentTimeMs();
+    size_t visits = SIZE_MAX;
+    for (auto &shard: Shards()) {
+        std::lock_guard lock(shard.m);
+        if (UseKeyIndex() && !matcher.LiteralPrefix().empty()) {
+            CollectPrefixMatches(shard, matcher, "", now, "", SIZE_MAX, visits, matched_keys);
+            continue;
         }
+
+        shard.table.ForEach([&](Table::Entry &entry) {
+            if (!entry.value.IsExpired(now) && matcher.Match(entry.key)) {
+                matched_keys.push_back(entry.key);
+            }
+        });
     }
 
     return matched_keys;
 }
 
+std::string Database::CollectPrefixMatches(Shard &shard, const GlobMatcher &matcher, const std::string &type,
+                                           int64_t now, std::string_view after, size_t count, size_t &visits,
+                                           std::vector<std::string> &keys) {
+    bool prefix_only = matcher.IsPrefixPattern();
+    bool stopped = false;
+    std::string last(after);
+    shard.key_index.ForEachPrefix(matcher.LiteralPrefix(), after, [&](const std::string &key) {
+        /// only stop before a key, a walk ending right at the bound is done
+        if (keys.size() >= count || visits == 0) {
+            stopped = true;
+            return false;
+        }
+        --visits;
+        last = key;
+        if (!prefix_only && !matcher.Match(key))
+            return true;
+
+        auto obj = shard.table.Find(key);
+        if (!obj || obj->IsExpired(now))
+            return true;
+        if (!type.empty() && strcasecmp(type.c_str(), obj->TypeName()) != 0)
+            return true;
+        keys.push_back(key);
+        return true;
+    });
+    return stopped ? last : "";
+}
+
+uint64_t Database::SaveScanResume(std::string key) {
+    std::lock_guard lock(scan_resume_m_);
+    uint64_t token = ++scan_token_;
+    scan_resume_[token % DB_SCAN_RESUME_SLOTS] = {token, std::move(key)};
+    return token;
+}
+
+std::string Database::ScanResume(uint64_t token) {
+    std::lock_guard lock(scan_resume_m_);
+    auto &[saved, key] = scan_resume_[token % DB_SCAN_RESUME_SLOTS];
+    return (saved == token) ? key : "";
+}
+
+size_t Database::CountKeysWithPrefix(const std::string &prefix) {
+    size_t count = 0;
+    int64_t now = CurrentTimeMs();
+    for (auto &shard: Shards()) {
+        std::lock_guard lock(shard.m);
+        if (UseKeyIndex()) {
+            count += shard.key_index.CountPrefix(prefix);
+            continue;
+        }
+
+        shard.table.ForEach([&](Table::Entry &entry) {
+            if (entry.key.compare(0, prefix.size(), prefix) == 0 && !entry.value.IsExpired(now))
+                ++count;
+        });
+    }
+    return count;
+}
+
+uint64_t Database::Scan(uint64_t cursor, size_t count, const std::string &pattern, const std::string &type,
+                        std::vector<std::string> &keys) {
+    GlobMatcher matcher(pattern.empty() ? "*" : pattern);
+    int64_t now = CurrentTimeMs();
+    size_t max_iterations = count * SCAN_MAX_ITERATIONS_PER_KEY;
+    /// only from the start or a cursor of that walk, any other belongs to an iteration of the hash tables
+    if ((cursor == 0 || (cursor & DB_SCAN_INDEX_BIT)) && UseKeyIndex() && !matcher.LiteralPrefix().empty()) {
+        size_t idx = cursor >> DB_SCAN_SHARD_SHIFT;
+        uint64_t token = cursor & DB_SCAN_TOKEN_MASK;
+        std::string after = token ? ScanResume(token) : "";
+        while (idx < DB_SHARDS) {
+            std::string last;
+            {
+                Shard &shard = Shards()[idx];
+                std::lock_guard lock(shard.m);
+                last = CollectPrefixMatches(shard, matcher, type, now, after, count, max_iterations, keys);
+            }
+            if (!last.empty())
+                return (static_cast<uint64_t>(idx) << DB_SCAN_SHARD_SHIFT) | DB_SCAN_INDEX_BIT |
+                       SaveScanResume(std::move(last));
+
+            /// a stripe is only entered with room left, so the walk of a stripe stops after a key when it stops
+            after.clear();
+            if (++idx < DB_SHARDS && (keys.size() >= count || max_iterations == 0))
+                return (static_cast<uint64_t>(idx) << DB_SCAN_SHARD_SHIFT) | DB_SCAN_INDEX_BIT;
+        }
+        return 0;
+    }
+    /// the index went away during the walk, the stripes left are scanned from the start of their tables
+    if (cursor & DB_SCAN_INDEX_BIT)
+        cursor &= ~((UINT64_C(1) << DB_SCAN_SHARD_SHIFT) - 1);
+
+    auto collect = [&](Table::Entry &entry) {
+        /// the expired keys are left to the active expire cycle
+        if (entry.value.IsExpired(now))
+            return;
+        if (!type.empty() && strcasecmp(type.c_str(), entry.value.TypeName()) != 0)
+            return;
+        if (!matcher.Match(entry.key))
+            return;
+        keys.push_back(entry.key);
+    };
+
+    /// the stripes one after the other, each with the cursor of its own table
+    size_t idx = cursor >> DB_SCAN_SHARD_SHIFT;
+    cursor &= (UINT64_C(1) << DB_SCAN_SHARD_SHIFT) - 1;
+    while (idx < DB_SHARDS) {
+        {
+            Shard &shard = Shards()[idx];
+            std::lock_guard lock(shard.m);
+            do {
+                cursor = shard.table.Scan(cursor, collect);
+            } while (cursor != 0 && keys.size() < count && --max_iterations > 0);
+        }
+
+        if (cursor != 0)
+            return (static_cast<uint64_t>(idx) << DB_SCAN_SHARD_SHIFT) | cursor;
+
+        if (++idx == DB_SHARDS)
+            return 0;
+        if (keys.size() >= count || max_iterations == 0)
+            return static_cast<uint64_t>(idx) << DB_SCAN_SHARD_SHIFT;
+    }
+
+    return 0;
+}
+
+int Database::ScanCollection(const std::string &key, int type, uint64_t &cursor, size_t count,
+                             const std::string &pattern, std::vector<std::string> &elements) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    uint64_t next_cursor = 0;
+    if (!obj) {
+        cursor = 0;
+        return 0;
+    }
+
+    if (obj->Type() != type)
+        return WrongTypeError;
+
+    GlobMatcher matcher(pattern.empty() ? "*" : pattern);
+    auto matched = [&matcher](const std::string &s) { return matcher.Match(s); };
+    size_t max_iterations = count * SCAN_MAX_ITERATIONS_PER_KEY;
+    switch (obj->Encoding()) {
+        case EncHashTable: {
+            auto hash = obj->GetHash();
+            next_cursor = cursor;
+            do {
+                next_cursor = hash->Scan(next_cursor, [&](RedisObject::Hash::Entry &entry) {
+                    if (matched(entry.key)) {
+                        elements.push_back(entry.key);
+                        elements.push_back(entry.value);
+                    }
+                });
+            } while (next_cursor != 0 && elements.size() < count * 2 && --max_iterations > 0);
+            break;
+        }
+        case EncHashSet: {
+            auto set = obj->GetSet();
+            next_cursor = cursor;
+            do {
+                next_cursor = set->Scan(next_cursor, [&](RedisObject::Set::Entry &entry) {
+                    if (matched(entry.key))
+                        elements.push_back(entry.key);
+                });
+            } while (next_cursor != 0 && elements.size() < count && --max_iterations > 0);
+            break;
+        }
+        case EncListpack:
+            obj->HashForEach([&](std::string_view field, std::string_view value) {
+                if (matcher.Match(field)) {
+                    elements.emplace_back(field);
+                    elements.emplace_back(value);
+                }
+            });
+            break;
+        case EncIntset:
+            obj->SetForEach([&](std::string_view member) {
+                if (matcher.Match(member))
+                    elements.emplace_back(member);
+            });
+            break;
+        case EncTreeZset:
+            for (auto &[member, score]: *obj->GetZset()) {
+                if (matched(member)) {
+                    elements.push_back(member);
+                    elements.push_back(DoubleToString(score));
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    cursor = next_cursor;
+    return 0;
+}
+
 bool Database::IsKeyExist(const std::string &key) {
-    std::lock_guard lock(m_);
-    return table_.find(key) != table_.end();
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    return LookupKey(shard, key) != nullptr;
 }
 
 std::string Database::GetKeyType(const std::string &key) {
-    try {
-        auto &val = table_.at(key);
-        return val->type;
-    }
-    catch (const std::exception &e) {
-        LOG_ERROR("DB", "Not found key %s, ex %s", key.c_str(), e.what());
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto val = LookupKey(shard, key);
+    if (!val) {
+        LOG_ERROR("DB", "Not found key %s", key.c_str());
         return "none";
     }
+
+    return val->TypeName();
+}
+
+/// heap bytes of the key @param key and its value @param obj, the slot of the table excluded
+static size_t KeyHeapBytes(const std::string &key, const RedisObject &obj, size_t samples) {
+    return ZmallocStringSize(key) + obj.MemoryUsage(samples);
+}
+
+bool Database::KeyMemoryUsage(const std::string &key, size_t samples, size_t &bytes) {
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.m);
+    auto obj = LookupKey(shard, key);
+    if (!obj)
+        return false;
+
+    /// the slot and its control byte, then what the key owns
+    bytes = sizeof(Table::Entry) + 1 + KeyHeapBytes(key, *obj, samples);
+    /// the expire index keeps its own copy of the name
+    if (obj->Expire() > 0)
+        bytes += sizeof(ExpireIndex::Entry) + ZmallocStringSize(key);
+    return true;
+}
+
+std::string_view Database::KeyPrefix(std::string_view key) const {
+    size_t pos = key.find(rdb_cfg_->keyspace_stats_delimiter);
+    return (pos != std::string_view::npos) ? key.substr(0, pos) : std::string_view();
+}
+
+int64_t Database::AccountedBytes(const std::string &key, const RedisObject &obj) {
+    return static_cast<int64_t>(sizeof(Table::Entry) + 1 + KeyHeapBytes(key, obj, MEMORY_USAGE_SAMPLES));
+}
+
+void Database::CountPrefixOps(const std::vector<std::string_view> &keys, bool write) {
+    std::lock_guard lock(prefix_ops_m_);
+    for (auto key: keys) {
+        auto &usage = prefix_ops_.Of(KeyPrefix(key));
+        if (write)
+            ++usage.writes;
+        else
+            ++usage.reads;
+    }
+}
+
+PrefixStats::Map Database::GetPrefixStats() {
+    PrefixStats::Map total;
+    if (!UseKeyspaceStats())
+        return total;
+
+    for (auto &db: dbs_) {
+        for (auto &shard: db->shards) {
+            std::lock_guard lock(shard.m);
+            shard.prefix_stats.MergeInto(total);
+        }
+    }
+
+    std::lock_guard lock(prefix_ops_m_);
+    prefix_ops_.MergeInto(total);
+    return total;
+}
+
+KeyspaceMemory Database::GetKeyspaceMemory(int db) {
+    KeyspaceMemory mem;
+    thread_local std::minstd_rand rng(std::random_device{}());
+    for (auto &shard: dbs_[db]->shards) {
+        std::lock_guard lock(shard.m);
+        size_t size = shard.table.Size();
+        mem.keys += size;
+        mem.expires += shard.expires.Size();
+        mem.hashtable_bytes += shard.table.Capacity() * (sizeof(Table::Entry) + 1);
+        mem.expires_bytes += shard.expires.MemoryUsage();
+        if (size == 0)
+            continue;
+
+        std::array<size_t, OBJ_TYPES> keys{};
+        std::array<size_t, OBJ_TYPES> bytes{};
+        size_t sampled = 0;
+        auto account = [&](Table::Entry &entry) {
+            int type = entry.value.Type();
+            if (type >= OBJ_TYPES)
+                return false;
+            ++keys[type];
+            bytes[type] += KeyHeapBytes(entry.key, entry.value, MEMORY_USAGE_SAMPLES);
+            ++sampled;
+            return true;
+        };
+
+        if (size <= MEMORY_STATS_KEY_SAMPLES) {
+            shard.table.ForEach(account);
+        } else {
+            shard.table.Sample(rng(), MEMORY_STATS_KEY_SAMPLES, account);
+        }
+        if (sampled == 0)
+            continue;
+
+        double scale = static_cast<double>(size) / static_cast<double>(sampled);
+        for (int type = 0; type < OBJ_TYPES; ++type) {
+            mem.type_keys[type] += static_cast<size_t>(static_cast<double>(keys[type]) * scale + 0.5);
+            mem.type_bytes[type] += static_cast<size_t>(static_cast<double>(bytes[type]) * scale);
+        }
+    }
+    return mem;
 }
 
 bool Database::IsEqualConfig(const std::shared_ptr<RedisConfig> &cfg) const {
@@ -181,7 +1907,7 @@ std::string Database::GetRdbPath() const {
 }
 
 int Database::Reset() {
-    table_.clear();
+    FlushAll(IsLazy(&RedisConfig::replica_lazy_flush));
     return 0;
 }
 
@@ -205,8 +1931,17 @@ std::vector<std::pair<RdbParser::EntryID, RdbParser::EntryStream>>
 Database::GetStreamRange(const std::string &stream_key, const std::string &start_id, const std::string &end_id) {
     std::vector<std::pair<RdbParser::EntryID, RdbParser::EntryStream>> stream_range;
 
+    Shard &shard = ShardOf(stream_key);
+    std::lock_guard lock(shard.m);
     try {
-        auto &stream_entry = table_.at(stream_key)->stream;
+        auto val = LookupKey(shard, stream_key);
+        if (!val)
+            return stream_range;
+
+        if (val->Type() != ObjStream)
+            return stream_range;
+
+        auto &stream_entry = *val->GetStream();
         /// normalize start id
         RdbParser::EntryID start = RdbParser::BuildEntryId(start_id, 0);
         RdbParser::EntryID end = RdbParser::BuildEntryId(end_id, INT64_MAX);
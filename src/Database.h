@@ -5,31 +5,280 @@
 #ifndef REDIS_STARTER_CPP_DATABASE_H
 #define REDIS_STARTER_CPP_DATABASE_H
 
+#include <array>
+#include <atomic>
 #include <unordered_map>
 #include <mutex>
 #include <memory>
+#include <random>
+#include <span>
 
 #include "all.hpp"
+#include "Dict.h"
+#include "Evict.h"
+#include "ExpireIndex.h"
+#include "GlobMatcher.hpp"
+#include "KeyIndex.h"
+#include "KeyspaceStats.h"
+#include "RedisObject.h"
 #include "RedisOption.h"
+#include "SeqMutex.h"
+#include "ValueLog.h"
 #include "rdbparse.h"
 
+/// keys sampled per stripe by Database::GetKeyspaceMemory(), the smaller stripes are walked entirely
+#define MEMORY_STATS_KEY_SAMPLES 64
+/// elements sampled per collection by MEMORY USAGE without SAMPLES, and by Database::GetKeyspaceMemory()
+#define MEMORY_USAGE_SAMPLES 5
+
+/// the memory of one logical database, as reported by MEMORY STATS
+typedef struct KeyspaceMemory {
+    size_t keys = 0;
+    size_t expires = 0;
+    size_t hashtable_bytes = 0;                     /// slots and control bytes of the hash tables
+    size_t expires_bytes = 0;                       /// the expire indexes
+    std::array<size_t, OBJ_TYPES> type_keys{};      /// keys of every type, estimated from samples
+    std::array<size_t, OBJ_TYPES> type_bytes{};     /// heap bytes of the key names and values of every type, estimated
+} KeyspaceMemory;
+
+/// condition of Database::SetExpire(), as the NX | XX | GT | LT option of EXPIRE
+enum ExpireCondition {
+    ExpireAlways = 0,
+    ExpireNx = 1,       /// only when the key has no expiry
+    ExpireXx = 2,       /// only when the key has an expiry
+    ExpireGt = 3,       /// only when the new expiry is greater than the current one, no expiry counts as infinite
+    ExpireLt = 4,       /// only when the new expiry is less than the current one
+};
+
+/// number of lock stripes of the keyspace, a power of two
+#define DB_SHARD_BITS 4
+#define DB_SHARDS (1 << DB_SHARD_BITS)
+/// a SCAN cursor keeps the shard in its top bits, and the cursor of the shard's table below
+#define DB_SCAN_SHARD_SHIFT (64 - DB_SHARD_BITS)
+/// set in a SCAN cursor walking the key index, no table cursor reaches that bit. The bits below it are the token of
+/// the key the walk of the stripe resumes after, 0 for the start of the stripe
+#define DB_SCAN_INDEX_BIT (UINT64_C(1) << (DB_SCAN_SHARD_SHIFT - 1))
+#define DB_SCAN_TOKEN_MASK (DB_SCAN_INDEX_BIT - 1)
+/// resume keys of the key index SCAN kept at once, a new one overwrites the oldest
+#define DB_SCAN_RESUME_SLOTS 1024
+/// lock-free tries of a GET before it takes the stripe lock
+#define DB_CONCURRENT_READ_ATTEMPTS 4
+/// WATCH version counters per stripe, a key maps to one of them by the low bits of its hash
+#define DB_WATCH_SLOTS 64
+/// records of the segment being compacted handed to the value log per cron at most
+#define DB_COMPACT_BATCH 256
+
+/*
+ * The logical databases (SELECT 0 .. databases - 1). Each one is split into DB_SHARDS stripes by the top bits of the
+ * key hash, and each stripe has its own mutex, hash table, expire index and key index, so commands on keys of
+ * different stripes never contend.
+ *
+ * The key operations work on the database selected on the calling thread, see SelectDb(). The executor selects the
+ * database of the client before running its command.
+ *
+ * Lock ordering, to stay free of deadlocks:
+ * - a single key operation only holds the lock of the stripe of its key.
+ * - an operation holding several stripe locks takes them in increasing (database, stripe) order: LockShards() for
+ *   the keys of a multi-key command, MoveKey() and SwapDb() across two databases, FlushAll() for all of them.
+ * - evict_m_ is taken before any stripe lock, never while holding one.
+ *
+ * GET reads a stripe without its lock when it can (ReadStringConcurrent()): the stripe mutex is a SeqMutex, and the
+ * memory a reader may still go through once a writer unlinked it, the tables, the key buffers and the string buffers,
+ * is freed through Epoch.
+ * */
 class Database {
 private:
     using VString = std::vector<std::string>;
+    using Table = Dict<RedisObject>;
+
+    typedef struct Shard {
+        SeqMutex m;                         /// readers of GET may go without it, see ReadStringConcurrent()
+        Table table;
+        ExpireIndex expires;                /// deadlines of the keys with an expire time, drained by ActiveExpireCycle()
+        KeyIndex key_index;                 /// the key names in order, only kept with key-index yes
+        /// bumped on every change of a key of the slot, WATCH compares them instead of the values
+        std::array<std::atomic<uint64_t>, DB_WATCH_SLOTS> versions{};
+        PrefixStats prefix_stats;           /// keys and bytes per key prefix, only kept with keyspace-stats-delimiter
+    } Shard;
 
-    static Database *instance_;
+    /// one logical database
+    typedef struct Keyspace {
+        std::array<Shard, DB_SHARDS> shards;
+    } Keyspace;
 
-    Database() = default;
+    Database();
 
-    std::map<std::string, std::shared_ptr<RdbParser::ParsedResult>> table_;
+    std::vector<std::unique_ptr<Keyspace>> dbs_;
+    static thread_local int selected_db_;   /// the database of the command running on this thread
+
+    std::mutex evict_m_;                    /// guards evict_pool_ and rng_
+    EvictionPool evict_pool_;
+    std::mt19937_64 rng_;
+    std::atomic<size_t> stat_evicted_keys_ = 0;
+    std::atomic<int> expire_shard_ = 0;     /// the stripe (over all the databases) the next active expire cycle starts with
+    std::atomic<size_t> stat_spilled_values_ = 0;
+    std::atomic<size_t> stat_loaded_values_ = 0;    /// spilled values read back into memory
+    std::atomic<size_t> spills_in_flight_ = 0;      /// values handed to the value log, not in their stubs yet
+    int compact_stripe_ = -1;               /// stripe (over all the databases) the compaction of compact_segment_ is at, -1 when idle
+    uint64_t compact_cursor_ = 0;           /// Scan() cursor of the table of compact_stripe_
+    uint32_t compact_segment_ = 0;
+    std::atomic<size_t> relocations_in_flight_ = 0; /// records of compact_segment_ handed to the value log, not relocated yet
+    std::mutex scan_resume_m_;              /// guards scan_resume_ and scan_token_
+    std::array<std::pair<uint64_t, std::string>, DB_SCAN_RESUME_SLOTS> scan_resume_{};  /// token and resume key of the
+                                                                                        /// key index SCAN, by token
+    uint64_t scan_token_ = 0;               /// last token handed out, they stay far below DB_SCAN_INDEX_BIT
+    std::mutex prefix_ops_m_;               /// guards prefix_ops_, the commands count their keys without stripe locks
+    PrefixStats prefix_ops_;                /// reads and writes per key prefix, over all the databases
     int version_;
-    static std::mutex m_;
 
-    RedisConfig *rdb_cfg_;
+    RedisConfig *rdb_cfg_ = nullptr;
 
 private:
     bool IsEqualConfig(const std::shared_ptr<RedisConfig> &cfg) const;
 
+    static size_t ShardIndex(uint64_t hash) { return hash >> (64 - DB_SHARD_BITS); }
+
+    /// the stripes of the selected database
+    std::array<Shard, DB_SHARDS> &Shards() { return dbs_[selected_db_]->shards; }
+
+    Shard &ShardOf(std::string_view key) { return Shards()[ShardIndex(Table::Hash(key))]; }
+
+    /// lock the stripes of every @param step -th element of @param keys in the selected database, in increasing
+    /// stripe index and each one once
+    std::vector<std::unique_lock<SeqMutex>> LockShards(std::span<const std::string> keys, size_t step = 1);
+
+    /// find the value of a live key, must hold shard.m.
+    /// An expired key is reported as missing, the master also deletes it and propagates the DEL
+    RedisObject *LookupKey(Shard &shard, const std::string &key, int64_t now);
+
+    RedisObject *LookupKey(Shard &shard, const std::string &key) { return LookupKey(shard, key, CurrentTimeMs()); }
+
+    bool UseKeyIndex() const { return rdb_cfg_ && rdb_cfg_->key_index; }
+
+    bool UseTieredStorage() const {
+        return rdb_cfg_ && rdb_cfg_->tiered_max_memory > 0 && ValueLog::GetInstance()->IsOpen();
+    }
+
+    /// read back the spilled value of @param key into its stub @param obj of @param shard, on the calling thread.
+    /// Must hold shard.m
+    bool LoadSpilledValue(Shard &shard, RedisObject &obj, const std::string &key);
+
+    /// put the value of @param key of database @param db read back at @param location into its stub, unless the stub
+    /// was deleted, moved or relocated since. Called on the thread of the value log
+    void InstallSpilledValue(int db, const std::string &key, uint64_t location, int encoding,
+                             std::string_view payload);
+
+    /// turn @param key of database @param db into a stub of the record at @param location, of @param len bytes, where
+    /// its value of @param encoding was written as @param payload, unless the value changed since. Called on the thread
+    /// of the value log
+    void InstallSpill(int db, const std::string &key, int encoding, std::string_view payload, uint64_t location,
+                      uint32_t len);
+
+    /// copy the record at @param location, of @param len bytes, of @param key of database @param db to the active
+    /// segment and point its stub at the copy, unless the stub was deleted, loaded back or relocated since. Called on
+    /// the thread of the value log
+    void RelocateSpilledValue(int db, const std::string &key, uint64_t location, uint32_t len);
+
+    /// remove @param key from the keyspace and move its value to @param obj. Return false if it did not exist.
+    /// Must hold shard.m
+    bool PopKey(Shard &shard, const std::string &key, RedisObject &obj);
+
+    /// a key of @param shard with @param hash changed, the transactions watching its slot fail
+    static void BumpVersion(Shard &shard, uint64_t hash) {
+        shard.versions[hash % DB_WATCH_SLOTS].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// every key of @param shard changed, by a flush or a swap of databases
+    static void BumpAllVersions(Shard &shard) {
+        for (auto &version: shard.versions)
+            version.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// the keys of @param shard are accounted per prefix in its prefix_stats
+    bool UseKeyspaceStats() const { return rdb_cfg_ && !rdb_cfg_->keyspace_stats_delimiter.empty(); }
+
+    /// the part of @param key before the first keyspace-stats-delimiter, empty when it has none
+    std::string_view KeyPrefix(std::string_view key) const;
+
+    /// the bytes accounted to the prefix of @param key for its value @param obj: its slot, name and value, as MEMORY
+    /// USAGE reports them without the expire entry. The same object always gives the same estimate, so the deltas
+    /// added up by AccountKey() do not drift
+    static int64_t AccountedBytes(const std::string &key, const RedisObject &obj);
+
+    /// add @param keys and @param bytes to the prefix of @param key in @param shard. Must hold shard.m
+    void AccountKey(Shard &shard, const std::string &key, int64_t keys, int64_t bytes) {
+        auto &usage = shard.prefix_stats.Of(KeyPrefix(key));
+        usage.keys += keys;
+        usage.bytes += bytes;
+    }
+
+    /// remove an expired key and propagate its deletion to the slaves, must hold shard.m
+    void DeleteExpiredKey(Shard &shard, const std::string &key);
+
+    /// DEL of @param key, expired or not, freed in the background with @param lazy. Return true if it existed and was
+    /// not expired at @param now. Must hold shard.m
+    bool PopUserKey(Shard &shard, const std::string &key, int64_t now, bool lazy);
+
+    /// insert or overwrite @param key, an overwritten value is freed according to lazyfree-lazy-server-del.
+    /// Must hold shard.m
+    void SetKey(Shard &shard, const std::string &key, RedisObject &&obj);
+
+    /// set the LRU clock or the LFU counter of a new object
+    void InitLru(RedisObject &obj) const;
+
+    /// record an access to @param obj for the eviction policy
+    void TouchKey(RedisObject &obj) const { obj.SetLru(AccessedLru(obj)); }
+
+    /// the LRU clock or the LFU counter of @param obj once an access is recorded
+    uint32_t AccessedLru(const RedisObject &obj) const;
+
+    /// GET of @param key from @param shard without its lock, see SeqMutex. Return false when it needs the lock: a
+    /// writer kept getting in the way, or the read must change the key (expire it, load it back, record the access)
+    bool ReadStringConcurrent(Shard &shard, const std::string &key, std::string &value);
+
+    /// the score of @param obj for the eviction policy, the higher the better candidate
+    uint64_t EvictionScore(const RedisObject &obj, int policy) const;
+
+    /// sample a random stripe of a random database and refill evict_pool_ with the best candidates, must hold evict_m_
+    void EvictionPoolPopulate(int policy);
+
+    /// pick the key to evict next and set @param db to its database, empty when there is nothing left to evict.
+    /// Must hold evict_m_
+    std::string SelectEvictionKey(int policy, int &db);
+
+    /// set @param field of @param hash, converting it to a hashtable past the hash-max-listpack-* thresholds.
+    /// Return true if the field is new
+    bool SetHashField(RedisObject &hash, std::string_view field, std::string_view value) const;
+
+    /// add @param member to @param set, converting it to a hashtable past set-max-intset-entries. Return true if the
+    /// member is new
+    bool AddSetMember(RedisObject &set, std::string_view member) const;
+
+    /// an empty list, of nodes per list-max-listpack-size and list-compress-depth
+    RedisObject CreateListValue() const;
+
+    /// a string value, LZF compressed when it reaches string-compression-threshold. Called before taking the stripe
+    /// lock, compressing costs a few ms per MB
+    RedisObject CreateStringValue(std::string_view val) const;
+
+    /// discard the content of @param shard, in the background with @param async. Must hold shard.m
+    static void FlushShard(Shard &shard, bool async);
+
+    /// walk the key index of @param shard under the literal prefix of @param matcher, from the key after @param after
+    /// (empty for the first one), and collect the live keys matching it and of type @param type (empty means any)
+    /// into @param keys, in order. Stop once @param keys holds @param count keys or @param visits, decreased by every
+    /// key looked at, drops to 0: return the last one looked at then, the walk resumes after it. Return an empty
+    /// string once the prefix is done. Must hold shard.m
+    std::string CollectPrefixMatches(Shard &shard, const GlobMatcher &matcher, const std::string &type, int64_t now,
+                                     std::string_view after, size_t count, size_t &visits,
+                                     std::vector<std::string> &keys);
+
+    /// keep @param key for a SCAN of the key index to resume after, return the token of the cursor
+    uint64_t SaveScanResume(std::string key);
+
+    /// the key saved under @param token, empty when it was overwritten since
+    std::string ScanResume(uint64_t token);
+
 public:
 
     Database &operator=(const Database &rhs) = delete;
@@ -38,16 +287,179 @@ public:
 
     static Database *GetInstance();
 
+    /// number of logical databases
+    int Databases() const { return static_cast<int>(dbs_.size()); }
+
+    /// select the database the key operations of the calling thread work on, @param db must be valid
+    static void SelectDb(int db) { selected_db_ = db; }
+
+    static int SelectedDb() { return selected_db_; }
+
+    /// MOVE: move @param key of the selected database to @param db, with its expire time.
+    /// Return 1 if moved, 0 if the key does not exist or already exists in @param db
+    int MoveKey(const std::string &key, int db);
+
+    /// SWAPDB: exchange the datasets of @param db1 and @param db2 in O(1), no key is copied
+    void SwapDb(int db1, int db2);
+
+    /// whether the lazy free option @param opt of the config is enabled
+    bool IsLazy(bool RedisConfig::*opt) const { return rdb_cfg_ && rdb_cfg_->*opt; }
+
+    /// discard the whole dataset before a full sync, in the background if replica-lazy-flush
     int Reset();
 
+    /// discard the datasets of all databases. With @param async the tables are detached in O(1) and freed in the
+    /// background
+    void FlushAll(bool async);
+
+    /// FLUSHDB: discard the dataset of the selected database only
+    void FlushDb(bool async);
+
     int SetConfig(RedisConfig *cfg);
 
     std::string GetConfigFromName(const std::string &property);
 
-    void SetKeyVal(const std::string &key, const std::string &val, int on_exist, int64_t expired_ts);
+    /// @param keep_ttl: keep the expire time of the existing key instead of @param expired_ts
+    void SetKeyVal(const std::string &key, const std::string &val, int on_exist, int64_t expired_ts,
+                   bool keep_ttl = false);
+
+    /// add @param delta to the integer at @param key, a missing key counts as 0. The new value is set to @param result
+    int IncrBy(const std::string &key, int64_t delta, int64_t &result);
+
+    /// same as IncrBy() with a floating point increment. The formatted new value is set to @param result
+    int IncrByFloat(const std::string &key, long double delta, std::string &result);
 
     std::string RetrieveValueOfKey(const std::string &key);
 
+    /// HSET: set the @param pairs (field, value, field, value ...) of the hash at @param key, created when missing.
+    /// Return the number of new fields, or WrongTypeError
+    int HashSet(const std::string &key, std::span<const std::string> pairs);
+
+    /// HDEL: remove @param fields from the hash at @param key, the key goes away with its last field.
+    /// Return the number of removed fields, or WrongTypeError
+    int HashDelete(const std::string &key, std::span<const std::string> fields);
+
+    /// HINCRBY: add @param delta to the integer in @param field of the hash at @param key, a missing field counting
+    /// as 0. The new value is set to @param result
+    int HashIncrBy(const std::string &key, const std::string &field, int64_t delta, int64_t &result);
+
+    /// LPUSH, RPUSH: push @param elements in turn at the head or the tail of the list at @param key, created when
+    /// missing. Return the new length, or WrongTypeError
+    int64_t ListPush(const std::string &key, std::span<const std::string> elements, bool head);
+
+    /// LPOP, RPOP: pop up to @param count elements from the head or the tail of the list at @param key into
+    /// @param elements, the key goes away with its last element. Return 1, 0 if the key does not exist, or
+    /// WrongTypeError
+    int ListPop(const std::string &key, size_t count, bool head, std::vector<std::string> &elements);
+
+    /// LTRIM: keep only the elements from @param start to @param stop included of the list at @param key, negative
+    /// indexes counting from the tail. An empty range removes the key. Return 0 or WrongTypeError
+    int ListTrim(const std::string &key, int64_t start, int64_t stop);
+
+    /// LMOVE, BLMOVE: pop an element from the head or the tail of the list at @param src into @param element, and
+    /// push it to the head or the tail of the list at @param dst, created when missing. Return 1, 0 if @param src
+    /// does not exist, or WrongTypeError if either key is not a list
+    int ListMove(const std::string &src, const std::string &dst, bool from_head, bool to_head, std::string &element);
+
+    /// SADD: add @param members to the set at @param key, created when missing. Return the number of new members, or
+    /// WrongTypeError
+    int SetAdd(const std::string &key, std::span<const std::string> members);
+
+    /// SREM: remove @param members from the set at @param key, the key goes away with its last member. Return the
+    /// number of removed members, or WrongTypeError
+    int SetRemove(const std::string &key, std::span<const std::string> members);
+
+    /// the read commands of the collections (HGET, LRANGE ...): call @param fn with the value at @param key, nullptr
+    /// when it does not exist, under the lock of its stripe. Return WrongTypeError, without calling @param fn, if it
+    /// is not of @param type
+    int ReadObject(const std::string &key, int type, const std::function<void(const RedisObject *)> &fn);
+
+    /// the read commands over several keys (SINTER, SUNION ...): call @param fn with the values at @param keys in
+    /// their order, nullptr for the missing ones, under the locks of their stripes. Return WrongTypeError, without
+    /// calling @param fn, if one of them is not of @param type
+    int ReadObjects(std::span<const std::string> keys, int type,
+                    const std::function<void(const std::vector<const RedisObject *> &)> &fn);
+
+    /// the version of @param key in database @param db, for WATCH. It changes whenever the key changes, and
+    /// sometimes when a key sharing its version slot does
+    uint64_t KeyVersion(int db, std::string_view key);
+
+    /// a command changed @param key of the selected database, the transactions watching it fail
+    void SignalModifiedKey(std::string_view key);
+
+    bool KeyspaceStatsEnabled() const { return UseKeyspaceStats(); }
+
+    /// count an access to each of @param keys by a command, as a write with @param write
+    void CountPrefixOps(const std::vector<std::string_view> &keys, bool write);
+
+    /// KEYSPACE-STATS: the counters of every key prefix, over all the databases. They are kept up to date as the keys
+    /// change, so this costs the number of prefixes and not of keys
+    PrefixStats::Map GetPrefixStats();
+
+    /// hint that @param keys are about to be looked up, so their memory could be loaded ahead of the lookups
+    void PrefetchKeys(const std::vector<std::string_view> &keys);
+
+    /// move the keyspace towards its resized table for at most @param ms milliseconds, called from the server cron
+    int ActiveRehash(int ms);
+
+    /// evict keys per maxmemory-policy until the used memory is under maxmemory, called before every command.
+    /// Return OutOfMemoryError when the memory is still over the limit and nothing can be evicted
+    int PerformEvictions();
+
+    size_t EvictedKeys() const { return stat_evicted_keys_; }
+
+    /// delete the keys whose expire time passed, for at most @param ms milliseconds. Return the number of deleted keys
+    int ActiveExpireCycle(int ms);
+
+    /// tiered storage: pick the coldest string values (by LFU with an LFU policy, by idle time otherwise) until the
+    /// used memory would be under tiered-max-memory, for at most @param ms milliseconds, and hand them to the value
+    /// log. They become stubs once written, the next call waits for that. Return the number of values handed over
+    int SpillColdValues(int ms);
+
+    /// one step of the compaction of the value log, called from the server cron: scan the stripes for the live records
+    /// of the segment being compacted for at most @param ms milliseconds, and hand them to the value log to be copied.
+    /// The segment goes away with its last live record; one whose stub escaped the pass (MOVE, SWAPDB) is picked
+    /// again later. Return the number of records handed over
+    int CompactValueLog(int ms);
+
+    /// start reading back, in the background, the spilled values of the @param keys of the selected database.
+    /// @param done is called on the thread of the value log once they are in the keyspace again.
+    /// Return false, and @param done is never called, when none of the keys is spilled
+    bool LoadSpilledKeys(const std::vector<std::string_view> &keys, std::function<void()> done);
+
+    size_t SpilledValues() const { return stat_spilled_values_; }
+
+    size_t LoadedValues() const { return stat_loaded_values_; }
+
+    /// return true if @param key existed and was deleted. With @param lazy a big value is freed in the background
+    bool DeleteKey(const std::string &key, bool lazy);
+
+    /// DEL: delete @param key, lazily when lazyfree-lazy-user-del
+    bool DeleteKey(const std::string &key) { return DeleteKey(key, IsLazy(&RedisConfig::lazyfree_lazy_user_del)); }
+
+    /// delete all of @param keys at once, no other command sees only some of them deleted. Return the number of
+    /// deleted keys
+    int DeleteKeys(const std::vector<std::string> &keys, bool lazy);
+
+    /// MGET: call @param fn with the value of every one of @param keys in order, nullptr when the key does not exist
+    /// or is not a string. The stripes of the keys are locked once for the whole call
+    void MultiGet(std::span<const std::string> keys, const std::function<void(const RedisObject *)> &fn);
+
+    /// MSET / MSETNX: set the @param pairs (key, value, key, value ...) at once, no other command sees only some of
+    /// them set. With @param nx nothing is set if any key exists. Return whether the keys were set
+    bool MultiSet(std::span<const std::string> pairs, bool nx);
+
+    /// set the absolute expire time @param when in ms of @param key if @param cond holds.
+    /// A time in the past deletes the key, @param deleted is then set to true.
+    /// Return 1 if the expire time was set (or the key deleted), 0 otherwise
+    int SetExpire(const std::string &key, int64_t when, ExpireCondition cond, bool &deleted);
+
+    /// remaining time to live of @param key in ms, -2 if the key does not exist, -1 if it has no expire time
+    int64_t GetTtlMs(const std::string &key);
+
+    /// remove the expire time of @param key. Return 1 if it had one, 0 otherwise
+    int Persist(const std::string &key);
+
     int XAdd(const VString &argv, RdbParser::EntryID &entry_id);
 
     std::vector<std::pair<RdbParser::EntryID, RdbParser::EntryStream>>
@@ -55,8 +467,37 @@ public:
 
     std::vector<std::string> RetrieveKeysMatchPattern(const std::string &pattern);
 
+    /// One SCAN call: visit the keyspace from @param cursor until about @param count keys were collected into
+    /// @param keys, or count * SCAN_MAX_ITERATIONS_PER_KEY home groups were visited. Only the keys matching
+    /// @param pattern and of type @param type are kept, empty means any. Return the next cursor, 0 when done.
+    /// With key-index, a new iteration over a pattern starting with a literal prefix only walks the keys with that
+    /// prefix, in order within a stripe, with the same bounds. Its cursor keeps the stripe and a token of the key to
+    /// resume after; a token whose key was overwritten by newer walks restarts the stripe, so keys may come twice
+    uint64_t Scan(uint64_t cursor, size_t count, const std::string &pattern, const std::string &type,
+                  std::vector<std::string> &keys);
+
+    /// One HSCAN / SSCAN / ZSCAN call: the elements of the collection at @param key matching @param pattern,
+    /// flattened as they are replied (field value, member, member score). The hashtables of sets and hashes are
+    /// visited from @param cursor with the bounds of Scan(), and @param cursor is set to the next one. The listpacks,
+    /// intsets and sorted sets are returned whole with cursor 0, as Redis does for its compact encodings.
+    /// Return WrongTypeError if @param key is not of @param type
+    int ScanCollection(const std::string &key, int type, uint64_t &cursor, size_t count, const std::string &pattern,
+                       std::vector<std::string> &elements);
+
+    /// number of keys starting with @param prefix. With key-index it costs the length of the prefix, but also counts
+    /// the keys which expired and were not reclaimed yet, as DBSIZE does
+    size_t CountKeysWithPrefix(const std::string &prefix);
+
     bool IsKeyExist(const std::string &key);
 
+    /// MEMORY USAGE: bytes of @param key, its slot, name, value and expire entry, a collection being extrapolated from
+    /// @param samples of its elements (0 means all). Return false if the key does not exist
+    bool KeyMemoryUsage(const std::string &key, size_t samples, size_t &bytes);
+
+    /// the memory of database @param db. Nothing is maintained per key for it: the stripes up to
+    /// MEMORY_STATS_KEY_SAMPLES keys are walked, the bigger ones extrapolated from that many sampled keys
+    KeyspaceMemory GetKeyspaceMemory(int db);
+
     std::string GetKeyType(const std::string &key);
 
     [[nodiscard]] std::string GetRdbPath() const;
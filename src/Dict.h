@@ -0,0 +1,607 @@
+//
+// Created by Manh Nguyen Viet on 9/6/25.
+//
+
+#ifndef REDIS_CRAFT_DICT_H
+#define REDIS_CRAFT_DICT_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Epoch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// number of slots probed together, one SSE2 register of control bytes
+#define DICT_GROUP_WIDTH 16
+/// smallest table, in slots
+#define DICT_MIN_CAPACITY 16
+/// groups moved from the old table to the new one on every mutation while rehashing
+#define DICT_REHASH_GROUPS_PER_STEP 1
+/// Sample() visits at most this many slots per wanted entry
+#define DICT_SAMPLE_MAX_STEPS 10
+
+/*
+ * Open-addressing hash table with Swiss-table style control bytes.
+ *
+ * Every slot owns one control byte: EMPTY, DELETED or the low 7 bits of the key hash (H2). The remaining bits (H1)
+ * choose the home group, and a lookup compares H2 against a whole group of 16 control bytes at once, so a miss
+ * usually costs one cache line. Groups are probed linearly, which keeps every key between its home group and the
+ * first group that still has an EMPTY slot; Scan() relies on that.
+ *
+ * Like the Redis dict, resizing is incremental: a resize allocates the new table and every mutation (plus
+ * RehashMilliseconds() from the server cron) moves a few groups over, so a resize never stalls the loop.
+ *
+ * FindConcurrent() serves readers that do not hold the lock of the writers. For them the tables and the key buffers
+ * of erased entries are retired through Epoch rather than freed.
+ * */
+template<typename V>
+class Dict {
+public:
+    struct Entry {
+        std::string key;
+        V value;
+    };
+
+private:
+    static constexpr int8_t kEmpty = -128;
+    static constexpr int8_t kDeleted = -2;
+
+    /// a concurrent reader may still be probing a table that was replaced
+    struct RetireArray {
+        template<typename T>
+        void operator()(T *p) const { Epoch::RetireArray(p); }
+    };
+
+    struct Table {
+        std::unique_ptr<int8_t[], RetireArray> ctrl;
+        std::unique_ptr<Entry[], RetireArray> slots;
+        size_t capacity = 0;    /// number of slots, 0 or a power of two >= DICT_GROUP_WIDTH
+        size_t size = 0;        /// number of full slots
+        size_t deleted = 0;     /// number of tombstones
+
+        explicit Table(size_t cap = 0) : capacity(cap) {
+            if (cap > 0) {
+                ctrl.reset(new int8_t[cap]);
+                std::memset(ctrl.get(), kEmpty, cap);
+                slots.reset(new Entry[cap]);
+            }
+        }
+
+        size_t GroupMask() const { return (capacity / DICT_GROUP_WIDTH) - 1; }
+
+        size_t Groups() const { return capacity / DICT_GROUP_WIDTH; }
+
+        /// maximum of full + deleted slots before the table needs to be resized
+        size_t MaxLoad() const { return capacity - capacity / 8; }
+    };
+
+public:
+    Dict() = default;
+
+    Dict(const Dict &) = delete;
+
+    Dict &operator=(const Dict &) = delete;
+
+    Dict(Dict &&) noexcept = default;
+
+    Dict &operator=(Dict &&) noexcept = default;
+
+    static uint64_t Hash(std::string_view key) {
+        return std::hash<std::string_view>{}(key);
+    }
+
+    size_t Size() const { return tables_[0].size + tables_[1].size; }
+
+    bool Empty() const { return Size() == 0; }
+
+    bool IsRehashing() const { return tables_[1].capacity > 0; }
+
+    /// total slots of both tables
+    size_t Capacity() const { return tables_[0].capacity + tables_[1].capacity; }
+
+    V *Find(std::string_view key) {
+        return Find(key, Hash(key));
+    }
+
+    V *Find(std::string_view key, uint64_t hash) {
+        Entry *entry = FindEntry(key, hash);
+        return entry ? &entry->value : nullptr;
+    }
+
+    Entry *FindEntry(std::string_view key) {
+        return FindEntry(key, Hash(key));
+    }
+
+    Entry *FindEntry(std::string_view key, uint64_t hash) {
+        for (int t = IsRehashing() ? 1 : 0; t >= 0; --t) {
+            size_t idx = FindIndex(tables_[t], key, hash);
+            if (idx != npos) {
+                return &tables_[t].slots[idx];
+            }
+        }
+        return nullptr;
+    }
+
+    /// Find() for a reader not holding the lock the writers of the dict take. The reader saw the count of that lock
+    /// before the call and @param validate() tells whether it is unchanged; every pointer read from the tables is only
+    /// followed after a validation, as a writer may be moving things under the reader. @param valid is set to false
+    /// when a validation failed: the result means nothing and the caller retries. The returned value was in the table
+    /// at the last validation, and must be validated again once read
+    template<typename Validate>
+    const V *FindConcurrent(std::string_view key, Validate &&validate, bool &valid) const {
+        uint64_t hash = Hash(key);
+        valid = false;
+
+        /// the layout of both tables first, a torn one would send the probe out of the arrays
+        size_t capacity[2];
+        const int8_t *ctrl[2];
+        const Entry *slots[2];
+        for (int t = 0; t < 2; ++t) {
+            capacity[t] = tables_[t].capacity;
+            ctrl[t] = tables_[t].ctrl.get();
+            slots[t] = tables_[t].slots.get();
+        }
+        if (!validate())
+            return nullptr;
+
+        for (int t = 1; t >= 0; --t) {
+            if (capacity[t] == 0)
+                continue;
+
+            size_t mask = capacity[t] / DICT_GROUP_WIDTH - 1;
+            size_t group = H1(hash) & mask;
+            for (size_t probes = 0; probes <= mask; ++probes) {
+                const int8_t *group_ctrl = ctrl[t] + group * DICT_GROUP_WIDTH;
+                uint32_t match = MatchByte(group_ctrl, H2(hash));
+                while (match) {
+                    const Entry &entry = slots[t][group * DICT_GROUP_WIDTH + __builtin_ctz(match)];
+                    size_t size = entry.key.size();
+                    const char *data = entry.key.data();
+                    if (size == key.size()) {
+                        if (!validate())
+                            return nullptr;
+                        if (std::memcmp(data, key.data(), size) == 0) {
+                            valid = true;
+                            return &entry.value;
+                        }
+                    }
+                    match &= match - 1;
+                }
+
+                if (MatchByte(group_ctrl, kEmpty))
+                    break;
+                group = (group + 1) & mask;
+            }
+        }
+
+        valid = validate();
+        return nullptr;
+    }
+
+    bool Contains(std::string_view key) {
+        return FindEntry(key) != nullptr;
+    }
+
+    /// insert @param key with @param value if it does not exist yet. Return the value in the table, and whether it
+    /// was inserted. The value of an existing key is left untouched
+    std::pair<V *, bool> Emplace(std::string_view key, V value) {
+        uint64_t hash = Hash(key);
+        RehashStep(DICT_REHASH_GROUPS_PER_STEP);
+
+        Entry *entry = FindEntry(key, hash);
+        if (entry) {
+            return {&entry->value, false};
+        }
+
+        Table &t = PrepareInsert();
+        size_t idx = InsertAbsent(t, hash);
+        t.slots[idx].key.assign(key.data(), key.size());
+        t.slots[idx].value = std::move(value);
+        return {&t.slots[idx].value, true};
+    }
+
+    /// insert or overwrite
+    V &Set(std::string_view key, V value) {
+        auto [slot, inserted] = Emplace(key, V());
+        *slot = std::move(value);
+        return *slot;
+    }
+
+    V &operator[](std::string_view key) {
+        return *Emplace(key, V()).first;
+    }
+
+    bool Erase(std::string_view key) {
+        V value;
+        return Pop(key, value);
+    }
+
+    /// remove @param key and move its value to @param value
+    bool Pop(std::string_view key, V &value) {
+        uint64_t hash = Hash(key);
+        RehashStep(DICT_REHASH_GROUPS_PER_STEP);
+
+        for (int t = IsRehashing() ? 1 : 0; t >= 0; --t) {
+            Table &table = tables_[t];
+            size_t idx = FindIndex(table, key, hash);
+            if (idx != npos) {
+                value = std::move(table.slots[idx].value);
+                ClearSlot(table, idx);
+                MaybeShrink();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Clear() {
+        tables_[0] = Table();
+        tables_[1] = Table();
+        rehash_group_ = 0;
+    }
+
+    void Swap(Dict &other) noexcept {
+        std::swap(tables_[0], other.tables_[0]);
+        std::swap(tables_[1], other.tables_[1]);
+        std::swap(rehash_group_, other.rehash_group_);
+    }
+
+    /// call @param fn(Entry &) for every entry. @param fn must not modify the dict
+    template<typename Fn>
+    void ForEach(Fn &&fn) {
+        for (auto &table: tables_) {
+            for (size_t idx = 0; idx < table.capacity; ++idx) {
+                if (table.ctrl[idx] >= 0) {
+                    fn(table.slots[idx]);
+                }
+            }
+        }
+    }
+
+    /// Call @param fn(Entry &) on the full slots following the random position @param start, like the Redis
+    /// dictGetSomeKeys(), until it accepted @param count entries (fn returns true) or
+    /// count * DICT_SAMPLE_MAX_STEPS slots were visited. Return the number of accepted entries.
+    /// Consecutive slots are cheap to visit, and the hash already spreads the keys randomly over them
+    template<typename Fn>
+    size_t Sample(uint64_t start, size_t count, Fn &&fn) {
+        size_t accepted = 0;
+        size_t max_steps = count * DICT_SAMPLE_MAX_STEPS;
+        for (int t = 0; t <= (IsRehashing() ? 1 : 0) && accepted < count; ++t) {
+            Table &table = tables_[t];
+            if (table.capacity == 0)
+                continue;
+
+            size_t mask = table.capacity - 1;
+            size_t idx = start & mask;
+            for (size_t steps = 0; steps < table.capacity && steps < max_steps && accepted < count; ++steps) {
+                if (table.ctrl[idx] >= 0 && fn(table.slots[idx])) {
+                    ++accepted;
+                }
+                idx = (idx + 1) & mask;
+            }
+        }
+        return accepted;
+    }
+
+    /// Cursor iteration, same contract as the Redis dictScan(): start with cursor 0, call again with the returned
+    /// cursor until it is 0. Every key present during the whole iteration is emitted at least once, even across
+    /// resizes, and each call only visits the keys of one home group (plus the matching groups of the larger table
+    /// while rehashing).
+    template<typename Fn>
+    uint64_t Scan(uint64_t cursor, Fn &&fn) {
+        if (Empty()) {
+            return 0;
+        }
+
+        if (!IsRehashing()) {
+            Table &t = tables_[0];
+            uint64_t m0 = t.GroupMask();
+            EmitHomeGroup(t, cursor & m0, fn);
+            cursor = NextCursor(cursor, m0);
+        } else {
+            Table *t0 = &tables_[0], *t1 = &tables_[1];
+            if (t0->Groups() > t1->Groups()) {
+                std::swap(t0, t1);
+            }
+
+            uint64_t m0 = t0->GroupMask();
+            uint64_t m1 = t1->GroupMask();
+            EmitHomeGroup(*t0, cursor & m0, fn);
+            /// the groups of the larger table that expand the group of the smaller one
+            do {
+                EmitHomeGroup(*t1, cursor & m1, fn);
+                cursor = NextCursor(cursor, m1);
+            } while (cursor & (m0 ^ m1));
+        }
+
+        return cursor;
+    }
+
+    /// load the control bytes of the home group of @param hash into the cache. Safe without the lock of the writers:
+    /// only an address is computed from the tables, and a prefetch of a stale one is harmless
+    void PrefetchGroup(uint64_t hash) const {
+        for (int t = 1; t >= 0; --t) {
+            size_t capacity = tables_[t].capacity;
+            const int8_t *ctrl = tables_[t].ctrl.get();
+            if (capacity > 0) {
+                __builtin_prefetch(ctrl + (H1(hash) & (capacity / DICT_GROUP_WIDTH - 1)) * DICT_GROUP_WIDTH);
+            }
+        }
+    }
+
+    /// load the slots whose H2 matches @param hash in the home group. Call it after PrefetchGroup() had time to land.
+    /// The control bytes are read, so without the lock of the writers the layout of a table is only followed once
+    /// @param validate() confirmed it, as in FindConcurrent()
+    template<typename Validate>
+    void PrefetchSlots(uint64_t hash, Validate &&validate) const {
+        size_t capacity[2];
+        const int8_t *ctrl[2];
+        const Entry *slots[2];
+        for (int t = 0; t < 2; ++t) {
+            capacity[t] = tables_[t].capacity;
+            ctrl[t] = tables_[t].ctrl.get();
+            slots[t] = tables_[t].slots.get();
+        }
+        if (!validate())
+            return;
+
+        for (int t = 1; t >= 0; --t) {
+            if (capacity[t] == 0)
+                continue;
+
+            size_t base = (H1(hash) & (capacity[t] / DICT_GROUP_WIDTH - 1)) * DICT_GROUP_WIDTH;
+            uint32_t match = MatchByte(ctrl[t] + base, H2(hash));
+            while (match) {
+                __builtin_prefetch(slots[t] + base + __builtin_ctz(match));
+                match &= match - 1;
+            }
+        }
+    }
+
+    /// move up to @param groups groups of the old table. Return true while there is still work to do
+    bool RehashStep(size_t groups) {
+        if (!IsRehashing())
+            return false;
+
+        Table &from = tables_[0];
+        Table &to = tables_[1];
+        size_t total_groups = from.Groups();
+        while (groups-- > 0 && rehash_group_ < total_groups) {
+            size_t base = rehash_group_ * DICT_GROUP_WIDTH;
+            for (size_t i = 0; i < DICT_GROUP_WIDTH; ++i) {
+                size_t idx = base + i;
+                if (from.ctrl[idx] < 0)
+                    continue;
+
+                Entry &entry = from.slots[idx];
+                size_t to_idx = InsertAbsent(to, Hash(entry.key));
+                to.slots[to_idx].key = std::move(entry.key);
+                to.slots[to_idx].value = std::move(entry.value);
+                /// keep a tombstone, keys of the old table homed before this group may still be probed through it
+                ClearSlot(from, idx);
+            }
+            ++rehash_group_;
+        }
+
+        if (rehash_group_ >= total_groups) {
+            tables_[0] = std::move(tables_[1]);
+            tables_[1] = Table();
+            rehash_group_ = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    /// rehash for at most @param ms milliseconds, used by the server cron when the dict is idle
+    int RehashMilliseconds(int ms) {
+        auto start = std::chrono::steady_clock::now();
+        int rehashes = 0;
+        while (RehashStep(100)) {
+            rehashes += 100;
+            if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(ms))
+                break;
+        }
+        return rehashes;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    static int8_t H2(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+    static uint64_t H1(uint64_t hash) { return hash >> 7; }
+
+    static size_t HomeGroup(const Table &t, uint64_t hash) { return H1(hash) & t.GroupMask(); }
+
+    /// bitmask of slots in the group starting at @param ctrl whose control byte equals @param b
+    static uint32_t MatchByte(const int8_t *ctrl, int8_t b) {
+#if defined(__SSE2__)
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(b), group)));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < DICT_GROUP_WIDTH; ++i) {
+            mask |= static_cast<uint32_t>(ctrl[i] == b) << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// EMPTY and DELETED are the only negative control bytes
+    static uint32_t MatchEmptyOrDeleted(const int8_t *ctrl) {
+#if defined(__SSE2__)
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < DICT_GROUP_WIDTH; ++i) {
+            mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static uint64_t Rev(uint64_t v) {
+        v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+        v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+        v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        return __builtin_bswap64(v);
+    }
+
+    /// increase the reversed bits of @param cursor, see the comment of dictScan() in Redis
+    static uint64_t NextCursor(uint64_t cursor, uint64_t mask) {
+        cursor |= ~mask;
+        cursor = Rev(cursor);
+        ++cursor;
+        return Rev(cursor);
+    }
+
+    static size_t FindIndex(const Table &t, std::string_view key, uint64_t hash) {
+        if (t.capacity == 0)
+            return npos;
+
+        size_t mask = t.GroupMask();
+        size_t group = HomeGroup(t, hash);
+        int8_t h2 = H2(hash);
+        for (size_t probes = 0; probes <= mask; ++probes) {
+            const int8_t *ctrl = t.ctrl.get() + group * DICT_GROUP_WIDTH;
+            uint32_t match = MatchByte(ctrl, h2);
+            while (match) {
+                size_t idx = group * DICT_GROUP_WIDTH + __builtin_ctz(match);
+                if (t.slots[idx].key == key)
+                    return idx;
+                match &= match - 1;
+            }
+
+            /// an EMPTY slot ends the probe sequence
+            if (MatchByte(ctrl, kEmpty))
+                return npos;
+
+            group = (group + 1) & mask;
+        }
+        return npos;
+    }
+
+    /// claim a slot for a key known to be absent from @param t
+    static size_t InsertAbsent(Table &t, uint64_t hash) {
+        size_t mask = t.GroupMask();
+        size_t group = HomeGroup(t, hash);
+        while (true) {
+            int8_t *ctrl = t.ctrl.get() + group * DICT_GROUP_WIDTH;
+            uint32_t match = MatchEmptyOrDeleted(ctrl);
+            if (match) {
+                int i = __builtin_ctz(match);
+                if (ctrl[i] == kDeleted) {
+                    --t.deleted;
+                }
+                ctrl[i] = H2(hash);
+                ++t.size;
+                return group * DICT_GROUP_WIDTH + i;
+            }
+            group = (group + 1) & mask;
+        }
+    }
+
+    static void ClearSlot(Table &t, size_t idx) {
+        t.ctrl[idx] = kDeleted;
+        /// a concurrent reader may be comparing against the bytes of the key, see FindConcurrent()
+        static const size_t inline_capacity = std::string().capacity();
+        if (t.slots[idx].key.capacity() > inline_capacity) {
+            Epoch::Retire(new std::string(std::move(t.slots[idx].key)));
+        }
+        t.slots[idx].key.clear();
+        t.slots[idx].key.shrink_to_fit();
+        t.slots[idx].value = V();
+        --t.size;
+        ++t.deleted;
+    }
+
+    static size_t CapacityFor(size_t size) {
+        /// keep the load under one half right after a resize
+        size_t cap = DICT_MIN_CAPACITY;
+        while (cap < size * 2) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    void StartRehash(size_t capacity) {
+        tables_[1] = Table(capacity);
+        rehash_group_ = 0;
+    }
+
+    /// return the table that receives the next new key, resizing if needed
+    Table &PrepareInsert() {
+        if (IsRehashing()) {
+            /// the new table is sized to absorb the whole rehash, finish at once in the unlikely case it fills up
+            if (tables_[1].size + tables_[1].deleted + 1 <= tables_[1].MaxLoad()) {
+                return tables_[1];
+            }
+            while (RehashStep(tables_[0].Groups())) {}
+        }
+
+        Table &t = tables_[0];
+        if (t.capacity == 0) {
+            t = Table(DICT_MIN_CAPACITY);
+            return t;
+        }
+
+        if (t.size + t.deleted + 1 > t.MaxLoad()) {
+            /// grow, or only drop the tombstones when most of the load is tombstones
+            StartRehash(CapacityFor(t.size + 1) > t.capacity ? CapacityFor(t.size + 1) : t.capacity);
+            return tables_[1];
+        }
+
+        return t;
+    }
+
+    void MaybeShrink() {
+        if (IsRehashing())
+            return;
+
+        Table &t = tables_[0];
+        if (t.capacity > DICT_MIN_CAPACITY && t.size * 8 < t.capacity) {
+            StartRehash(CapacityFor(t.size));
+        }
+    }
+
+    Table tables_[2];           /// tables_[1] only exists while rehashing
+    size_t rehash_group_ = 0;   /// next group of tables_[0] to move
+
+    template<typename Fn>
+    void EmitHomeGroup(Table &t, size_t home, Fn &fn) {
+        if (t.capacity == 0)
+            return;
+
+        /// keys homed at @param home live between it and the first group with an EMPTY slot
+        size_t mask = t.GroupMask();
+        size_t group = home;
+        for (size_t probes = 0; probes <= mask; ++probes) {
+            int8_t *ctrl = t.ctrl.get() + group * DICT_GROUP_WIDTH;
+            for (size_t i = 0; i < DICT_GROUP_WIDTH; ++i) {
+                if (ctrl[i] < 0)
+                    continue;
+                Entry &entry = t.slots[group * DICT_GROUP_WIDTH + i];
+                if (HomeGroup(t, Hash(entry.key)) == home) {
+                    fn(entry);
+                }
+            }
+
+            if (MatchByte(ctrl, kEmpty))
+                break;
+            group = (group + 1) & mask;
+        }
+    }
+};
+
+#endif //REDIS_CRAFT_DICT_H
@@ -0,0 +1,122 @@
+//
+// Created by Manh Nguyen Viet on 9/20/25.
+//
+
+#include "Epoch.h"
+#include "RedisDef.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+typedef struct alignas(64) PinSlot {
+    std::atomic<uint64_t> epoch{0};     /// epoch the thread is pinned at, 0 outside of a read section
+} PinSlot;
+
+typedef struct Retired {
+    uint64_t epoch;
+    void *p;
+    Epoch::Deleter deleter;
+} Retired;
+
+typedef struct EpochThread {
+    int slot = -1;                      /// index in pin_slots, claimed by the first read section
+    int depth = 0;
+    std::vector<Retired> retired;
+} EpochThread;
+
+static PinSlot pin_slots[EPOCH_MAX_THREADS];
+static std::atomic<int> registered_slots{0};
+static std::atomic<uint64_t> global_epoch{1};
+/// never destroyed, blocks may still be retired while the process exits
+static thread_local EpochThread *epoch_thread = nullptr;
+
+static EpochThread &CurrentThread() {
+    if (!epoch_thread)
+        epoch_thread = new EpochThread();
+    return *epoch_thread;
+}
+
+/// lowest epoch a thread is pinned at, UINT64_MAX when none is
+static uint64_t MinPinnedEpoch() {
+    uint64_t min = UINT64_MAX;
+    int slots = std::min(registered_slots.load(), EPOCH_MAX_THREADS);
+    for (int i = 0; i < slots; ++i) {
+        uint64_t epoch = pin_slots[i].epoch.load();
+        if (epoch != 0 && epoch < min)
+            min = epoch;
+    }
+    return min;
+}
+
+void Epoch::Enter() {
+    EpochThread &thread = CurrentThread();
+    if (thread.depth++ > 0)
+        return;
+
+    if (thread.slot < 0) {
+        thread.slot = registered_slots.fetch_add(1);
+        if (thread.slot >= EPOCH_MAX_THREADS) {
+            LOG_ERROR("Epoch", "More than %d threads read the keyspace", EPOCH_MAX_THREADS);
+            abort();
+        }
+    }
+
+    /// a full barrier: the reads of the section cannot move before the pin, see Retire()
+    pin_slots[thread.slot].epoch.store(global_epoch.load());
+}
+
+void Epoch::Exit() {
+    EpochThread &thread = CurrentThread();
+    if (--thread.depth == 0)
+        pin_slots[thread.slot].epoch.store(0, std::memory_order_release);
+}
+
+void Epoch::Retire(void *p, Deleter deleter) {
+    /// either this sees the pin of a reader, or that reader sees p already unlinked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t epoch = global_epoch.load();
+    if (MinPinnedEpoch() == UINT64_MAX) {
+        deleter(p);
+        return;
+    }
+
+    EpochThread &thread = CurrentThread();
+    thread.retired.push_back({epoch, p, deleter});
+    if (thread.retired.size() % EPOCH_RECLAIM_BATCH == 0)
+        Reclaim();
+}
+
+void Epoch::Reclaim() {
+    EpochThread &thread = CurrentThread();
+    if (thread.retired.empty())
+        return;
+
+    uint64_t epoch = global_epoch.load();
+    uint64_t min = MinPinnedEpoch();
+    if (min >= epoch) {
+        /// every pinned reader saw the current epoch, the ones pinning from now on get the next
+        global_epoch.compare_exchange_strong(epoch, epoch + 1);
+        min = MinPinnedEpoch();
+    }
+
+    /// set aside before freeing, the deleters may retire more blocks
+    std::vector<Retired> ready;
+    size_t kept = 0;
+    for (auto &r: thread.retired) {
+        if (r.epoch < min)
+            ready.push_back(r);
+        else
+            thread.retired[kept++] = r;
+    }
+    thread.retired.resize(kept);
+
+    for (auto &r: ready)
+        r.deleter(r.p);
+}
+
+size_t Epoch::Pending() {
+    return CurrentThread().retired.size();
+}
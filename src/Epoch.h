@@ -0,0 +1,69 @@
+//
+// Created by Manh Nguyen Viet on 9/20/25.
+//
+
+#ifndef REDIS_CRAFT_EPOCH_H
+#define REDIS_CRAFT_EPOCH_H
+
+#include <cstddef>
+
+/// threads that can ever enter a read section
+#define EPOCH_MAX_THREADS 64
+/// a thread tries to free what it retired every this many retirements
+#define EPOCH_RECLAIM_BATCH 64
+
+/*
+ * Epoch based reclamation of the memory the keyspace readers go through without taking the stripe lock.
+ *
+ * A reader pins the global epoch for the time of its read section (Guard). A writer that unlinked a block hands it to
+ * Retire() instead of freeing it, which stamps it with the global epoch. The epoch only moves forward once every
+ * pinned thread has seen its current value, and a block is freed once no thread is pinned at or before its stamp: all
+ * the readers that could still hold a pointer to it have left their section.
+ *
+ * When no thread is pinned at all, the usual case as long as commands run on a single thread, Retire() frees at once
+ * and nothing is kept. Otherwise every thread keeps its own list of retired blocks, freed by its next retirements and
+ * by Reclaim(). Freeing a block may retire more of them, a table releasing its values for instance.
+ * */
+class Epoch {
+public:
+    using Deleter = void (*)(void *);
+
+    /// read section of the calling thread, may be nested
+    class Guard {
+    public:
+        Guard() { Enter(); }
+
+        ~Guard() { Exit(); }
+
+        Guard(const Guard &) = delete;
+
+        Guard &operator=(const Guard &) = delete;
+    };
+
+    /// free @param p with @param deleter once no reader can reach it anymore. It must already be unlinked from
+    /// everything a new reader could find, or be unlinked under a lock the readers validate against (see SeqMutex)
+    static void Retire(void *p, Deleter deleter);
+
+    template<typename T>
+    static void Retire(T *p) {
+        Retire(p, [](void *q) { delete static_cast<T *>(q); });
+    }
+
+    template<typename T>
+    static void RetireArray(T *p) {
+        Retire(p, [](void *q) { delete[] static_cast<T *>(q); });
+    }
+
+    /// move the epoch forward if possible and free what the calling thread retired and no reader can reach anymore
+    static void Reclaim();
+
+    /// blocks retired by the calling thread and not freed yet
+    static size_t Pending();
+
+private:
+    static void Enter();
+
+    static void Exit();
+};
+
+#endif //REDIS_CRAFT_EPOCH_H
@@ -0,0 +1,73 @@
+//
+// Created by Manh Nguyen Viet on 9/15/25.
+//
+
+#include "Evict.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <random>
+
+uint32_t LruClock() {
+    return static_cast<uint32_t>(CurrentTimeMs() / LRU_CLOCK_RESOLUTION) & LRU_CLOCK_MAX;
+}
+
+uint64_t EstimateObjectIdleTime(const RedisObject &obj) {
+    uint32_t clock = LruClock();
+    uint32_t lru = obj.Lru();
+    /// the clock wrapped around since the last access
+    uint64_t ticks = (clock >= lru) ? clock - lru : (LRU_CLOCK_MAX - lru) + clock;
+    return ticks * LRU_CLOCK_RESOLUTION;
+}
+
+uint32_t LfuTimeInMinutes() {
+    return static_cast<uint32_t>(CurrentTimeMs() / 60000) & 0xFFFF;
+}
+
+uint8_t LfuDecrAndReturn(const RedisObject &obj, int lfu_decay_time) {
+    uint32_t ldt = obj.Lru() >> 8;
+    uint32_t counter = obj.Lru() & 0xFF;
+    if (lfu_decay_time <= 0)
+        return static_cast<uint8_t>(counter);
+
+    uint32_t now = LfuTimeInMinutes();
+    uint32_t elapsed = (now >= ldt) ? now - ldt : 0xFFFF - ldt + now;
+    uint32_t num_periods = elapsed / lfu_decay_time;
+    return static_cast<uint8_t>((num_periods > counter) ? 0 : counter - num_periods);
+}
+
+uint8_t LfuLogIncr(uint8_t counter, int lfu_log_factor) {
+    if (counter == 255)
+        return counter;
+
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    double r = static_cast<double>(rng() - std::minstd_rand::min()) /
+               static_cast<double>(std::minstd_rand::max() - std::minstd_rand::min());
+    double baseval = std::max(static_cast<int>(counter) - LFU_INIT_VAL, 0);
+    double p = 1.0 / (baseval * lfu_log_factor + 1);
+    return (r < p) ? counter + 1 : counter;
+}
+
+void EvictionPool::Insert(const std::string &key, uint64_t idle, int db) {
+    auto pos = std::upper_bound(entries_.begin(), entries_.end(), idle,
+                                [](uint64_t v, const EvictionPoolEntry &e) { return v < e.idle; });
+    if (entries_.size() < EVPOOL_SIZE) {
+        entries_.insert(pos, EvictionPoolEntry{idle, key, db});
+        return;
+    }
+
+    /// full and worse than every candidate
+    if (pos == entries_.begin())
+        return;
+
+    /// drop the worst candidate, i.e the first one
+    size_t idx = pos - entries_.begin() - 1;
+    entries_.erase(entries_.begin());
+    entries_.insert(entries_.begin() + idx, EvictionPoolEntry{idle, key, db});
+}
+
+EvictionPoolEntry EvictionPool::PopBest() {
+    EvictionPoolEntry entry = std::move(entries_.back());
+    entries_.pop_back();
+    return entry;
+}
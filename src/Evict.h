@@ -0,0 +1,71 @@
+//
+// Created by Manh Nguyen Viet on 9/15/25.
+//
+
+#ifndef REDIS_CRAFT_EVICT_H
+#define REDIS_CRAFT_EVICT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RedisObject.h"
+
+#define LRU_CLOCK_MAX ((1 << 24) - 1)   /// max value of the 24 bits lru field of RedisObject
+#define LRU_CLOCK_RESOLUTION 1000       /// ms per tick of the LRU clock
+#define LFU_INIT_VAL 5                  /// counter of a new key, so it is not evicted before it had a chance to be used
+#define EVPOOL_SIZE 16                  /// number of eviction candidates kept between two evictions
+#define EVICTION_TIME_LIMIT_US 500      /// max time of one eviction run before the command goes on
+
+/*
+ * Approximated LRU and LFU as Redis does.
+ *
+ * With an LRU policy the lru field of RedisObject is the LRU clock of the last access, in seconds modulo 2^24.
+ * With an LFU policy its top 16 bits are the time of the last decrement in minutes and its low 8 bits a logarithmic
+ * access counter: every access increments it with a probability of 1 / ((counter - LFU_INIT_VAL) * lfu-log-factor + 1),
+ * and it is decremented by one for every lfu-decay-time minutes the key was not decremented.
+ * */
+
+uint32_t LruClock();
+
+/// idle time in ms of an object, from the LRU clock
+uint64_t EstimateObjectIdleTime(const RedisObject &obj);
+
+/// time in minutes modulo 2^16
+uint32_t LfuTimeInMinutes();
+
+/// counter of @param obj after applying the decay of the periods elapsed since its last decrement
+uint8_t LfuDecrAndReturn(const RedisObject &obj, int lfu_decay_time);
+
+/// logarithmically increment @param counter
+uint8_t LfuLogIncr(uint8_t counter, int lfu_log_factor);
+
+/// a candidate of the eviction pool, the one with the highest idle is evicted first
+typedef struct EvictionPoolEntry {
+    uint64_t idle;
+    std::string key;
+    int db;     /// logical database of the key
+} EvictionPoolEntry;
+
+/*
+ * The best candidates among the keys sampled so far, sorted by ascending idle.
+ * */
+class EvictionPool {
+public:
+    EvictionPool() { entries_.reserve(EVPOOL_SIZE); }
+
+    /// insert @param key of database @param db if the pool is not full, or if it is a better candidate than the worst one
+    void Insert(const std::string &key, uint64_t idle, int db);
+
+    bool Empty() const { return entries_.empty(); }
+
+    /// remove and return the candidate with the highest idle, only valid when !Empty()
+    EvictionPoolEntry PopBest();
+
+    void Clear() { entries_.clear(); }
+
+private:
+    std::vector<EvictionPoolEntry> entries_;
+};
+
+#endif //REDIS_CRAFT_EVICT_H
@@ -0,0 +1,124 @@
+//
+// Created by Manh Nguyen Viet on 9/11/25.
+//
+
+#include "ExpireIndex.h"
+#include "Zmalloc.h"
+
+#include <algorithm>
+
+static constexpr uint64_t EXPIRE_WHEEL_MAX_TIMEOUT = (UINT64_C(1) << (EXPIRE_WHEEL_BIT * EXPIRE_WHEEL_NUM)) - 1;
+
+static inline uint64_t RotateLeft(uint64_t v, int n) {
+    n &= 63;
+    return n ? (v << n) | (v >> (64 - n)) : v;
+}
+
+static inline uint64_t RotateRight(uint64_t v, int n) {
+    n &= 63;
+    return n ? (v >> n) | (v << (64 - n)) : v;
+}
+
+/// wheel of a deadline @param remaining ms ahead of the clock: the one holding its highest set bit
+static inline int WheelOf(uint64_t remaining) {
+    uint64_t r = std::min(remaining, EXPIRE_WHEEL_MAX_TIMEOUT);
+    return (63 - __builtin_clzll(r)) / EXPIRE_WHEEL_BIT;
+}
+
+/// slot of @param when in @param wheel. Upper wheels use one slot earlier, so an entry is cascaded down
+/// when the clock enters the period just before its deadline rather than after it
+static inline int SlotOf(int wheel, int64_t when) {
+    return static_cast<int>(EXPIRE_WHEEL_MASK & ((static_cast<uint64_t>(when) >> (wheel * EXPIRE_WHEEL_BIT)) -
+                                                 (wheel ? 1 : 0)));
+}
+
+void ExpireIndex::Add(const std::string &key, int64_t when) {
+    ++size_;
+    Schedule(Entry{key, when});
+}
+
+void ExpireIndex::Schedule(Entry &&entry) {
+    if (entry.when <= curtime_) {
+        due_.push_back(std::move(entry));
+        return;
+    }
+
+    int wheel = WheelOf(static_cast<uint64_t>(entry.when - curtime_));
+    int slot = SlotOf(wheel, entry.when);
+    wheels_[wheel][slot].push_back(std::move(entry));
+    pending_[wheel] |= UINT64_C(1) << slot;
+}
+
+void ExpireIndex::Advance(int64_t now) {
+    if (now <= curtime_)
+        return;
+
+    uint64_t elapsed = static_cast<uint64_t>(now - curtime_);
+    for (int wheel = 0; wheel < EXPIRE_WHEEL_NUM; ++wheel) {
+        int shift = wheel * EXPIRE_WHEEL_BIT;
+        uint64_t pending;
+
+        /// the slots of this wheel the clock went past, or all of them when it went around
+        if ((elapsed >> shift) > EXPIRE_WHEEL_MASK) {
+            pending = ~UINT64_C(0);
+        } else {
+            int wheel_elapsed = static_cast<int>(EXPIRE_WHEEL_MASK & (elapsed >> shift));
+            int oslot = static_cast<int>(EXPIRE_WHEEL_MASK & (static_cast<uint64_t>(curtime_) >> shift));
+            int nslot = static_cast<int>(EXPIRE_WHEEL_MASK & (static_cast<uint64_t>(now) >> shift));
+            uint64_t passed = (UINT64_C(1) << wheel_elapsed) - 1;
+            pending = RotateLeft(passed, oslot);
+            pending |= RotateRight(RotateLeft(passed, nslot), wheel_elapsed);
+            pending |= UINT64_C(1) << nslot;
+        }
+
+        while (pending & pending_[wheel]) {
+            int slot = __builtin_ctzll(pending & pending_[wheel]);
+            auto &entries = wheels_[wheel][slot];
+            std::move(entries.begin(), entries.end(), std::back_inserter(todo_));
+            entries.clear();
+            pending_[wheel] &= ~(UINT64_C(1) << slot);
+        }
+
+        /// the upper wheel only moves when this one wrapped around
+        if (!(pending & 1))
+            break;
+
+        elapsed = std::max(elapsed, static_cast<uint64_t>(EXPIRE_WHEEL_LEN) << shift);
+    }
+
+    curtime_ = now;
+    for (auto &entry: todo_) {
+        Schedule(std::move(entry));
+    }
+    todo_.clear();
+}
+
+ExpireIndex::Entry ExpireIndex::PopDue() {
+    Entry entry = std::move(due_.front());
+    due_.pop_front();
+    --size_;
+    return entry;
+}
+
+size_t ExpireIndex::MemoryUsage() const {
+    size_t bytes = (due_.size() + todo_.capacity()) * sizeof(Entry);
+    for (auto &wheel: wheels_) {
+        for (auto &slot: wheel) {
+            if (slot.capacity() > 0)
+                bytes += ZmallocSizeFor(slot.capacity() * sizeof(Entry));
+        }
+    }
+    return bytes;
+}
+
+void ExpireIndex::Clear() {
+    for (int wheel = 0; wheel < EXPIRE_WHEEL_NUM; ++wheel) {
+        for (auto &slot: wheels_[wheel]) {
+            std::vector<Entry>().swap(slot);
+        }
+        pending_[wheel] = 0;
+    }
+    due_.clear();
+    todo_.clear();
+    size_ = 0;
+}
@@ -0,0 +1,67 @@
+//
+// Created by Manh Nguyen Viet on 9/11/25.
+//
+
+#ifndef REDIS_CRAFT_EXPIREINDEX_H
+#define REDIS_CRAFT_EXPIREINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// bits of time covered by one wheel, i.e 64 slots per wheel
+#define EXPIRE_WHEEL_BIT 6
+#define EXPIRE_WHEEL_LEN (1 << EXPIRE_WHEEL_BIT)
+#define EXPIRE_WHEEL_MASK (EXPIRE_WHEEL_LEN - 1)
+/// number of wheels, with 1 ms ticks the wheels span 2^36 ms (~2 years). Later deadlines wait in the last wheel
+#define EXPIRE_WHEEL_NUM 6
+
+/*
+ * Hierarchical timing wheel of the keys having an expire time, ticking in milliseconds.
+ *
+ * A deadline is kept in the wheel of its highest bit differing from the current time, so Add() is O(1) and Advance()
+ * only touches the slots the clock went past: their entries cascade down to a lower wheel or become due.
+ * The index is never updated when a key is deleted, overwritten or persisted. The owner checks every due entry against
+ * the keyspace and drops the ones whose key no longer has exactly that expire time.
+ * */
+class ExpireIndex {
+public:
+    typedef struct Entry {
+        std::string key;
+        int64_t when;   /// absolute expire time in ms
+    } Entry;
+
+    explicit ExpireIndex(int64_t now = 0) : curtime_(now) {}
+
+    void Add(const std::string &key, int64_t when);
+
+    /// move the clock to @param now, the entries whose deadline is <= @param now become due
+    void Advance(int64_t now);
+
+    bool HasDue() const { return !due_.empty(); }
+
+    /// pop the earliest due entry, only valid when HasDue()
+    Entry PopDue();
+
+    /// number of entries in the index, including the stale ones
+    size_t Size() const { return size_; }
+
+    /// heap bytes of the slots and the due queue, the key names too long to be kept inline excluded
+    size_t MemoryUsage() const;
+
+    void Clear();
+
+private:
+    void Schedule(Entry &&entry);
+
+    int64_t curtime_;
+    size_t size_ = 0;
+    std::array<std::array<std::vector<Entry>, EXPIRE_WHEEL_LEN>, EXPIRE_WHEEL_NUM> wheels_;
+    std::array<uint64_t, EXPIRE_WHEEL_NUM> pending_{};    /// bitmap of the non-empty slots of each wheel
+    std::deque<Entry> due_;
+    std::vector<Entry> todo_;                              /// entries being cascaded by Advance(), reused
+};
+
+#endif //REDIS_CRAFT_EXPIREINDEX_H
@@ -5,115 +5,285 @@
 #ifndef REDIS_STARTER_CPP_GLOBMATCHER_HPP
 #define REDIS_STARTER_CPP_GLOBMATCHER_HPP
 
+#include <bitset>
+#include <cstring>
 #include <string>
-#include <iostream>
-#include <regex>
+#include <string_view>
 #include <vector>
 
+/*
+ * Glob pattern compiled once and matched against many keys (KEYS, SCAN MATCH, ...).
+ *
+ * Supported syntax, as the Redis stringmatch(): '*' any sequence, '?' any character, '[abc]' '[a-z]' '[^a]' ('!' is
+ * accepted for '^') classes, and '\x' the literal x. A '[' without its ']' is a literal '['.
+ *
+ * The pattern is split at its stars into segments of fixed length. The first segment must match at the beginning of
+ * the key, the last one at its end, and every segment in between at its leftmost occurrence, which is enough for
+ * globs since only '*' has a variable length. So matching never backtracks, and segments made only of literal bytes
+ * are searched with memmem()/memchr(), which are vectorized by the libc. Patterns that are a literal, a literal
+ * prefix followed by '*' or just '*' skip all of that.
+ * */
 class GlobMatcher {
+public:
+    explicit GlobMatcher(std::string_view pattern) {
+        Compile(pattern);
+    }
+
+    bool Match(std::string_view text) const {
+        switch (kind_) {
+            case MatchAnything:
+                return true;
+            case MatchExact:
+                return text.size() == prefix_.size() && std::memcmp(text.data(), prefix_.data(), prefix_.size()) == 0;
+            case MatchPrefix:
+                return text.size() >= prefix_.size() && std::memcmp(text.data(), prefix_.data(), prefix_.size()) == 0;
+            default:
+                return MatchSegments(text);
+        }
+    }
+
+    /// true when the pattern matches every key
+    bool MatchesAll() const { return kind_ == MatchAnything; }
+
+    /// the literal bytes every matching key starts with, possibly empty
+    const std::string &LiteralPrefix() const { return prefix_; }
+
+    /// true when matching is exactly checking LiteralPrefix(), i.e the pattern is "<literal>*"
+    bool IsPrefixPattern() const { return kind_ == MatchPrefix || kind_ == MatchAnything; }
+
+    static bool matchGlob(const std::string &text, const std::string &pattern) {
+        return GlobMatcher(pattern).Match(text);
+    }
+
 private:
-    // Convert glob pattern to regex pattern
-    static std::string globToRegex(const std::string &glob) {
-        std::string regex = "^"; // Start anchor
-
-        for (size_t i = 0; i < glob.length(); i++) {
-            char c = glob[i];
-
-            switch (c) {
-                case '*':
-                    regex += ".*";
-                    break;
-
-                case '?':
-                    regex += ".";
-                    break;
-
-                case '[':
-                    // Handle bracket expressions
-                    regex += '[';
-                    i++; // Move past '['
-
-                    // Check for negation
-                    if (i < glob.length() && (glob[i] == '!' || glob[i] == '^')) {
-                        regex += '^'; // Convert both ! and ^ to ^ for regex
-                        i++;
-                    }
-
-                    // Copy the bracket content
-                    while (i < glob.length() && glob[i] != ']') {
-                        char bracketChar = glob[i];
-
-                        // Escape special regex characters within brackets
-                        if (bracketChar == '\\' || bracketChar == '^' || bracketChar == '-') {
-                            regex += '\\';
-                        }
-
-                        regex += bracketChar;
-                        i++;
-                    }
-
-                    if (i < glob.length() && glob[i] == ']') {
-                        regex += ']';
-                    } else {
-                        // Malformed bracket expression, treat '[' as literal
-                        regex = regex.substr(0, regex.length() - 1); // Remove the '['
-                        regex += "\\[";
-                        i = glob.find('[', 0) + 1; // Reset to after the '['
-                        i--; // Will be incremented by loop
-                    }
-                    break;
-
-                case ']':
-                    // Standalone ']' should be escaped
-                    regex += "\\]";
-                    break;
-
-                case '.':
-                case '^':
-                case '$':
-                case '+':
-                case '{':
-                case '}':
-                case '(':
-                case ')':
-                case '|':
-                case '\\':
-                    // Escape special regex characters
-                    regex += '\\';
-                    regex += c;
-                    break;
-
-                default:
-                    // Regular character
-                    regex += c;
-                    break;
+    enum MatchKind {
+        MatchAnything,  /// "*"
+        MatchExact,     /// no wildcard
+        MatchPrefix,    /// "<literal>*"
+        MatchGeneral,
+    };
+
+    /// one character of a segment
+    typedef struct Token {
+        enum {
+            Literal,
+            AnyChar,
+            Class,
+        } type;
+        char c;
+        std::bitset<256> set;   /// accepted bytes of a Class
+    } Token;
+
+    /// a run of tokens between two stars, it always matches exactly tokens.size() bytes
+    typedef struct Segment {
+        std::vector<Token> tokens;
+        std::string literal;    /// the bytes of the segment when all its tokens are Literal
+        bool is_literal = true;
+    } Segment;
+
+    void Compile(std::string_view pattern) {
+        segments_.emplace_back();
+        bool has_star = false;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c == '*') {
+                has_star = true;
+                if (i == 0)
+                    anchored_start_ = false;
+                /// consecutive stars are one star
+                if (!segments_.back().tokens.empty() || segments_.size() == 1)
+                    segments_.emplace_back();
+                continue;
+            }
+
+            Token token{Token::Literal, c, {}};
+            if (c == '?') {
+                token.type = Token::AnyChar;
+            } else if (c == '\\' && i + 1 < pattern.size()) {
+                token.c = pattern[++i];
+            } else if (c == '[') {
+                size_t end = ParseClass(pattern, i, token);
+                if (end != std::string_view::npos)
+                    i = end;
+            }
+
+            auto &segment = segments_.back();
+            segment.tokens.push_back(token);
+            if (token.type == Token::Literal) {
+                segment.literal.push_back(token.c);
+            } else {
+                segment.is_literal = false;
             }
         }
 
-        regex += "$"; // End anchor
-        return regex;
+        anchored_end_ = pattern.empty() || pattern.back() != '*' || IsEscapedStar(pattern);
+
+        /// the literal prefix, up to the first wildcard
+        for (auto &token: segments_.front().tokens) {
+            if (token.type != Token::Literal)
+                break;
+            prefix_.push_back(token.c);
+        }
+        if (!anchored_start_)
+            prefix_.clear();
+
+        auto &first = segments_.front();
+        if (!has_star && first.is_literal) {
+            kind_ = MatchExact;
+        } else if (has_star && segments_.size() == 2 && first.is_literal && segments_.back().tokens.empty()) {
+            kind_ = first.tokens.empty() ? MatchAnything : MatchPrefix;
+        } else {
+            kind_ = MatchGeneral;
+        }
     }
 
-public:
-    static bool matchGlob(const std::string &text, const std::string &pattern) {
-        try {
-            std::string regexPattern = globToRegex(pattern);
-            std::regex globRegex(regexPattern);
-            return std::regex_match(text, globRegex);
-        } catch (const std::regex_error &e) {
-            // If regex compilation fails, return false
-            return false;
+    /// whether the last '*' of @param pattern is escaped by an odd number of backslashes
+    static bool IsEscapedStar(std::string_view pattern) {
+        size_t backslashes = 0;
+        for (size_t i = pattern.size() - 1; i > 0 && pattern[i - 1] == '\\'; --i)
+            ++backslashes;
+        return backslashes % 2 == 1;
+    }
+
+    /// parse the class starting at pattern[@param start] == '['. Return the index of its ']', npos if there is none,
+    /// in which case @param token stays a literal '['
+    static size_t ParseClass(std::string_view pattern, size_t start, Token &token) {
+        size_t i = start + 1;
+        bool negate = false;
+        if (i < pattern.size() && (pattern[i] == '^' || pattern[i] == '!')) {
+            negate = true;
+            ++i;
+        }
+
+        std::bitset<256> set;
+        for (; i < pattern.size() && pattern[i] != ']'; ++i) {
+            auto lo = static_cast<unsigned char>(pattern[i]);
+            if (pattern[i] == '\\' && i + 1 < pattern.size()) {
+                lo = static_cast<unsigned char>(pattern[++i]);
+            }
+
+            if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                auto hi = static_cast<unsigned char>(pattern[i + 2]);
+                if (lo > hi)
+                    std::swap(lo, hi);
+                for (unsigned v = lo; v <= hi; ++v)
+                    set.set(v);
+                i += 2;
+            } else {
+                set.set(lo);
+            }
+        }
+
+        if (i >= pattern.size())
+            return std::string_view::npos;
+
+        token.type = Token::Class;
+        token.set = negate ? ~set : set;
+        return i;
+    }
+
+    static bool MatchToken(const Token &token, char c) {
+        switch (token.type) {
+            case Token::Literal:
+                return token.c == c;
+            case Token::AnyChar:
+                return true;
+            default:
+                return token.set.test(static_cast<unsigned char>(c));
+        }
+    }
+
+    static bool MatchSegmentAt(const Segment &segment, std::string_view text, size_t pos) {
+        if (segment.is_literal)
+            return std::memcmp(text.data() + pos, segment.literal.data(), segment.literal.size()) == 0;
+
+        for (size_t i = 0; i < segment.tokens.size(); ++i) {
+            if (!MatchToken(segment.tokens[i], text[pos + i]))
+                return false;
+        }
+        return true;
+    }
+
+    /// leftmost position >= @param from where @param segment matches and ends before @param limit, npos if none
+    static size_t FindSegment(const Segment &segment, std::string_view text, size_t from, size_t limit) {
+        size_t len = segment.tokens.size();
+        if (limit < from + len)
+            return std::string_view::npos;
+
+        if (segment.is_literal) {
+            auto found = static_cast<const char *>(memmem(text.data() + from, limit - from,
+                                                          segment.literal.data(), len));
+            return found ? found - text.data() : std::string_view::npos;
         }
+
+        const Token &head = segment.tokens.front();
+        for (size_t pos = from; pos + len <= limit; ++pos) {
+            if (head.type == Token::Literal) {
+                /// jump to the next candidate
+                auto next = static_cast<const char *>(std::memchr(text.data() + pos, head.c, limit - len + 1 - pos));
+                if (!next)
+                    return std::string_view::npos;
+                pos = next - text.data();
+            }
+
+            if (MatchSegmentAt(segment, text, pos))
+                return pos;
+        }
+        return std::string_view::npos;
     }
 
-    // Additional utility method to see the converted regex (for debugging)
-    static std::string getRegexPattern(const std::string &pattern) {
-        return globToRegex(pattern);
+    bool MatchSegments(std::string_view text) const {
+        size_t first = 0;
+        size_t last = segments_.size();
+        size_t pos = 0;
+        size_t limit = text.size();
+
+        /// no star at all: the single segment must cover the whole text
+        if (segments_.size() == 1) {
+            auto &segment = segments_.front();
+            return text.size() == segment.tokens.size() && MatchSegmentAt(segment, text, 0);
+        }
+
+        if (anchored_start_) {
+            auto &segment = segments_.front();
+            if (text.size() < segment.tokens.size() || !MatchSegmentAt(segment, text, 0))
+                return false;
+            pos = segment.tokens.size();
+        }
+        ++first;
+
+        if (anchored_end_) {
+            auto &segment = segments_.back();
+            size_t len = segment.tokens.size();
+            if (limit < pos + len || !MatchSegmentAt(segment, text, limit - len))
+                return false;
+            limit -= len;
+            --last;
+        }
+
+        for (size_t i = first; i < last; ++i) {
+            auto &segment = segments_[i];
+            if (segment.tokens.empty())
+                continue;
+
+            size_t found = FindSegment(segment, text, pos, limit);
+            if (found == std::string_view::npos)
+                return false;
+            pos = found + segment.tokens.size();
+        }
+
+        return true;
     }
+
+    std::vector<Segment> segments_;
+    std::string prefix_;
+    bool anchored_start_ = true;
+    bool anchored_end_ = true;
+    MatchKind kind_ = MatchGeneral;
 };
 
-// Convenience function
-bool matchGlob(const std::string &text, const std::string &pattern) {
+// Convenience function, compiles @param pattern on every call. Use GlobMatcher to match many keys
+inline bool matchGlob(const std::string &text, const std::string &pattern) {
     return GlobMatcher::matchGlob(text, pattern);
 }
 
@@ -0,0 +1,152 @@
+//
+// Created by Manh Nguyen Viet on 9/21/25.
+//
+
+#include "HotKeys.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+/// probability, scaled to 2^32, that a bucket of count c held by another key decays
+static const std::array<uint64_t, HOTKEYS_DECAY_COUNTS> decay_threshold = []() {
+    std::array<uint64_t, HOTKEYS_DECAY_COUNTS> thresholds{};
+    for (int c = 0; c < HOTKEYS_DECAY_COUNTS; ++c)
+        thresholds[c] = static_cast<uint64_t>(std::pow(HOTKEYS_DECAY_BASE, -c) * 4294967296.0);
+    return thresholds;
+}();
+
+static uint64_t NextRandom(uint64_t &state) {
+    /// xorshift64, good enough for coin flips
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/// bucket of @param hash in @param row, the fingerprint is taken from the other half of the hash
+static size_t BucketIndex(uint64_t hash, int row) {
+    uint64_t h = static_cast<uint32_t>(hash) * (2 * static_cast<uint64_t>(row) + 0x9E3779B1ULL);
+    return static_cast<size_t>((h >> 16) % HOTKEYS_SKETCH_WIDTH);
+}
+
+static uint32_t Fingerprint(uint64_t hash) {
+    /// 0 marks an empty bucket
+    return static_cast<uint32_t>(hash >> 32) | 1;
+}
+
+void HotKeys::Sketch::Add(std::string_view key, uint64_t hash, uint64_t &rng) {
+    uint32_t fingerprint = Fingerprint(hash);
+    uint32_t estimate = 0;
+    for (int row = 0; row < HOTKEYS_SKETCH_ROWS; ++row) {
+        Bucket &bucket = rows_[row][BucketIndex(hash, row)];
+        if (bucket.count == 0) {
+            bucket = {fingerprint, 1};
+        } else if (bucket.fingerprint == fingerprint) {
+            if (bucket.count < UINT32_MAX)
+                ++bucket.count;
+        } else if (bucket.count < HOTKEYS_DECAY_COUNTS &&
+                   (NextRandom(rng) & 0xFFFFFFFF) < decay_threshold[bucket.count] && --bucket.count == 0) {
+            bucket = {fingerprint, 1};
+        }
+
+        if (bucket.fingerprint == fingerprint)
+            estimate = std::max(estimate, bucket.count);
+    }
+
+    if (estimate == 0)
+        return;
+
+    auto it = std::find_if(top.begin(), top.end(), [key](const HotKey &e) { return e.key == key; });
+    if (it != top.end()) {
+        it->count = std::max<uint64_t>(it->count, estimate);
+        return;
+    }
+
+    if (top.size() < top_k) {
+        top.push_back({std::string(key), estimate});
+        return;
+    }
+
+    auto coldest = std::min_element(top.begin(), top.end(),
+                                    [](const HotKey &a, const HotKey &b) { return a.count < b.count; });
+    if (coldest != top.end() && estimate > coldest->count)
+        *coldest = {std::string(key), estimate};
+}
+
+uint32_t HotKeys::Sketch::Estimate(uint64_t hash) const {
+    uint32_t fingerprint = Fingerprint(hash);
+    uint32_t estimate = 0;
+    for (int row = 0; row < HOTKEYS_SKETCH_ROWS; ++row) {
+        const Bucket &bucket = rows_[row][BucketIndex(hash, row)];
+        if (bucket.fingerprint == fingerprint)
+            estimate = std::max(estimate, bucket.count);
+    }
+    return estimate;
+}
+
+void HotKeys::Sketch::Clear() {
+    for (auto &row: rows_)
+        row.fill({0, 0});
+    top.clear();
+}
+
+HotKeys *HotKeys::GetInstance() {
+    static HotKeys *instance = new HotKeys();
+    return instance;
+}
+
+HotKeys::HotKeys() = default;
+
+void HotKeys::Configure(int sample_rate, int top_k) {
+    std::lock_guard lock(m_);
+    accesses_.top_k = writes_.top_k = static_cast<size_t>(std::clamp(top_k, 1, HOTKEYS_MAX_TOP_K));
+    accesses_.Clear();
+    writes_.Clear();
+    sampled_ = 0;
+    sample_rate_ = std::max(sample_rate, 0);
+}
+
+void HotKeys::RecordSampled(std::string_view key, bool write) {
+    uint64_t hash = std::hash<std::string_view>{}(key);
+    std::lock_guard lock(m_);
+    ++sampled_;
+    accesses_.Add(key, hash, rng_);
+    if (write)
+        writes_.Add(key, hash, rng_);
+}
+
+std::vector<HotKeys::HotKey> HotKeys::Top(size_t count, bool writes) const {
+    std::vector<HotKey> top;
+    {
+        std::lock_guard lock(m_);
+        top = writes ? writes_.top : accesses_.top;
+    }
+
+    std::sort(top.begin(), top.end(), [](const HotKey &a, const HotKey &b) { return a.count > b.count; });
+    if (top.size() > count)
+        top.resize(count);
+
+    uint64_t rate = std::max(sample_rate_.load(), 1);
+    for (auto &e: top)
+        e.count *= rate;
+    return top;
+}
+
+uint64_t HotKeys::EstimateWrites(std::string_view key) const {
+    uint64_t hash = std::hash<std::string_view>{}(key);
+    std::lock_guard lock(m_);
+    return static_cast<uint64_t>(writes_.Estimate(hash)) * std::max(sample_rate_.load(), 1);
+}
+
+size_t HotKeys::Sampled() const {
+    std::lock_guard lock(m_);
+    return sampled_;
+}
+
+void HotKeys::Reset() {
+    std::lock_guard lock(m_);
+    accesses_.Clear();
+    writes_.Clear();
+    sampled_ = 0;
+}
@@ -0,0 +1,112 @@
+//
+// Created by Manh Nguyen Viet on 9/21/25.
+//
+
+#ifndef REDIS_CRAFT_HOTKEYS_H
+#define REDIS_CRAFT_HOTKEYS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// rows of the sketch, and buckets per row
+#define HOTKEYS_SKETCH_ROWS 2
+#define HOTKEYS_SKETCH_WIDTH 2048
+/// a bucket held by another key decays with probability HOTKEYS_DECAY_BASE ^ -count
+#define HOTKEYS_DECAY_BASE 1.08
+/// counts from which the decay probability is taken as 0
+#define HOTKEYS_DECAY_COUNTS 256
+#define HOTKEYS_MAX_TOP_K 128
+
+/*
+ * The most accessed and the most written keys, estimated by two HeavyKeeper sketches.
+ *
+ * A sketch is HOTKEYS_SKETCH_ROWS rows of buckets, each a key fingerprint and a count. An access to a key increments
+ * its bucket in every row; a bucket held by another fingerprint decays instead, with a probability falling
+ * exponentially with its count, and is taken over once it drops to 0. Keys seen once in a while keep losing their
+ * buckets, while a heavy hitter keeps its count close to its real number of accesses. The best estimates are kept in
+ * a list of the top-k keys, so the sketch takes a fixed amount of memory whatever the number of keys.
+ *
+ * Only one key access every hotkeys-sample-rate is recorded, the others cost an atomic increment. The counts reported
+ * are scaled back by the rate. A rate of 0 turns the tracking off.
+ * */
+class HotKeys {
+public:
+    typedef struct HotKey {
+        std::string key;
+        uint64_t count;
+    } HotKey;
+
+    HotKeys(const HotKeys &) = delete;
+
+    HotKeys &operator=(const HotKeys &) = delete;
+
+    static HotKeys *GetInstance();
+
+    /// record one key access every @param sample_rate, 0 disables the tracking, and keep the @param top_k hottest
+    /// keys. The keys tracked so far are dropped
+    void Configure(int sample_rate, int top_k);
+
+    bool Enabled() const { return sample_rate_ > 0; }
+
+    int SampleRate() const { return sample_rate_; }
+
+    /// an access to @param key by a command, @param write if the command writes it
+    void Record(std::string_view key, bool write) {
+        int rate = sample_rate_.load(std::memory_order_relaxed);
+        if (rate > 0 && ticks_.fetch_add(1, std::memory_order_relaxed) % rate == 0)
+            RecordSampled(key, write);
+    }
+
+    /// the @param count hottest keys for the accesses, or only the writes with @param writes, hottest first
+    std::vector<HotKey> Top(size_t count, bool writes) const;
+
+    /// the estimated writes of @param key
+    uint64_t EstimateWrites(std::string_view key) const;
+
+    /// key accesses recorded since the last Reset()
+    size_t Sampled() const;
+
+    void Reset();
+
+private:
+    /// one HeavyKeeper and its top-k list
+    class Sketch {
+    public:
+        void Add(std::string_view key, uint64_t hash, uint64_t &rng);
+
+        uint32_t Estimate(uint64_t hash) const;
+
+        void Clear();
+
+        size_t top_k = 0;
+        std::vector<HotKey> top;        /// at most top_k keys, unordered
+
+    private:
+        typedef struct Bucket {
+            uint32_t fingerprint;
+            uint32_t count;
+        } Bucket;
+
+        std::array<std::array<Bucket, HOTKEYS_SKETCH_WIDTH>, HOTKEYS_SKETCH_ROWS> rows_{};
+    };
+
+    HotKeys();
+
+    void RecordSampled(std::string_view key, bool write);
+
+    std::atomic<int> sample_rate_{0};
+    std::atomic<uint64_t> ticks_{0};
+
+    mutable std::mutex m_;          /// guards the sketches
+    Sketch accesses_;
+    Sketch writes_;
+    size_t sampled_ = 0;
+    uint64_t rng_ = 0x9E3779B97F4A7C15ULL;
+};
+
+#endif //REDIS_CRAFT_HOTKEYS_H
@@ -5,17 +5,24 @@
 #include "InternalCommandExecutor.h"
 #include "Server.h"
 #include "RedisError.h"
+#include "HotKeys.h"
+#include "LazyFree.h"
+#include "Zmalloc.h"
+
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <span>
 
 class EchoCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         if (query.cmd_args.size() < 2)
             return;
 
-        resp::encoder<std::string> enc;
-
-        std::string response = enc.encode_bulk_str(query.cmd_args[1], query.cmd_args[1].size());
+        std::string response;
+        RespWriter(response).AppendBulkStr(query.cmd_args[1]);
 
-        client->WriteAsync(response, APP_RECV | ALL_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | ALL_SEND);
     }
 };
 
@@ -33,21 +40,21 @@ private:
 
         if (resp.empty()) {
             LOG_ERROR(EXECUTOR, "GetCommandExecutor: Key %s not found", query.cmd_args[1].c_str());
-            return "$-1\r\n"; // RESP format for nil
+            return RESP_NIL;
         } else {
-            resp::encoder<std::string> encoder;
-            auto s = encoder.encode_bulk_str(resp, resp.size());
+            std::string s;
+            RespWriter(s).AppendBulkStr(resp);
             LOG_DEBUG(EXECUTOR, "Get key %s, val %s\n", query.cmd_args[1].c_str(), s.c_str());
             return s;
         }
     }
 
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         std::string response = GetResponse(query);
         if (response.empty())
             return;
 
-        client->WriteAsync(response, APP_RECV | MASTER_SEND | SLAVE_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | MASTER_SEND | SLAVE_SEND);
     }
 };
 
@@ -56,8 +63,9 @@ private:
     typedef struct Options {
         int set_on_exist;
         int64_t expired_ts;
+        bool keep_ttl;
 
-        Options() : set_on_exist(-1), expired_ts(0) {}
+        Options() : set_on_exist(-1), expired_ts(0), keep_ttl(false) {}
     } Options;
 
     int ParseArgs(std::vector<std::string> &args, Options &opts) {
@@ -85,9 +93,14 @@ private:
                 opts.expired_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
                         std::chrono::system_clock::now().time_since_epoch()).count() + stoll(args[i + 1]);
                 ++i;
+            } else if (arg == "KEEPTTL") {
+                opts.keep_ttl = true;
             }
         }
 
+        if (opts.keep_ttl && opts.expired_ts != 0)
+            return -1;
+
         return 0;
     }
 
@@ -106,24 +119,24 @@ private:
         if (ret < 0)
             return "!12\r\nInvalid args\r\n";
 
-        Database::GetInstance()->SetKeyVal(key, val, opts.set_on_exist, opts.expired_ts);
+        Database::GetInstance()->SetKeyVal(key, val, opts.set_on_exist, opts.expired_ts, opts.keep_ttl);
 
-        return "+OK\r\n";
+        return RESP_OK;
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         std::string response = GetResponse(query);
         if (response.empty())
             return;
 
-        client->WriteAsync(response, APP_RECV | MASTER_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | MASTER_SEND);
     }
 
 };
 
 class PingCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         if (query.cmd_args.size() < 1)
             return;
 
@@ -151,21 +164,17 @@ class GetConfigCommandExecutor : public AbstractInternalCommandExecutor {
             }
         }
 
-        resp::encoder<std::string> enc;
-        std::vector<std::string> replies = enc.encode_arr(configs);
         std::string response;
-        for (auto &rely: replies) {
-            response += rely;
-        }
+        RespWriter(response).AppendCommand(configs);
 
         return response;
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         std::string response = GetResponse(query);
 
-        client->WriteAsync(response, APP_RECV | ALL_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | ALL_SEND);
     }
 };
 
@@ -179,21 +188,21 @@ private:
         std::string pattern = query.cmd_args[1];
         auto matched_keys = Database::GetInstance()->RetrieveKeysMatchPattern(pattern);
 
-        resp::encoder<std::string> enc;
-        std::vector<std::string> resp_keys = enc.encode_arr(matched_keys);
         std::string response;
-        for (auto &resp_key: resp_keys) {
-            response += resp_key;
+        RespWriter writer(response);
+        writer.AppendArrayHeader(matched_keys.size());
+        for (auto &key: matched_keys) {
+            writer.AppendBulkStr(key);
         }
 
         return response;
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         std::string response = GetResponse(query);
 
-        client->WriteAsync(response, APP_RECV | ALL_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | ALL_SEND);
     }
 
 };
@@ -208,21 +217,34 @@ private:
             section = query.cmd_args[1];
         }
 
-        if (section == "replication") {
+        std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+        bool all = (section == "default" || section == "all" || section == "everything");
+        std::string info;
+        if (all || section == "replication") {
             /// show the info of server
-            std::string replication_info = Server::GetInstance()->ShowReplicationInfo();
-            resp::encoder<std::string> enc;
-            return enc.encode_bulk_str(replication_info, replication_info.size());
+            info += "# Replication\r\n" + Server::GetInstance()->ShowReplicationInfo();
+        }
+        if (all || section == "memory") {
+            if (!info.empty())
+                info += CRLF;
+            info += "# Memory\r\n" + Server::GetInstance()->ShowMemoryInfo();
+        }
+        if (all || section == "hotkeys") {
+            if (!info.empty())
+                info += CRLF;
+            info += "# Hotkeys\r\n" + Server::GetInstance()->ShowHotKeysInfo();
         }
 
-        return "";
+        std::string response;
+        RespWriter(response).AppendBulkStr(info);
+        return response;
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         std::string response = GetResponse(query);
 
-        client->WriteAsync(response, APP_RECV | ALL_SEND);
+        client->WriteAsync(std::move(response), APP_RECV | ALL_SEND);
     }
 };
 
@@ -256,11 +278,11 @@ private:
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         /// TODO: handle the argument
         std::string response = GetResponse(query, client);
 
-        client->WriteAsync(response, SLAVE_RECV | MASTER_SEND);
+        client->WriteAsync(std::move(response), SLAVE_RECV | MASTER_SEND);
     }
 };
 
@@ -293,11 +315,11 @@ private:
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         /// TODO: handle the argument
         std::string response = GetResponse(query, client);
 
-        client->WriteAsync(response, SLAVE_RECV | MASTER_SEND);
+        client->WriteAsync(std::move(response), SLAVE_RECV | MASTER_SEND);
     }
 };
 
@@ -310,7 +332,7 @@ private:
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         if (query.cmd_args.size() < 3) {
             LOG_ERROR(EXECUTOR, "ReplconfAckCommandExecutor: Invalid number of arguments");
             return;
@@ -377,16 +399,16 @@ private:
     }
 
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         /// TODO: handle the argument
         std::string response = GetResponse(query, client);
 
-        client->WriteAsync(response, MASTER_RECV | SLAVE_SEND);
+        client->WriteAsync(std::move(response), MASTER_RECV | SLAVE_SEND);
     }
 };
 
 class PSyncCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
 
         /// if could not perform incremental replication
         /// TODO: handle the argument
@@ -399,7 +421,7 @@ class PSyncCommandExecutor : public AbstractInternalCommandExecutor {
         /// Case 1: full sync
         std::string response = EncodeRespSimpleStr("FULLRESYNC " + master_repid + " " + master_repl_offset);
 
-        client->WriteAsync(response, SLAVE_RECV | MASTER_SEND);
+        client->WriteAsync(std::move(response), SLAVE_RECV | MASTER_SEND);
 
         client->SetSlaveState(SlaveState::WaitBGSaveEnd);
 
@@ -412,13 +434,13 @@ class PSyncCommandExecutor : public AbstractInternalCommandExecutor {
 };
 
 class FullresyncCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
 
     }
 };
 
 class WaitCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         if (query.cmd_args.size() < 3) {
             LOG_ERROR(EXECUTOR, "Invalid wait command");
             return;
@@ -476,7 +498,7 @@ class WaitCommandExecutor : public AbstractInternalCommandExecutor {
 };
 
 class TypeCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         if (query.cmd_args.size() < 2) {
             LOG_ERROR(EXECUTOR, "Invalid argc of command Type");
             return;
@@ -493,7 +515,7 @@ class TypeCommandExecutor : public AbstractInternalCommandExecutor {
 };
 
 class XAddCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         /**
          * Format: XADD <stream_key> <ID> key0 val0 [key1 val1 ...]
          */
@@ -514,37 +536,24 @@ class XAddCommandExecutor : public AbstractInternalCommandExecutor {
                 error_message = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
             } else if (ret == InvalidXaddEntryIdError) {
                 error_message = "-ERR The ID specified in XADD must be greater than 0-0\r\n";
+            } else if (ret == WrongTypeError) {
+                error_message = RESP_WRONGTYPE;
             }
 
             client->WriteAsync(error_message, APP_RECV | ALL_SEND);
             return;
         }
 
-        char entry_id_str[128] = {0};
-        snprintf(entry_id_str, 128, "%lld-%lld", entry_id.timestamp, entry_id.sequence_number);
-
-        std::string reply = EncodeRespBulkStr(entry_id_str);
+        std::string reply;
+        RespWriter(reply).AppendEntryId(entry_id);
 
-        client->WriteAsync(reply, APP_RECV | ALL_SEND);
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
     }
 };
 
 class XRangeCommandExecutor : public AbstractInternalCommandExecutor {
-private:
-    std::string ConvertEntryIdToRESP(const RdbParser::EntryID &entry_id) {
-        /// 1. convert to string
-        char buffer[128] = {0};
-        snprintf(buffer, 127, "%lld-%lld", entry_id.timestamp, entry_id.sequence_number);
-        /// 2. convert string to RESP
-        return EncodeRespBulkStr(buffer);
-    }
-
-    std::string ConvertEntryStreamToRESP(const RdbParser::EntryStream &entry_stream) {
-        return EncodeArr2RespArr(entry_stream);
-    }
-
 public:
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
         /**
          * @brief Format: XRANGE <stream_key> <start> <end> [COUNT count] [BLOCK miliseconds]
          * 
@@ -560,24 +569,1597 @@ public:
         auto &end_id = query.cmd_args[3];
 
         auto stream_range = Database::GetInstance()->GetStreamRange(stream_key, start_id, end_id);
-        std::vector<std::string> resp_entries;
+
+        /// 2. encode every entry as [id, [field, value, ...]] in a single pass
+        std::string reply;
+        RespWriter writer(reply);
+        writer.AppendArrayHeader(stream_range.size());
         for (auto &entry: stream_range) {
-            /// encode each entry to RESP format
-            auto &stream_id = entry.first;
-            auto &entry_stream = entry.second;
+            writer.AppendArrayHeader(2);
+            writer.AppendEntryId(entry.first);
+            writer.AppendCommand(entry.second);
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class IncrDecrCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit IncrDecrCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: INCR <key> | DECR <key> | INCRBY <key> <increment> | DECRBY <key> <decrement>
+         */
+        bool by = (cmd_type_ == IncrByCmd || cmd_type_ == DecrByCmd);
+        if (query.cmd_args.size() != (by ? 3 : 2)) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t delta = 1;
+        if (by && !StringToInt64(query.cmd_args[2], delta)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        if (cmd_type_ == DecrCmd || cmd_type_ == DecrByCmd) {
+            if (delta == INT64_MIN) {
+                client->WriteAsync(RESP_INCR_OVERFLOW, APP_RECV | MASTER_SEND);
+                return;
+            }
+            delta = -delta;
+        }
+
+        int64_t result;
+        int ret = Database::GetInstance()->IncrBy(query.cmd_args[1], delta, result);
+        if (ret < 0) {
+            LOG_ERROR(EXECUTOR, "%s %s fail %d", query.cmd_args[0].c_str(), query.cmd_args[1].c_str(), ret);
+            client->WriteAsync(IncrErrorReply(ret), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// small results come straight from the shared integer table
+        std::string reply;
+        RespWriter(reply).AppendInteger(result);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+    static std::string WrongArgcReply(const std::string &cmd) {
+        std::string reply;
+        RespWriter(reply).AppendError("ERR wrong number of arguments for '" + cmd + "' command");
+        return reply;
+    }
+
+    static std::string IncrErrorReply(int err) {
+        switch (err) {
+            case WrongTypeError:
+                return RESP_WRONGTYPE;
+            case NotIntegerError:
+                return RESP_NOT_INTEGER;
+            case IncrOverflowError:
+                return RESP_INCR_OVERFLOW;
+            case NotFloatError:
+                return RESP_NOT_FLOAT;
+            case IncrNanOrInfinityError:
+                return RESP_INCR_NAN;
+            default:
+                return RESP_NIL;
+        }
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class IncrByFloatCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: INCRBYFLOAT <key> <increment>
+         */
+        if (query.cmd_args.size() != 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command IncrByFloat, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        long double delta;
+        if (!StringToLongDouble(query.cmd_args[2], delta)) {
+            client->WriteAsync(RESP_NOT_FLOAT, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string result;
+        int ret = Database::GetInstance()->IncrByFloat(query.cmd_args[1], delta, result);
+        if (ret < 0) {
+            LOG_ERROR(EXECUTOR, "IncrByFloat %s fail %d", query.cmd_args[1].c_str(), ret);
+            client->WriteAsync(IncrDecrCommandExecutor::IncrErrorReply(ret), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendBulkStr(result);
+
+        /// the float formatting may differ on the replicas, propagate the exact result instead
+        query.cmd_args = {"SET", query.cmd_args[1], result, "KEEPTTL"};
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class DelCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit DelCommandExecutor(bool unlink) : unlink_(unlink) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: DEL | UNLINK <key> [key ...]
+         */
+        if (query.cmd_args.size() < 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Del, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// UNLINK only unlinks the keys, their values are freed in the background
+        auto db = Database::GetInstance();
+        bool lazy = unlink_ || db->IsLazy(&RedisConfig::lazyfree_lazy_user_del);
+        std::vector<std::string> keys(query.cmd_args.begin() + 1, query.cmd_args.end());
+        int64_t deleted = db->DeleteKeys(keys, lazy);
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(deleted);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+private:
+    bool unlink_;
+};
+
+class FlushCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit FlushCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: FLUSHALL | FLUSHDB [ASYNC | SYNC]
+         */
+        if (query.cmd_args.size() > 2) {
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string mode = (query.cmd_args.size() == 2) ? query.cmd_args[1] : "";
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+        bool async;
+        if (mode == "ASYNC") {
+            async = true;
+        } else if (mode == "SYNC") {
+            async = false;
+        } else if (mode.empty()) {
+            async = Database::GetInstance()->IsLazy(&RedisConfig::lazyfree_lazy_user_flush);
+        } else {
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        if (cmd_type_ == FlushDbCmd) {
+            Database::GetInstance()->FlushDb(async);
+        } else {
+            Database::GetInstance()->FlushAll(async);
+        }
+
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class ExpireCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit ExpireCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: EXPIRE | PEXPIRE | EXPIREAT | PEXPIREAT <key> <time> [NX | XX | GT | LT]
+         */
+        if (query.cmd_args.size() != 3 && query.cmd_args.size() != 4) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t value;
+        if (!StringToInt64(query.cmd_args[2], value)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        ExpireCondition cond = ExpireAlways;
+        if (query.cmd_args.size() == 4 && (cond = ParseCondition(query.cmd_args[3])) == ExpireAlways) {
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// convert to an absolute time in ms
+        int64_t when = value;
+        bool overflow = false;
+        if (cmd_type_ == ExpireCmd || cmd_type_ == ExpireAtCmd)
+            overflow = __builtin_mul_overflow(when, 1000, &when);
+        if (!overflow && (cmd_type_ == ExpireCmd || cmd_type_ == PExpireCmd))
+            overflow = __builtin_add_overflow(when, CurrentTimeMs(), &when);
+
+        if (overflow) {
+            std::string reply;
+            RespWriter(reply).AppendError("ERR invalid expire time in '" + query.cmd_args[0] + "' command");
+            client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        bool deleted = false;
+        std::string key = query.cmd_args[1];
+        int ret = Database::GetInstance()->SetExpire(key, when, cond, deleted);
+
+        /// the replicas apply the absolute time, so a delay of the propagation does not extend the ttl
+        if (deleted) {
+            query.cmd_args = {"DEL", key};
+        } else {
+            std::string option = (query.cmd_args.size() == 4) ? query.cmd_args[3] : "";
+            query.cmd_args = {"PEXPIREAT", key, std::to_string(when)};
+            if (!option.empty())
+                query.cmd_args.push_back(option);
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(ret);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+private:
+    static ExpireCondition ParseCondition(std::string arg) {
+        std::transform(arg.begin(), arg.end(), arg.begin(), ::toupper);
+        if (arg == "NX")
+            return ExpireNx;
+        if (arg == "XX")
+            return ExpireXx;
+        if (arg == "GT")
+            return ExpireGt;
+        if (arg == "LT")
+            return ExpireLt;
+        return ExpireAlways;
+    }
+
+    CommandType cmd_type_;
+};
+
+class PersistCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: PERSIST <key>
+         */
+        if (query.cmd_args.size() != 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Persist, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(Database::GetInstance()->Persist(query.cmd_args[1]));
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class PrefixCountCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: PREFIXCOUNT <prefix>
+         */
+        if (query.cmd_args.size() != 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command PrefixCount, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(
+                static_cast<int64_t>(Database::GetInstance()->CountKeysWithPrefix(query.cmd_args[1])));
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class SelectCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SELECT <index>
+         */
+        if (query.cmd_args.size() != 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Select, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        int db;
+        if (!ParseDbIndex(query.cmd_args[1], db, client))
+            return;
+
+        /// the following commands of this client, and of the batch being executed, apply to @param db
+        client->SetDb(db);
+        Database::SelectDb(db);
+
+        client->WriteAsync(RESP_OK, APP_RECV | ALL_SEND);
+    }
+
+public:
+    /// parse a database index, reply the error to @param client if it is not a valid one
+    static bool ParseDbIndex(const std::string &arg, int &db, const std::shared_ptr<Client> &client) {
+        int64_t value;
+        if (!StringToInt64(arg, value)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+            return false;
+        }
+
+        if (value < 0 || value >= Database::GetInstance()->Databases()) {
+            client->WriteAsync(RESP_DB_OUT_OF_RANGE, APP_RECV | ALL_SEND);
+            return false;
+        }
+
+        db = static_cast<int>(value);
+        return true;
+    }
+};
+
+class MoveCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MOVE <key> <db>
+         */
+        if (query.cmd_args.size() != 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Move, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int db;
+        if (!SelectCommandExecutor::ParseDbIndex(query.cmd_args[2], db, client))
+            return;
+
+        if (db == Database::SelectedDb()) {
+            client->WriteAsync(RESP_SAME_OBJECT, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(Database::GetInstance()->MoveKey(query.cmd_args[1], db));
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class SwapDbCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SWAPDB <index1> <index2>
+         */
+        if (query.cmd_args.size() != 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command SwapDb, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int db1, db2;
+        if (!SelectCommandExecutor::ParseDbIndex(query.cmd_args[1], db1, client) ||
+            !SelectCommandExecutor::ParseDbIndex(query.cmd_args[2], db2, client))
+            return;
 
-            std::string stream_id_resp = ConvertEntryIdToRESP(stream_id);
-            std::string entry_stream_resp = ConvertEntryStreamToRESP(entry_stream);
+        Database::GetInstance()->SwapDb(db1, db2);
 
-            resp_entries.push_back(EncodeArr2RespArr2({stream_id_resp, entry_stream_resp}));
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+};
+
+class MGetCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MGET <key> [key ...]
+         */
+        if (query.cmd_args.size() < 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command MGet, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// the values are encoded straight from the keyspace, without copying them out first
+        std::string reply;
+        RespWriter writer(reply);
+        auto keys = std::span<const std::string>(query.cmd_args).subspan(1);
+        writer.AppendArrayHeader(keys.size());
+        char buf[OBJ_INT_STR_LEN];
+        std::string scratch;
+        Database::GetInstance()->MultiGet(keys, [&](const RedisObject *obj) {
+            if (obj) {
+                writer.AppendBulkStr(obj->StringView(buf, scratch));
+            } else {
+                writer.AppendNil();
+            }
+        });
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class MSetCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit MSetCommandExecutor(bool nx) : nx_(nx) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MSET | MSETNX <key> <value> [key value ...]
+         */
+        if (query.cmd_args.size() < 3 || query.cmd_args.size() % 2 == 0) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        bool set = Database::GetInstance()->MultiSet(std::span<const std::string>(query.cmd_args).subspan(1), nx_);
+
+        if (!nx_) {
+            client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(set ? 1 : 0);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+private:
+    bool nx_;
+};
+
+class HSetCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: HSET <key> <field> <value> [field value ...]
+         */
+        if (query.cmd_args.size() < 4 || query.cmd_args.size() % 2 != 0) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command HSet, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int added = Database::GetInstance()->HashSet(query.cmd_args[1],
+                                                     std::span<const std::string>(query.cmd_args).subspan(2));
+        if (added < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(added);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class HDelCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: HDEL <key> <field> [field ...]
+         */
+        if (query.cmd_args.size() < 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command HDel, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
         }
 
-        client->WriteAsync(EncodeArr2RespArr2(resp_entries), APP_RECV | ALL_SEND);
+        int deleted = Database::GetInstance()->HashDelete(query.cmd_args[1],
+                                                          std::span<const std::string>(query.cmd_args).subspan(2));
+        if (deleted < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(deleted);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
     }
 };
 
+class HIncrByCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: HINCRBY <key> <field> <increment>
+         */
+        if (query.cmd_args.size() != 4) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command HIncrBy, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t delta;
+        if (!StringToInt64(query.cmd_args[3], delta)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t result;
+        int ret = Database::GetInstance()->HashIncrBy(query.cmd_args[1], query.cmd_args[2], delta, result);
+        if (ret < 0) {
+            LOG_ERROR(EXECUTOR, "HINCRBY %s %s fail %d", query.cmd_args[1].c_str(), query.cmd_args[2].c_str(), ret);
+            client->WriteAsync(ret == HashValueNotIntegerError ? RESP_HASH_NOT_INTEGER
+                                                               : IncrDecrCommandExecutor::IncrErrorReply(ret),
+                               APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(result);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class HashReadCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit HashReadCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: HGET <key> <field> | HMGET <key> <field> [field ...] | HGETALL <key> | HLEN <key> |
+         *         HEXISTS <key> <field>
+         */
+        size_t argc = query.cmd_args.size();
+        bool valid_argc;
+        switch (cmd_type_) {
+            case HMGetCmd:
+                valid_argc = argc >= 3;
+                break;
+            case HGetAllCmd:
+            case HLenCmd:
+                valid_argc = argc == 2;
+                break;
+            default:
+                valid_argc = argc == 3;
+                break;
+        }
+        if (!valid_argc) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(), argc);
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// the values are encoded straight from the hash, without copying them out first
+        std::string reply;
+        RespWriter writer(reply);
+        char buf[OBJ_INT_STR_LEN];
+        std::string_view value;
+        int ret = Database::GetInstance()->ReadObject(query.cmd_args[1], ObjHash, [&](const RedisObject *obj) {
+            switch (cmd_type_) {
+                case HGetCmd:
+                    if (obj && obj->HashGet(query.cmd_args[2], value, buf)) {
+                        writer.AppendBulkStr(value);
+                    } else {
+                        writer.AppendNil();
+                    }
+                    break;
+                case HMGetCmd:
+                    writer.AppendArrayHeader(argc - 2);
+                    for (size_t i = 2; i < argc; ++i) {
+                        if (obj && obj->HashGet(query.cmd_args[i], value, buf)) {
+                            writer.AppendBulkStr(value);
+                        } else {
+                            writer.AppendNil();
+                        }
+                    }
+                    break;
+                case HGetAllCmd:
+                    writer.AppendArrayHeader(obj ? 2 * obj->HashLength() : 0);
+                    if (obj) {
+                        obj->HashForEach([&writer](std::string_view field, std::string_view value) {
+                            writer.AppendBulkStr(field).AppendBulkStr(value);
+                        });
+                    }
+                    break;
+                case HLenCmd:
+                    writer.AppendInteger(obj ? static_cast<int64_t>(obj->HashLength()) : 0);
+                    break;
+                default:
+                    writer.AppendInteger(obj && obj->HashGet(query.cmd_args[2], value, buf) ? 1 : 0);
+                    break;
+            }
+        });
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class ListPushCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit ListPushCommandExecutor(bool head) : head_(head) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: LPUSH | RPUSH <key> <element> [element ...]
+         */
+        if (query.cmd_args.size() < 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t len = Database::GetInstance()->ListPush(query.cmd_args[1],
+                                                        std::span<const std::string>(query.cmd_args).subspan(2),
+                                                        head_);
+        if (len < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(len);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+private:
+    bool head_;
+};
+
+class ListPopCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit ListPopCommandExecutor(bool head) : head_(head) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: LPOP | RPOP <key> [count]
+         */
+        size_t argc = query.cmd_args.size();
+        if (argc != 2 && argc != 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(), argc);
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t count = 1;
+        if (argc == 3 && !StringToInt64(query.cmd_args[2], count)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | MASTER_SEND);
+            return;
+        }
+        if (count < 0) {
+            client->WriteAsync(RESP_NOT_POSITIVE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::vector<std::string> elements;
+        int ret = Database::GetInstance()->ListPop(query.cmd_args[1], static_cast<size_t>(count), head_, elements);
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// without a count, a single element or nil, with one an array or a nil array
+        std::string reply;
+        RespWriter writer(reply);
+        if (argc == 2) {
+            if (elements.empty())
+                writer.AppendNil();
+            else
+                writer.AppendBulkStr(elements[0]);
+        } else if (ret == 0) {
+            writer.AppendNilArray();
+        } else {
+            writer.AppendArrayHeader(elements.size());
+            for (auto &e: elements)
+                writer.AppendBulkStr(e);
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+
+private:
+    bool head_;
+};
+
+class LTrimCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: LTRIM <key> <start> <stop>
+         */
+        if (query.cmd_args.size() != 4) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command LTrim, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int64_t start, stop;
+        if (!StringToInt64(query.cmd_args[2], start) || !StringToInt64(query.cmd_args[3], stop)) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        if (Database::GetInstance()->ListTrim(query.cmd_args[1], start, stop) < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+};
+
+class ListReadCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit ListReadCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: LRANGE <key> <start> <stop> | LINDEX <key> <index> | LLEN <key>
+         */
+        size_t argc = query.cmd_args.size();
+        size_t expected_argc = (cmd_type_ == LRangeCmd) ? 4 : (cmd_type_ == LIndexCmd) ? 3 : 2;
+        if (argc != expected_argc) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(), argc);
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        int64_t start = 0, stop = 0;
+        if ((argc > 2 && !StringToInt64(query.cmd_args[2], start)) ||
+            (argc > 3 && !StringToInt64(query.cmd_args[3], stop))) {
+            client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// the elements are encoded straight from the nodes, without copying them out first
+        std::string reply;
+        RespWriter writer(reply);
+        int ret = Database::GetInstance()->ReadObject(query.cmd_args[1], ObjList, [&](const RedisObject *obj) {
+            auto len = obj ? static_cast<int64_t>(obj->GetList()->Length()) : 0;
+            switch (cmd_type_) {
+                case LRangeCmd: {
+                    if (start < 0)
+                        start = std::max<int64_t>(start + len, 0);
+                    if (stop < 0)
+                        stop += len;
+                    stop = std::min(stop, len - 1);
+                    if (start > stop) {
+                        writer.AppendArrayHeader(0);
+                        break;
+                    }
+
+                    writer.AppendArrayHeader(stop - start + 1);
+                    obj->GetList()->Range(start, stop - start + 1, [&writer](std::string_view e) {
+                        writer.AppendBulkStr(e);
+                    });
+                    break;
+                }
+                case LIndexCmd: {
+                    std::string element;
+                    if (obj && obj->GetList()->Index(start, element)) {
+                        writer.AppendBulkStr(element);
+                    } else {
+                        writer.AppendNil();
+                    }
+                    break;
+                }
+                default:
+                    writer.AppendInteger(len);
+                    break;
+            }
+        });
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class LMoveCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    /// LEFT or RIGHT, in any case, as @param head
+    static bool ParseWhere(std::string where, bool &head) {
+        std::transform(where.begin(), where.end(), where.begin(), ::toupper);
+        if (where != "LEFT" && where != "RIGHT")
+            return false;
+
+        head = (where == "LEFT");
+        return true;
+    }
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: LMOVE <source> <destination> <LEFT | RIGHT> <LEFT | RIGHT>
+         */
+        if (query.cmd_args.size() != 5) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command LMove, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        bool from_head, to_head;
+        if (!ParseWhere(query.cmd_args[3], from_head) || !ParseWhere(query.cmd_args[4], to_head)) {
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string element;
+        int ret = Database::GetInstance()->ListMove(query.cmd_args[1], query.cmd_args[2], from_head, to_head,
+                                                    element);
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+        if (ret == 0) {
+            client->WriteAsync(RESP_NIL, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendBulkStr(element);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class BlockingPopCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit BlockingPopCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: BLPOP | BRPOP <key> [key ...] <timeout> |
+         *         BLMOVE <source> <destination> <LEFT | RIGHT> <LEFT | RIGHT> <timeout>
+         */
+        auto &args = query.cmd_args;
+        bool move = (cmd_type_ == BLMoveCmd);
+        if (move ? args.size() != 6 : args.size() < 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", args[0].c_str(), args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        BlockedPop pop;
+        pop.cmd_type = cmd_type_;
+        pop.db = client->Db();
+        if (move && (!LMoveCommandExecutor::ParseWhere(args[3], pop.from_head) ||
+                     !LMoveCommandExecutor::ParseWhere(args[4], pop.to_head))) {
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// in seconds, 0 waits forever
+        long double timeout;
+        if (!StringToLongDouble(args.back(), timeout) || std::isinf(timeout)) {
+            client->WriteAsync(RESP_TIMEOUT_NOT_FLOAT, APP_RECV | MASTER_SEND);
+            return;
+        }
+        if (timeout < 0) {
+            client->WriteAsync(RESP_TIMEOUT_NEGATIVE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// a list with an element is served at once, and the command is propagated as the pop that was done
+        auto db = Database::GetInstance();
+        std::string reply;
+        RespWriter writer(reply);
+        if (move) {
+            std::string element;
+            int ret = db->ListMove(args[1], args[2], pop.from_head, pop.to_head, element);
+            if (ret < 0) {
+                client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+                return;
+            }
+            if (ret > 0) {
+                writer.AppendBulkStr(element);
+                args = {"LMOVE", args[1], args[2], args[3], args[4]};
+                query.cmd = Server::GetInstance()->GetRedisCommand("lmove");
+                client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+                return;
+            }
+            pop.keys.push_back(args[1]);
+            pop.destination = args[2];
+        } else {
+            bool head = (cmd_type_ == BLPopCmd);
+            std::vector<std::string> elements;
+            for (size_t i = 1; i + 1 < args.size(); ++i) {
+                if (db->ListPop(args[i], 1, head, elements) < 0) {
+                    client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+                    return;
+                }
+                if (!elements.empty()) {
+                    writer.AppendArrayHeader(2).AppendBulkStr(args[i]).AppendBulkStr(elements[0]);
+                    args = {head ? "LPOP" : "RPOP", args[i]};
+                    query.cmd = Server::GetInstance()->GetRedisCommand(head ? "lpop" : "rpop");
+                    client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+                    return;
+                }
+            }
+            pop.keys.assign(args.begin() + 1, args.end() - 1);
+        }
+
+        /// nothing was written, nothing is propagated
+        query.flags &= ~(WRITE_CMD | REPL_CMD);
+        if (client->DenyBlocking()) {
+            client->WriteAsync(move ? RESP_NIL : RESP_NIL_ARRAY, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// a timeout too far for the clock waits forever too
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<long double> wait(timeout);
+        if (timeout > 0 && wait < std::chrono::steady_clock::time_point::max() - now)
+            pop.deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+
+        /// the reply is written once served or timed out
+        Server::GetInstance()->GetBlockedClients().Block(client, std::move(pop));
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class SAddCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SADD <key> <member> [member ...]
+         */
+        if (query.cmd_args.size() < 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command SAdd, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int added = Database::GetInstance()->SetAdd(query.cmd_args[1],
+                                                    std::span<const std::string>(query.cmd_args).subspan(2));
+        if (added < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(added);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class SRemCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SREM <key> <member> [member ...]
+         */
+        if (query.cmd_args.size() < 3) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command SRem, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        int removed = Database::GetInstance()->SetRemove(query.cmd_args[1],
+                                                         std::span<const std::string>(query.cmd_args).subspan(2));
+        if (removed < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(removed);
+
+        client->WriteAsync(std::move(reply), APP_RECV | MASTER_SEND);
+    }
+};
+
+class SetReadCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit SetReadCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SISMEMBER <key> <member> | SMISMEMBER <key> <member> [member ...] | SMEMBERS <key> | SCARD <key>
+         */
+        size_t argc = query.cmd_args.size();
+        bool valid_argc;
+        switch (cmd_type_) {
+            case SIsMemberCmd:
+                valid_argc = argc == 3;
+                break;
+            case SMIsMemberCmd:
+                valid_argc = argc >= 3;
+                break;
+            default:
+                valid_argc = argc == 2;
+                break;
+        }
+        if (!valid_argc) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(), argc);
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter writer(reply);
+        int ret = Database::GetInstance()->ReadObject(query.cmd_args[1], ObjSet, [&](const RedisObject *obj) {
+            switch (cmd_type_) {
+                case SIsMemberCmd:
+                    writer.AppendInteger(obj && obj->SetContains(query.cmd_args[2]) ? 1 : 0);
+                    break;
+                case SMIsMemberCmd:
+                    writer.AppendArrayHeader(argc - 2);
+                    for (size_t i = 2; i < argc; ++i) {
+                        writer.AppendInteger(obj && obj->SetContains(query.cmd_args[i]) ? 1 : 0);
+                    }
+                    break;
+                case SMembersCmd:
+                    writer.AppendArrayHeader(obj ? obj->SetLength() : 0);
+                    if (obj) {
+                        obj->SetForEach([&writer](std::string_view member) { writer.AppendBulkStr(member); });
+                    }
+                    break;
+                default:
+                    writer.AppendInteger(obj ? static_cast<int64_t>(obj->SetLength()) : 0);
+                    break;
+            }
+        });
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class SetAlgebraCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit SetAlgebraCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SINTER <key> [key ...] | SUNION <key> [key ...] | SDIFF <key> [key ...] |
+         *         SINTERCARD <numkeys> <key> [key ...] [LIMIT limit]
+         */
+        size_t argc = query.cmd_args.size();
+        if (argc < ((cmd_type_ == SInterCardCmd) ? 3 : 2)) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(), argc);
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        auto keys = std::span<const std::string>(query.cmd_args).subspan(1);
+        int64_t limit = 0;
+        if (cmd_type_ == SInterCardCmd) {
+            int64_t numkeys;
+            if (!StringToInt64(query.cmd_args[1], numkeys)) {
+                client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                return;
+            }
+            if (numkeys <= 0) {
+                client->WriteAsync(RESP_NUMKEYS_NOT_POSITIVE, APP_RECV | ALL_SEND);
+                return;
+            }
+            if (static_cast<uint64_t>(numkeys) > argc - 2) {
+                client->WriteAsync(RESP_NUMKEYS_TOO_MANY, APP_RECV | ALL_SEND);
+                return;
+            }
+
+            for (size_t i = 2 + numkeys; i < argc; i += 2) {
+                std::string option = query.cmd_args[i];
+                std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+                if (option != "LIMIT" || i + 1 == argc) {
+                    client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                    return;
+                }
+                if (!StringToInt64(query.cmd_args[i + 1], limit)) {
+                    client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                    return;
+                }
+                if (limit < 0) {
+                    client->WriteAsync(RESP_LIMIT_NEGATIVE, APP_RECV | ALL_SEND);
+                    return;
+                }
+            }
+            keys = keys.subspan(1, numkeys);
+        }
+
+        /// the members are encoded into the body as they come, the array header goes before it once they are counted
+        std::string body;
+        RespWriter body_writer(body);
+        size_t count = 0;
+        auto append = [&body_writer](std::string_view member) { body_writer.AppendBulkStr(member); };
+        int ret = Database::GetInstance()->ReadObjects(keys, ObjSet, [&](const std::vector<const RedisObject *> &sets) {
+            switch (cmd_type_) {
+                case SInterCmd:
+                    count = RedisObject::SetIntersection(sets, 0, append);
+                    break;
+                case SInterCardCmd:
+                    count = RedisObject::SetIntersection(sets, limit, nullptr);
+                    break;
+                case SUnionCmd:
+                    count = RedisObject::SetUnion(sets, append);
+                    break;
+                default:
+                    count = RedisObject::SetDifference(sets, append);
+                    break;
+            }
+        });
+        if (ret < 0) {
+            client->WriteAsync(RESP_WRONGTYPE, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        std::string reply;
+        RespWriter writer(reply);
+        if (cmd_type_ == SInterCardCmd) {
+            writer.AppendInteger(static_cast<int64_t>(count));
+        } else {
+            writer.AppendArrayHeader(count).AppendRaw(body);
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    CommandType cmd_type_;
+};
+
+class MemoryUsageCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MEMORY USAGE <key> [SAMPLES count]
+         */
+        if (query.cmd_args.size() != 3 && query.cmd_args.size() != 5) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Memory Usage, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// 0 means every element of a collection
+        int64_t samples = MEMORY_USAGE_SAMPLES;
+        if (query.cmd_args.size() == 5) {
+            std::string opt = query.cmd_args[3];
+            std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+            if (opt != "SAMPLES") {
+                client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                return;
+            }
+            if (!StringToInt64(query.cmd_args[4], samples) || samples < 0) {
+                client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                return;
+            }
+        }
+
+        std::string reply;
+        size_t bytes;
+        if (Database::GetInstance()->KeyMemoryUsage(query.cmd_args[2], static_cast<size_t>(samples), bytes)) {
+            RespWriter(reply).AppendInteger(static_cast<int64_t>(bytes));
+        } else {
+            RespWriter(reply).AppendNil();
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class MemoryStatsCommandExecutor : public AbstractInternalCommandExecutor {
+    static std::string FormatDouble(double value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", value);
+        return buf;
+    }
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MEMORY STATS
+         */
+        if (query.cmd_args.size() != 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command Memory Stats, argc = %zu", query.cmd_args.size());
+            client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        static const char *type_names[OBJ_TYPES] = {"string", "list", "set", "zset", "hash", "stream"};
+
+        MemoryOverhead mem = Server::GetInstance()->GetMemoryOverhead();
+        size_t rss = ZmallocRss();
+        size_t keys = 0;
+        std::array<size_t, OBJ_TYPES> type_keys{};
+        std::array<size_t, OBJ_TYPES> type_bytes{};
+        for (auto &[db, keyspace]: mem.dbs) {
+            keys += keyspace.keys;
+            for (int type = 0; type < OBJ_TYPES; ++type) {
+                type_keys[type] += keyspace.type_keys[type];
+                type_bytes[type] += keyspace.type_bytes[type];
+            }
+        }
+        size_t types = std::count_if(type_keys.begin(), type_keys.end(), [](size_t n) { return n > 0; });
+
+        std::string reply;
+        RespWriter writer(reply);
+        writer.AppendArrayHeader(2 * (19 + mem.dbs.size() + types));
+        auto append_int = [&writer](std::string_view name, size_t value) {
+            writer.AppendBulkStr(name).AppendInteger(static_cast<int64_t>(value));
+        };
+
+        append_int("peak.allocated", mem.peak);
+        append_int("total.allocated", mem.total);
+        append_int("startup.allocated", mem.startup);
+        append_int("replication.backlog", mem.repl_backlog);
+        append_int("clients.slaves", mem.clients_slaves);
+        append_int("clients.normal", mem.clients_normal);
+        append_int("query.buffers", mem.query_buffers);
+        append_int("keyindex.allocated", mem.key_index);
+        for (auto &[db, keyspace]: mem.dbs) {
+            writer.AppendBulkStr("db." + std::to_string(db)).AppendArrayHeader(4);
+            append_int("overhead.hashtable.main", keyspace.hashtable_bytes);
+            append_int("overhead.hashtable.expires", keyspace.expires_bytes);
+        }
+        append_int("overhead.total", mem.overhead);
+        append_int("keys.count", keys);
+        append_int("keys.bytes-per-key", keys > 0 ? (mem.total - std::min(mem.total, mem.startup)) / keys : 0);
+        append_int("dataset.bytes", mem.dataset);
+        /// the estimated keys and bytes of every type present, their bytes are the key names and values only
+        for (int type = 0; type < OBJ_TYPES; ++type) {
+            if (type_keys[type] == 0)
+                continue;
+            writer.AppendBulkStr(std::string("dataset.") + type_names[type]).AppendArrayHeader(4);
+            append_int("keys", type_keys[type]);
+            append_int("bytes", type_bytes[type]);
+        }
+
+        size_t net = mem.total - std::min(mem.total, mem.startup);
+        writer.AppendBulkStr("dataset.percentage")
+                .AppendBulkStr(FormatDouble(net > 0 ? static_cast<double>(mem.dataset) * 100 / net : 0));
+        writer.AppendBulkStr("peak.percentage")
+                .AppendBulkStr(FormatDouble(mem.peak > 0 ? static_cast<double>(mem.total) * 100 / mem.peak : 0));
+        append_int("allocator.resident", rss);
+        writer.AppendBulkStr("fragmentation")
+                .AppendBulkStr(FormatDouble(mem.total > 0 ? static_cast<double>(rss) / mem.total : 0));
+        append_int("fragmentation.bytes", rss - std::min(rss, mem.total));
+        append_int("lazyfree.pending_objects", LazyFree::GetInstance()->Pending());
+        append_int("evicted.keys", Database::GetInstance()->EvictedKeys());
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class HotKeysCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: HOTKEYS [WRITES] [COUNT count] | HOTKEYS RESET
+         */
+        auto hot_keys = HotKeys::GetInstance();
+        bool writes = false;
+        int64_t count = HOTKEYS_MAX_TOP_K;
+        for (size_t i = 1; i < query.cmd_args.size(); ++i) {
+            std::string opt = query.cmd_args[i];
+            std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+            if (opt == "RESET" && query.cmd_args.size() == 2) {
+                hot_keys->Reset();
+                client->WriteAsync(RESP_OK, APP_RECV | ALL_SEND);
+                return;
+            } else if (opt == "WRITES") {
+                writes = true;
+            } else if (opt == "COUNT" && i + 1 < query.cmd_args.size()) {
+                if (!StringToInt64(query.cmd_args[++i], count) || count <= 0) {
+                    client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                    return;
+                }
+            } else {
+                client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                return;
+            }
+        }
+
+        if (!hot_keys->Enabled()) {
+            client->WriteAsync(RESP_HOTKEYS_OFF, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// key, estimated count, the hottest first
+        auto top = hot_keys->Top(static_cast<size_t>(count), writes);
+        std::string reply;
+        RespWriter writer(reply);
+        writer.AppendArrayHeader(2 * top.size());
+        for (auto &[key, estimate]: top) {
+            writer.AppendBulkStr(key).AppendInteger(static_cast<int64_t>(estimate));
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class KeyspaceStatsCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: KEYSPACE-STATS [PREFIX prefix] [COUNT count]
+         */
+        std::optional<std::string> only_prefix;
+        int64_t count = INT64_MAX;
+        for (size_t i = 1; i < query.cmd_args.size(); ++i) {
+            std::string opt = query.cmd_args[i];
+            std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+            if (opt == "PREFIX" && i + 1 < query.cmd_args.size()) {
+                only_prefix = query.cmd_args[++i];
+            } else if (opt == "COUNT" && i + 1 < query.cmd_args.size()) {
+                if (!StringToInt64(query.cmd_args[++i], count) || count <= 0) {
+                    client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                    return;
+                }
+            } else {
+                client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                return;
+            }
+        }
+
+        auto db = Database::GetInstance();
+        if (!db->KeyspaceStatsEnabled()) {
+            client->WriteAsync(RESP_KEYSPACE_STATS_OFF, APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// the prefixes using the most memory first, the ones left with nothing to report are skipped
+        std::vector<std::pair<std::string, PrefixUsage>> prefixes;
+        for (auto &[prefix, usage]: db->GetPrefixStats()) {
+            if (only_prefix && prefix != *only_prefix)
+                continue;
+            if (usage.keys != 0 || usage.bytes != 0 || usage.reads != 0 || usage.writes != 0)
+                prefixes.emplace_back(prefix, usage);
+        }
+        std::sort(prefixes.begin(), prefixes.end(), [](const auto &a, const auto &b) {
+            return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first;
+        });
+        if (prefixes.size() > static_cast<uint64_t>(count))
+            prefixes.resize(count);
+
+        std::string reply;
+        RespWriter writer(reply);
+        writer.AppendArrayHeader(prefixes.size());
+        for (auto &[prefix, usage]: prefixes) {
+            writer.AppendArrayHeader(9).AppendBulkStr(prefix)
+                    .AppendBulkStr("keys").AppendInteger(usage.keys)
+                    .AppendBulkStr("bytes").AppendInteger(usage.bytes)
+                    .AppendBulkStr("reads").AppendInteger(static_cast<int64_t>(usage.reads))
+                    .AppendBulkStr("writes").AppendInteger(static_cast<int64_t>(usage.writes));
+        }
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+};
+
+class TtlCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit TtlCommandExecutor(bool in_ms) : in_ms_(in_ms) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: TTL | PTTL <key>
+         */
+        if (query.cmd_args.size() != 2) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// -2 when the key does not exist, -1 when it has no expire time
+        int64_t ttl = Database::GetInstance()->GetTtlMs(query.cmd_args[1]);
+        if (ttl >= 0 && !in_ms_)
+            ttl = (ttl + 500) / 1000;
+
+        std::string reply;
+        RespWriter(reply).AppendInteger(ttl);
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    bool in_ms_;
+};
+
+class ScanCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit ScanCommandExecutor(CommandType cmd_type) : cmd_type_(cmd_type) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: SCAN <cursor> [MATCH pattern] [COUNT count] [TYPE type]
+         *         HSCAN | SSCAN | ZSCAN <key> <cursor> [MATCH pattern] [COUNT count]
+         */
+        size_t cursor_idx = (cmd_type_ == ScanCmd) ? 1 : 2;
+        if (query.cmd_args.size() <= cursor_idx) {
+            LOG_ERROR(EXECUTOR, "Invalid argc of command %s, argc = %zu", query.cmd_args[0].c_str(),
+                      query.cmd_args.size());
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | ALL_SEND);
+            return;
+        }
+
+        uint64_t cursor;
+        auto &arg = query.cmd_args[cursor_idx];
+        auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), cursor);
+        if (ec != std::errc() || end != arg.data() + arg.size()) {
+            client->WriteAsync("-ERR invalid cursor\r\n", APP_RECV | ALL_SEND);
+            return;
+        }
+
+        /// parse the options
+        std::string pattern, type;
+        int64_t count = SCAN_DEFAULT_COUNT;
+        for (size_t i = cursor_idx + 1; i < query.cmd_args.size(); i += 2) {
+            std::string opt = query.cmd_args[i];
+            std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+            if (i + 1 >= query.cmd_args.size()) {
+                client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                return;
+            }
+
+            auto &val = query.cmd_args[i + 1];
+            if (opt == "MATCH") {
+                /// "*" matches everything, skip the matching
+                pattern = (val == "*") ? "" : val;
+            } else if (opt == "COUNT") {
+                if (!StringToInt64(val, count)) {
+                    client->WriteAsync(RESP_NOT_INTEGER, APP_RECV | ALL_SEND);
+                    return;
+                }
+                if (count < 1) {
+                    client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                    return;
+                }
+            } else if (opt == "TYPE" && cmd_type_ == ScanCmd) {
+                type = val;
+            } else {
+                client->WriteAsync(RESP_SYNTAX_ERROR, APP_RECV | ALL_SEND);
+                return;
+            }
+        }
+
+        std::vector<std::string> elements;
+        uint64_t next_cursor = 0;
+        if (cmd_type_ == ScanCmd) {
+            next_cursor = Database::GetInstance()->Scan(cursor, count, pattern, type, elements);
+        } else {
+            next_cursor = cursor;
+            int ret = Database::GetInstance()->ScanCollection(query.cmd_args[1], CollectionType(), next_cursor, count,
+                                                              pattern, elements);
+            if (ret == WrongTypeError) {
+                client->WriteAsync(RESP_WRONGTYPE, APP_RECV | ALL_SEND);
+                return;
+            }
+        }
+
+        /// [cursor, [elements...]]
+        std::string reply;
+        RespWriter writer(reply);
+        writer.AppendArrayHeader(2);
+        writer.AppendBulkStr(std::to_string(next_cursor));
+        writer.AppendCommand(elements);
+
+        client->WriteAsync(std::move(reply), APP_RECV | ALL_SEND);
+    }
+
+private:
+    int CollectionType() const {
+        switch (cmd_type_) {
+            case HScanCmd:
+                return ObjHash;
+            case SScanCmd:
+                return ObjSet;
+            default:
+                return ObjZset;
+        }
+    }
+
+    CommandType cmd_type_;
+};
+
+class MultiCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &, std::shared_ptr<Client> client) override {
+        /**
+         * Format: MULTI
+         */
+        MultiState &multi = client->Multi();
+        if (multi.active) {
+            client->WriteAsync(RESP_MULTI_NESTED, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        multi.active = true;
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+};
+
+class ExecCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &, std::shared_ptr<Client> client) override {
+        /**
+         * Format: EXEC
+         */
+        client->ExecTransaction();
+    }
+};
+
+class DiscardCommandExecutor : public AbstractInternalCommandExecutor {
+    void execute(Query &, std::shared_ptr<Client> client) override {
+        /**
+         * Format: DISCARD
+         */
+        MultiState &multi = client->Multi();
+        if (!multi.active) {
+            client->WriteAsync(RESP_DISCARD_WITHOUT_MULTI, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        multi.Reset();
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+};
+
+class WatchCommandExecutor : public AbstractInternalCommandExecutor {
+public:
+    explicit WatchCommandExecutor(bool unwatch) : unwatch_(unwatch) {}
+
+    void execute(Query &query, std::shared_ptr<Client> client) override {
+        /**
+         * Format: WATCH key [key ...] | UNWATCH
+         */
+        MultiState &multi = client->Multi();
+        if (unwatch_) {
+            multi.watched.clear();
+            client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        if (query.cmd_args.size() < 2) {
+            client->WriteAsync(IncrDecrCommandExecutor::WrongArgcReply(query.cmd_args[0]), APP_RECV | MASTER_SEND);
+            return;
+        }
+        if (multi.active) {
+            client->WriteAsync(RESP_WATCH_IN_MULTI, APP_RECV | MASTER_SEND);
+            return;
+        }
+
+        /// the version seen now, EXEC fails if it moved
+        int db = client->Db();
+        for (size_t i = 1; i < query.cmd_args.size(); ++i) {
+            multi.watched.push_back({db, query.cmd_args[i],
+                                     Database::GetInstance()->KeyVersion(db, query.cmd_args[i])});
+        }
+        client->WriteAsync(RESP_OK, APP_RECV | MASTER_SEND);
+    }
+
+private:
+    bool unwatch_;
+};
+
 class UnknownCommandExecutor : public AbstractInternalCommandExecutor {
-    void execute(const Query &query, std::shared_ptr<Client> client) override {
+    void execute(Query &, std::shared_ptr<Client> client) override {
 
         /// FIXME: handle with unknown command
         LOG_INFO(EXECUTOR, "Unknown command");
@@ -622,6 +2204,110 @@ AbstractInternalCommandExecutor::createCommandExecutor(const CommandType cmd_typ
             return std::make_shared<XAddCommandExecutor>();
         case XRangeCmd:
             return std::make_shared<XRangeCommandExecutor>();
+        case IncrCmd:
+        case DecrCmd:
+        case IncrByCmd:
+        case DecrByCmd:
+            return std::make_shared<IncrDecrCommandExecutor>(cmd_type);
+        case IncrByFloatCmd:
+            return std::make_shared<IncrByFloatCommandExecutor>();
+        case DelCmd:
+            return std::make_shared<DelCommandExecutor>(false);
+        case UnlinkCmd:
+            return std::make_shared<DelCommandExecutor>(true);
+        case FlushAllCmd:
+        case FlushDbCmd:
+            return std::make_shared<FlushCommandExecutor>(cmd_type);
+        case ScanCmd:
+        case HScanCmd:
+        case SScanCmd:
+        case ZScanCmd:
+            return std::make_shared<ScanCommandExecutor>(cmd_type);
+        case PrefixCountCmd:
+            return std::make_shared<PrefixCountCommandExecutor>();
+        case SelectCmd:
+            return std::make_shared<SelectCommandExecutor>();
+        case MoveCmd:
+            return std::make_shared<MoveCommandExecutor>();
+        case SwapDbCmd:
+            return std::make_shared<SwapDbCommandExecutor>();
+        case MGetCmd:
+            return std::make_shared<MGetCommandExecutor>();
+        case MSetCmd:
+        case MSetNxCmd:
+            return std::make_shared<MSetCommandExecutor>(cmd_type == MSetNxCmd);
+        case MemoryUsageCmd:
+            return std::make_shared<MemoryUsageCommandExecutor>();
+        case MemoryStatsCmd:
+            return std::make_shared<MemoryStatsCommandExecutor>();
+        case HSetCmd:
+            return std::make_shared<HSetCommandExecutor>();
+        case HDelCmd:
+            return std::make_shared<HDelCommandExecutor>();
+        case HIncrByCmd:
+            return std::make_shared<HIncrByCommandExecutor>();
+        case HGetCmd:
+        case HMGetCmd:
+        case HGetAllCmd:
+        case HLenCmd:
+        case HExistsCmd:
+            return std::make_shared<HashReadCommandExecutor>(cmd_type);
+        case LPushCmd:
+        case RPushCmd:
+            return std::make_shared<ListPushCommandExecutor>(cmd_type == LPushCmd);
+        case LPopCmd:
+        case RPopCmd:
+            return std::make_shared<ListPopCommandExecutor>(cmd_type == LPopCmd);
+        case LTrimCmd:
+            return std::make_shared<LTrimCommandExecutor>();
+        case LMoveCmd:
+            return std::make_shared<LMoveCommandExecutor>();
+        case BLPopCmd:
+        case BRPopCmd:
+        case BLMoveCmd:
+            return std::make_shared<BlockingPopCommandExecutor>(cmd_type);
+        case LRangeCmd:
+        case LIndexCmd:
+        case LLenCmd:
+            return std::make_shared<ListReadCommandExecutor>(cmd_type);
+        case SAddCmd:
+            return std::make_shared<SAddCommandExecutor>();
+        case SRemCmd:
+            return std::make_shared<SRemCommandExecutor>();
+        case SIsMemberCmd:
+        case SMIsMemberCmd:
+        case SMembersCmd:
+        case SCardCmd:
+            return std::make_shared<SetReadCommandExecutor>(cmd_type);
+        case SInterCmd:
+        case SInterCardCmd:
+        case SUnionCmd:
+        case SDiffCmd:
+            return std::make_shared<SetAlgebraCommandExecutor>(cmd_type);
+        case KeyspaceStatsCmd:
+            return std::make_shared<KeyspaceStatsCommandExecutor>();
+        case HotKeysCmd:
+            return std::make_shared<HotKeysCommandExecutor>();
+        case MultiCmd:
+            return std::make_shared<MultiCommandExecutor>();
+        case ExecCmd:
+            return std::make_shared<ExecCommandExecutor>();
+        case DiscardCmd:
+            return std::make_shared<DiscardCommandExecutor>();
+        case WatchCmd:
+        case UnwatchCmd:
+            return std::make_shared<WatchCommandExecutor>(cmd_type == UnwatchCmd);
+        case ExpireCmd:
+        case PExpireCmd:
+        case ExpireAtCmd:
+        case PExpireAtCmd:
+            return std::make_shared<ExpireCommandExecutor>(cmd_type);
+        case PersistCmd:
+            return std::make_shared<PersistCommandExecutor>();
+        case TtlCmd:
+            return std::make_shared<TtlCommandExecutor>(false);
+        case PTtlCmd:
+            return std::make_shared<TtlCommandExecutor>(true);
         default:
             std::cerr << "Unknown command type: " << cmd_type << std::endl;
             return std::make_shared<UnknownCommandExecutor>();
@@ -13,6 +13,7 @@
 
 #include "Utils.h"
 #include "Database.h"
+#include "RespWriter.h"
 
 class Client;
 
@@ -25,7 +26,7 @@ public:
 
     virtual ~AbstractInternalCommandExecutor() = default;
 
-    virtual void execute(const Query &query, std::shared_ptr<Client> client) = 0;
+    virtual void execute(Query &query, std::shared_ptr<Client> client) = 0;
 
     static std::shared_ptr<AbstractInternalCommandExecutor> createCommandExecutor(CommandType cmd_type);
 
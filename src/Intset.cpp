@@ -0,0 +1,261 @@
+//
+// Created by Manh Nguyen Viet on 9/26/25.
+//
+
+#include "Intset.h"
+#include "Zmalloc.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// elements compared at once by the kernels, two SSE2 registers
+#define INTSET_BLOCK 4
+
+static void SetLength(unsigned char *is, size_t len) {
+    auto v = static_cast<uint32_t>(len);
+    std::memcpy(is, &v, sizeof(v));
+}
+
+static int64_t *Elements(unsigned char *is) {
+    return reinterpret_cast<int64_t *>(is + INTSET_HDR_SIZE);
+}
+
+/// a buffer for @param len elements with the header and the first @param keep elements of @param is. @param is
+/// itself while big enough and at least half used, otherwise a new one with room for 1/8 more elements, the caller
+/// then frees @param is
+static unsigned char *Reserve(unsigned char *is, size_t len, size_t keep) {
+    size_t bytes = INTSET_HDR_SIZE + len * sizeof(int64_t);
+    size_t capacity = ZmallocSize(is);
+    if (bytes <= capacity && bytes * 2 >= capacity)
+        return is;
+
+    auto buf = new unsigned char[bytes + len / 8 * sizeof(int64_t)];
+    std::memcpy(buf, is, INTSET_HDR_SIZE + keep * sizeof(int64_t));
+    return buf;
+}
+
+unsigned char *Intset::New() {
+    auto is = new unsigned char[INTSET_HDR_SIZE];
+    SetLength(is, 0);
+    return is;
+}
+
+size_t Intset::Length(const unsigned char *is) {
+    uint32_t len;
+    std::memcpy(&len, is, sizeof(len));
+    return len;
+}
+
+bool Intset::Find(const unsigned char *is, int64_t value) {
+    const int64_t *begin = Data(is), *end = begin + Length(is);
+    return std::binary_search(begin, end, value);
+}
+
+unsigned char *Intset::Add(unsigned char *is, int64_t value, bool &added) {
+    size_t len = Length(is);
+    const int64_t *data = Data(is);
+    size_t pos = std::lower_bound(data, data + len, value) - data;
+    added = pos == len || data[pos] != value;
+    if (!added)
+        return is;
+
+    /// the elements before the insertion point are all that a new buffer needs to get, the others are moved right
+    unsigned char *buf = Reserve(is, len + 1, pos);
+    int64_t *elements = Elements(buf);
+    if (buf == is) {
+        std::memmove(elements + pos + 1, elements + pos, (len - pos) * sizeof(int64_t));
+    } else {
+        std::memcpy(elements + pos + 1, data + pos, (len - pos) * sizeof(int64_t));
+        delete[] is;
+    }
+    elements[pos] = value;
+    SetLength(buf, len + 1);
+    return buf;
+}
+
+unsigned char *Intset::Remove(unsigned char *is, int64_t value, bool &removed) {
+    size_t len = Length(is);
+    int64_t *elements = Elements(is);
+    size_t pos = std::lower_bound(elements, elements + len, value) - elements;
+    removed = pos < len && elements[pos] == value;
+    if (!removed)
+        return is;
+
+    std::memmove(elements + pos, elements + pos + 1, (len - pos - 1) * sizeof(int64_t));
+    unsigned char *buf = Reserve(is, len - 1, len - 1);
+    if (buf != is)
+        delete[] is;
+    SetLength(buf, len - 1);
+    return buf;
+}
+
+#if defined(__SSE2__)
+
+/// all ones in the 64 bit lanes where @param x and @param y are equal, SSE2 only compares 32 bit lanes
+static inline __m128i CmpEq64(__m128i x, __m128i y) {
+    __m128i eq = _mm_cmpeq_epi32(x, y);
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+/// bit i set when @param a[i] is one of @param b[0..3], for i in 0..3. Every pair of registers is compared as is
+/// and with the halves of the one of @param b swapped, 8 compares for the 16 pairs of elements
+static inline unsigned MatchBlock(const int64_t *a, const int64_t *b) {
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 2));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 2));
+    __m128i b0s = _mm_shuffle_epi32(b0, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i b1s = _mm_shuffle_epi32(b1, _MM_SHUFFLE(1, 0, 3, 2));
+
+    __m128i m0 = _mm_or_si128(_mm_or_si128(CmpEq64(a0, b0), CmpEq64(a0, b0s)),
+                              _mm_or_si128(CmpEq64(a0, b1), CmpEq64(a0, b1s)));
+    __m128i m1 = _mm_or_si128(_mm_or_si128(CmpEq64(a1, b0), CmpEq64(a1, b0s)),
+                              _mm_or_si128(CmpEq64(a1, b1), CmpEq64(a1, b1s)));
+    return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m0))) |
+           (static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m1))) << 2);
+}
+
+#else
+
+static inline unsigned MatchBlock(const int64_t *a, const int64_t *b) {
+    unsigned mask = 0;
+    for (int i = 0; i < INTSET_BLOCK; ++i) {
+        for (int j = 0; j < INTSET_BLOCK; ++j) {
+            mask |= static_cast<unsigned>(a[i] == b[j]) << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+/// the elements of the block @param block whose bit is set in @param mask to @param out, in order. A nullptr
+/// @param out only counts them
+static inline size_t EmitBlock(const int64_t *block, unsigned mask, int64_t *out) {
+    if (!out)
+        return __builtin_popcount(mask);
+
+    size_t n = 0;
+    for (; mask; mask &= mask - 1) {
+        out[n++] = block[__builtin_ctz(mask)];
+    }
+    return n;
+}
+
+/// the first index from @param from on where @param b holds at least @param value, @param nb when none does.
+/// Exponential steps first, then a binary search within the last one
+static inline size_t GallopTo(const int64_t *b, size_t nb, size_t from, int64_t value) {
+    size_t lo = from, hi = from, step = 1;
+    while (hi < nb && b[hi] < value) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    return std::lower_bound(b + lo, b + std::min(hi + 1, nb), value) - b;
+}
+
+size_t Intset::Intersect(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out) {
+    if (na > nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na == 0)
+        return 0;
+
+    size_t i = 0, j = 0, k = 0;
+    if (nb / na >= INTSET_GALLOP_RATIO) {
+        for (; i < na; ++i) {
+            j = GallopTo(b, nb, j, a[i]);
+            if (j == nb)
+                break;
+            if (b[j] == a[i]) {
+                if (out)
+                    out[k] = a[i];
+                ++k;
+            }
+        }
+        return k;
+    }
+
+    /// the block with the smaller last element is done: every element of the other block up to it was compared
+    /// against it. An element of a can only match once, the matches come out in order
+    while (i + INTSET_BLOCK <= na && j + INTSET_BLOCK <= nb) {
+        k += EmitBlock(a + i, MatchBlock(a + i, b + j), out ? out + k : nullptr);
+        int64_t a_last = a[i + INTSET_BLOCK - 1], b_last = b[j + INTSET_BLOCK - 1];
+        if (a_last <= b_last)
+            i += INTSET_BLOCK;
+        if (b_last <= a_last)
+            j += INTSET_BLOCK;
+    }
+
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            if (out)
+                out[k] = a[i];
+            ++k;
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+size_t Intset::Difference(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    if (na > 0 && nb / na >= INTSET_GALLOP_RATIO) {
+        for (; i < na; ++i) {
+            j = GallopTo(b, nb, j, a[i]);
+            if (j == nb || b[j] != a[i])
+                out[k++] = a[i];
+        }
+        return k;
+    }
+
+    /// the matches of the current block of a, kept until it is done
+    unsigned matched = 0;
+    while (i + INTSET_BLOCK <= na && j + INTSET_BLOCK <= nb) {
+        matched |= MatchBlock(a + i, b + j);
+        int64_t a_last = a[i + INTSET_BLOCK - 1], b_last = b[j + INTSET_BLOCK - 1];
+        if (a_last <= b_last) {
+            k += EmitBlock(a + i, ~matched & ((1u << INTSET_BLOCK) - 1), out + k);
+            matched = 0;
+            i += INTSET_BLOCK;
+        }
+        if (b_last <= a_last)
+            j += INTSET_BLOCK;
+    }
+
+    /// the first elements may belong to a block already matched in part
+    for (; i < na; ++i, matched >>= 1) {
+        while (j < nb && b[j] < a[i])
+            ++j;
+        if (!(matched & 1) && (j == nb || b[j] != a[i]))
+            out[k++] = a[i];
+    }
+    return k;
+}
+
+size_t Intset::Union(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            out[k++] = a[i++];
+        } else if (b[j] < a[i]) {
+            out[k++] = b[j++];
+        } else {
+            out[k++] = a[i++];
+            ++j;
+        }
+    }
+
+    int64_t *end = std::copy(a + i, a + na, out + k);
+    return std::copy(b + j, b + nb, end) - out;
+}
@@ -0,0 +1,66 @@
+//
+// Created by Manh Nguyen Viet on 9/26/25.
+//
+
+#ifndef REDIS_CRAFT_INTSET_H
+#define REDIS_CRAFT_INTSET_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// number of elements (uint32_t), padded so the elements stay 8 byte aligned
+#define INTSET_HDR_SIZE 8
+/// the smaller input of Intersect() is searched in the larger one, rather than walked along it, from this size ratio
+#define INTSET_GALLOP_RATIO 32
+
+/*
+ * A set of integers, sorted in one contiguous buffer:
+ *
+ *   <count> <padding> <int64_t> ... <int64_t>
+ *
+ * Unlike the intsets of Redis the elements always take 8 bytes, so the buffer of a set is directly the sorted array
+ * the SSE2 kernels below work on, whatever the range of its members. It still takes 8 bytes per member against
+ * about 60 for a member of a hashtable.
+ *
+ * The buffer is allocated with new[]. The functions changing an intset take it and return it, as it may have moved.
+ * */
+class Intset {
+public:
+    /// an empty intset
+    static unsigned char *New();
+
+    static void Free(unsigned char *is) { delete[] is; }
+
+    /// bytes of @param is, its header included
+    static size_t Bytes(const unsigned char *is) { return INTSET_HDR_SIZE + Length(is) * sizeof(int64_t); }
+
+    /// number of elements
+    static size_t Length(const unsigned char *is);
+
+    /// the elements, in increasing order
+    static const int64_t *Data(const unsigned char *is) {
+        return reinterpret_cast<const int64_t *>(is + INTSET_HDR_SIZE);
+    }
+
+    static bool Find(const unsigned char *is, int64_t value);
+
+    /// insert @param value, @param added telling whether it was missing
+    static unsigned char *Add(unsigned char *is, int64_t value, bool &added);
+
+    /// remove @param value, @param removed telling whether it was there
+    static unsigned char *Remove(unsigned char *is, int64_t value, bool &removed);
+
+    /// the elements of both sorted arrays @param a and @param b in increasing order to @param out, which must not
+    /// overlap them and only needs room for the smaller one. A nullptr @param out only counts them. Return their number
+    static size_t Intersect(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+
+    /// the elements of @param a missing from @param b to @param out, room for @param na elements not overlapping
+    /// the inputs. Return their number
+    static size_t Difference(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+
+    /// the elements of @param a or @param b to @param out, room for @param na + @param nb elements not overlapping
+    /// the inputs. Return their number
+    static size_t Union(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+};
+
+#endif //REDIS_CRAFT_INTSET_H
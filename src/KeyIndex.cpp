@@ -0,0 +1,603 @@
+//
+// Created by Manh Nguyen Viet on 9/16/25.
+//
+
+#include "KeyIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum KeyIndexNodeType : uint8_t {
+    NodeLeaf = 0,   /// no children
+    Node4 = 1,
+    Node16 = 2,
+    Node48 = 3,
+    Node256 = 4,
+};
+
+struct KeyIndexNode {
+    explicit KeyIndexNode(uint8_t t) : type(t) {}
+
+    uint8_t type;
+    bool terminal = false;          /// a key ends at this node
+    uint16_t num_children = 0;
+    uint64_t count = 0;             /// keys in the subtree, this node included
+    std::string prefix;             /// bytes shared by the whole subtree, after the edge from the parent
+};
+
+typedef struct IndexNode4 : KeyIndexNode {
+    IndexNode4() : KeyIndexNode(Node4) {}
+
+    uint8_t keys[4]{};              /// sorted
+    KeyIndexNode *children[4]{};
+} IndexNode4;
+
+typedef struct IndexNode16 : KeyIndexNode {
+    IndexNode16() : KeyIndexNode(Node16) {}
+
+    uint8_t keys[16]{};             /// sorted
+    KeyIndexNode *children[16]{};
+} IndexNode16;
+
+typedef struct IndexNode48 : KeyIndexNode {
+    IndexNode48() : KeyIndexNode(Node48) {}
+
+    uint8_t index[256]{};           /// 1 + the slot of the child of each byte, 0 if none
+    KeyIndexNode *children[48]{};
+} IndexNode48;
+
+typedef struct IndexNode256 : KeyIndexNode {
+    IndexNode256() : KeyIndexNode(Node256) {}
+
+    KeyIndexNode *children[256]{};
+} IndexNode256;
+
+using Node = KeyIndexNode;
+
+/// shrink a layout when its children fit in the smaller one with room to spare, so a node at the boundary does not
+/// flip between two layouts on every insert and erase
+#define NODE16_SHRINK 3
+#define NODE48_SHRINK 12
+#define NODE256_SHRINK 37
+
+/// bytes of the nodes of all the indexes
+static std::atomic<size_t> node_bytes{0};
+
+template<typename T, typename... Args>
+static T *AllocNode(Args &&... args) {
+    node_bytes.fetch_add(sizeof(T), std::memory_order_relaxed);
+    return new T(std::forward<Args>(args)...);
+}
+
+static Node *NewLeaf(std::string_view suffix) {
+    auto leaf = AllocNode<Node>(NodeLeaf);
+    leaf->terminal = true;
+    leaf->count = 1;
+    leaf->prefix.assign(suffix);
+    return leaf;
+}
+
+/// free @param node only, not its children
+static void FreeNode(Node *node) {
+    switch (node->type) {
+        case Node4:
+            node_bytes.fetch_sub(sizeof(IndexNode4), std::memory_order_relaxed);
+            delete static_cast<IndexNode4 *>(node);
+            break;
+        case Node16:
+            node_bytes.fetch_sub(sizeof(IndexNode16), std::memory_order_relaxed);
+            delete static_cast<IndexNode16 *>(node);
+            break;
+        case Node48:
+            node_bytes.fetch_sub(sizeof(IndexNode48), std::memory_order_relaxed);
+            delete static_cast<IndexNode48 *>(node);
+            break;
+        case Node256:
+            node_bytes.fetch_sub(sizeof(IndexNode256), std::memory_order_relaxed);
+            delete static_cast<IndexNode256 *>(node);
+            break;
+        default:
+            node_bytes.fetch_sub(sizeof(Node), std::memory_order_relaxed);
+            delete node;
+            break;
+    }
+}
+
+static void MoveHeader(Node *dst, Node *src) {
+    dst->terminal = src->terminal;
+    dst->num_children = src->num_children;
+    dst->count = src->count;
+    dst->prefix = std::move(src->prefix);
+}
+
+static Node **FindChild(Node *node, uint8_t c) {
+    switch (node->type) {
+        case Node4: {
+            auto n = static_cast<IndexNode4 *>(node);
+            for (int i = 0; i < n->num_children; ++i) {
+                if (n->keys[i] == c)
+                    return &n->children[i];
+            }
+            return nullptr;
+        }
+        case Node16: {
+            auto n = static_cast<IndexNode16 *>(node);
+#if defined(__SSE2__)
+            __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(c)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u << n->num_children) - 1);
+            return mask ? &n->children[__builtin_ctz(mask)] : nullptr;
+#else
+            for (int i = 0; i < n->num_children; ++i) {
+                if (n->keys[i] == c)
+                    return &n->children[i];
+            }
+            return nullptr;
+#endif
+        }
+        case Node48: {
+            auto n = static_cast<IndexNode48 *>(node);
+            return n->index[c] ? &n->children[n->index[c] - 1] : nullptr;
+        }
+        case Node256: {
+            auto n = static_cast<IndexNode256 *>(node);
+            return n->children[c] ? &n->children[c] : nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+/// call @param fn(byte, child) for every child of @param node in byte order
+template<typename Fn>
+static void ForEachChild(const Node *node, Fn &&fn) {
+    switch (node->type) {
+        case Node4: {
+            auto n = static_cast<const IndexNode4 *>(node);
+            for (int i = 0; i < n->num_children; ++i)
+                fn(n->keys[i], n->children[i]);
+            break;
+        }
+        case Node16: {
+            auto n = static_cast<const IndexNode16 *>(node);
+            for (int i = 0; i < n->num_children; ++i)
+                fn(n->keys[i], n->children[i]);
+            break;
+        }
+        case Node48: {
+            auto n = static_cast<const IndexNode48 *>(node);
+            for (int c = 0; c < 256; ++c) {
+                if (n->index[c])
+                    fn(static_cast<uint8_t>(c), n->children[n->index[c] - 1]);
+            }
+            break;
+        }
+        case Node256: {
+            auto n = static_cast<const IndexNode256 *>(node);
+            for (int c = 0; c < 256; ++c) {
+                if (n->children[c])
+                    fn(static_cast<uint8_t>(c), n->children[c]);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/// insert @param child in the sorted @param keys / @param children of @param n entries
+static void InsertSorted(uint8_t *keys, Node **children, int n, uint8_t c, Node *child) {
+    int pos = 0;
+    while (pos < n && keys[pos] < c)
+        ++pos;
+    std::memmove(keys + pos + 1, keys + pos, n - pos);
+    std::memmove(children + pos + 1, children + pos, (n - pos) * sizeof(Node *));
+    keys[pos] = c;
+    children[pos] = child;
+}
+
+static void RemoveSorted(uint8_t *keys, Node **children, int n, uint8_t c) {
+    int pos = 0;
+    while (pos < n && keys[pos] != c)
+        ++pos;
+    if (pos == n)
+        return;
+    std::memmove(keys + pos, keys + pos + 1, n - pos - 1);
+    std::memmove(children + pos, children + pos + 1, (n - pos - 1) * sizeof(Node *));
+}
+
+/// add @param child under the byte @param c, @param ref is replaced when the node has to grow
+static void AddChild(Node *&ref, uint8_t c, Node *child) {
+    Node *node = ref;
+    switch (node->type) {
+        case NodeLeaf: {
+            auto grown = AllocNode<IndexNode4>();
+            MoveHeader(grown, node);
+            FreeNode(node);
+            ref = grown;
+            AddChild(ref, c, child);
+            return;
+        }
+        case Node4: {
+            auto n = static_cast<IndexNode4 *>(node);
+            if (n->num_children < 4) {
+                InsertSorted(n->keys, n->children, n->num_children++, c, child);
+                return;
+            }
+
+            auto grown = AllocNode<IndexNode16>();
+            MoveHeader(grown, n);
+            std::memcpy(grown->keys, n->keys, sizeof(n->keys));
+            std::memcpy(grown->children, n->children, sizeof(n->children));
+            FreeNode(n);
+            ref = grown;
+            InsertSorted(grown->keys, grown->children, grown->num_children++, c, child);
+            return;
+        }
+        case Node16: {
+            auto n = static_cast<IndexNode16 *>(node);
+            if (n->num_children < 16) {
+                InsertSorted(n->keys, n->children, n->num_children++, c, child);
+                return;
+            }
+
+            auto grown = AllocNode<IndexNode48>();
+            MoveHeader(grown, n);
+            for (int i = 0; i < 16; ++i) {
+                grown->children[i] = n->children[i];
+                grown->index[n->keys[i]] = i + 1;
+            }
+            FreeNode(n);
+            ref = grown;
+            grown->children[16] = child;
+            grown->index[c] = 17;
+            ++grown->num_children;
+            return;
+        }
+        case Node48: {
+            auto n = static_cast<IndexNode48 *>(node);
+            if (n->num_children < 48) {
+                /// erased children leave holes
+                int slot = 0;
+                while (n->children[slot])
+                    ++slot;
+                n->children[slot] = child;
+                n->index[c] = slot + 1;
+                ++n->num_children;
+                return;
+            }
+
+            auto grown = AllocNode<IndexNode256>();
+            MoveHeader(grown, n);
+            for (int b = 0; b < 256; ++b) {
+                if (n->index[b])
+                    grown->children[b] = n->children[n->index[b] - 1];
+            }
+            FreeNode(n);
+            ref = grown;
+            grown->children[c] = child;
+            ++grown->num_children;
+            return;
+        }
+        default: {
+            auto n = static_cast<IndexNode256 *>(node);
+            n->children[c] = child;
+            ++n->num_children;
+            return;
+        }
+    }
+}
+
+/// remove the child under the byte @param c, @param ref is replaced when the node shrinks
+static void RemoveChild(Node *&ref, uint8_t c) {
+    Node *node = ref;
+    switch (node->type) {
+        case Node4: {
+            auto n = static_cast<IndexNode4 *>(node);
+            RemoveSorted(n->keys, n->children, n->num_children--, c);
+            if (n->num_children == 0) {
+                auto shrunk = AllocNode<Node>(NodeLeaf);
+                MoveHeader(shrunk, n);
+                FreeNode(n);
+                ref = shrunk;
+            }
+            return;
+        }
+        case Node16: {
+            auto n = static_cast<IndexNode16 *>(node);
+            RemoveSorted(n->keys, n->children, n->num_children--, c);
+            if (n->num_children <= NODE16_SHRINK) {
+                auto shrunk = AllocNode<IndexNode4>();
+                MoveHeader(shrunk, n);
+                std::memcpy(shrunk->keys, n->keys, n->num_children);
+                std::memcpy(shrunk->children, n->children, n->num_children * sizeof(Node *));
+                FreeNode(n);
+                ref = shrunk;
+            }
+            return;
+        }
+        case Node48: {
+            auto n = static_cast<IndexNode48 *>(node);
+            n->children[n->index[c] - 1] = nullptr;
+            n->index[c] = 0;
+            --n->num_children;
+            if (n->num_children <= NODE48_SHRINK) {
+                auto shrunk = AllocNode<IndexNode16>();
+                MoveHeader(shrunk, n);
+                int i = 0;
+                for (int b = 0; b < 256; ++b) {
+                    if (n->index[b]) {
+                        shrunk->keys[i] = static_cast<uint8_t>(b);
+                        shrunk->children[i++] = n->children[n->index[b] - 1];
+                    }
+                }
+                FreeNode(n);
+                ref = shrunk;
+            }
+            return;
+        }
+        case Node256: {
+            auto n = static_cast<IndexNode256 *>(node);
+            n->children[c] = nullptr;
+            --n->num_children;
+            if (n->num_children <= NODE256_SHRINK) {
+                auto shrunk = AllocNode<IndexNode48>();
+                MoveHeader(shrunk, n);
+                int slot = 0;
+                for (int b = 0; b < 256; ++b) {
+                    if (n->children[b]) {
+                        shrunk->children[slot] = n->children[b];
+                        shrunk->index[b] = ++slot;
+                    }
+                }
+                FreeNode(n);
+                ref = shrunk;
+            }
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+/// after an erase below @param ref: drop the node if its subtree is empty, or merge it with its only child
+/// if no key ends at it, so every inner node keeps branching
+static void Compact(Node *&ref) {
+    Node *node = ref;
+    if (node->terminal || node->num_children > 1)
+        return;
+
+    if (node->num_children == 0) {
+        FreeNode(node);
+        ref = nullptr;
+        return;
+    }
+
+    uint8_t byte = 0;
+    Node *child = nullptr;
+    ForEachChild(node, [&](uint8_t c, Node *n) {
+        byte = c;
+        child = n;
+    });
+    node->prefix.push_back(static_cast<char>(byte));
+    child->prefix.insert(0, node->prefix);
+    FreeNode(node);
+    ref = child;
+}
+
+bool KeyIndex::Insert(std::string_view key) {
+    std::vector<Node *> ancestors;
+    Node **ref = &root_;
+    size_t depth = 0;
+    while (true) {
+        Node *node = *ref;
+        if (!node) {
+            *ref = NewLeaf(key.substr(depth));
+            break;
+        }
+
+        std::string_view rest = key.substr(depth);
+        size_t common = std::mismatch(node->prefix.begin(), node->prefix.end(), rest.begin(), rest.end()).first -
+                        node->prefix.begin();
+        if (common < node->prefix.size()) {
+            /// the key leaves the compressed path: split it with a new parent at the divergence
+            auto parent = AllocNode<IndexNode4>();
+            parent->prefix = node->prefix.substr(0, common);
+            parent->count = node->count + 1;
+            auto byte = static_cast<uint8_t>(node->prefix[common]);
+            node->prefix.erase(0, common + 1);
+
+            Node *split = parent;
+            AddChild(split, byte, node);
+            if (common == rest.size()) {
+                split->terminal = true;
+            } else {
+                AddChild(split, static_cast<uint8_t>(rest[common]), NewLeaf(rest.substr(common + 1)));
+            }
+            *ref = split;
+            break;
+        }
+
+        depth += common;
+        if (depth == key.size()) {
+            if (node->terminal)
+                return false;
+            node->terminal = true;
+            ++node->count;
+            break;
+        }
+
+        auto byte = static_cast<uint8_t>(key[depth]);
+        Node **child = FindChild(node, byte);
+        if (!child) {
+            AddChild(*ref, byte, NewLeaf(key.substr(depth + 1)));
+            ++(*ref)->count;
+            break;
+        }
+
+        ancestors.push_back(node);
+        ref = child;
+        ++depth;
+    }
+
+    for (auto node: ancestors) {
+        ++node->count;
+    }
+    return true;
+}
+
+bool KeyIndex::Erase(std::string_view key) {
+    /// refs[i] points to the node at level i, bytes[i] is the edge from it to the next level
+    std::vector<Node **> refs;
+    std::vector<uint8_t> bytes;
+    Node **ref = &root_;
+    size_t depth = 0;
+    while (true) {
+        Node *node = *ref;
+        if (!node)
+            return false;
+
+        const std::string &prefix = node->prefix;
+        if (key.size() - depth < prefix.size() || key.compare(depth, prefix.size(), prefix) != 0)
+            return false;
+
+        refs.push_back(ref);
+        depth += prefix.size();
+        if (depth == key.size()) {
+            if (!node->terminal)
+                return false;
+            node->terminal = false;
+            break;
+        }
+
+        auto byte = static_cast<uint8_t>(key[depth]);
+        Node **child = FindChild(node, byte);
+        if (!child)
+            return false;
+
+        bytes.push_back(byte);
+        ref = child;
+        ++depth;
+    }
+
+    /// bottom-up, so a node is compacted before its parent looks at it
+    for (size_t i = refs.size(); i-- > 0;) {
+        Node *&node = *refs[i];
+        if (i + 1 < refs.size() && *refs[i + 1] == nullptr) {
+            RemoveChild(node, bytes[i]);
+        }
+        --node->count;
+        Compact(node);
+    }
+    return true;
+}
+
+bool KeyIndex::Contains(std::string_view key) const {
+    std::string path;
+    const Node *node = Descend(key, path);
+    return node && path.size() + node->prefix.size() == key.size() && node->terminal;
+}
+
+void KeyIndex::Clear() {
+    std::vector<Node *> stack;
+    if (root_)
+        stack.push_back(root_);
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+        ForEachChild(node, [&stack](uint8_t, Node *child) { stack.push_back(child); });
+        FreeNode(node);
+    }
+    root_ = nullptr;
+}
+
+size_t KeyIndex::NodeMemory() {
+    return node_bytes.load(std::memory_order_relaxed);
+}
+
+size_t KeyIndex::Size() const {
+    return root_ ? root_->count : 0;
+}
+
+size_t KeyIndex::CountPrefix(std::string_view prefix) const {
+    std::string path;
+    const Node *node = Descend(prefix, path);
+    return node ? node->count : 0;
+}
+
+void KeyIndex::ForEachPrefix(std::string_view prefix, std::string_view after,
+                             const std::function<bool(const std::string &)> &fn) const {
+    std::string key;
+    const Node *start = Descend(prefix, key);
+    if (!start)
+        return;
+
+    /// depth first, a node before its children and the children in byte order. The recursion is kept on the heap
+    /// since a chain of keys each prefix of the next is as deep as it is long
+    struct Frame {
+        const Node *node;
+        size_t len;     /// length of the key up to the parent of the node
+        int byte;       /// edge from the parent, -1 for the start node
+    };
+    std::vector<Frame> stack{{start, key.size(), -1}};
+    std::vector<std::pair<uint8_t, const Node *>> children;
+    while (!stack.empty()) {
+        Frame frame = stack.back();
+        stack.pop_back();
+
+        key.resize(frame.len);
+        if (frame.byte >= 0)
+            key.push_back(static_cast<char>(frame.byte));
+        key.append(frame.node->prefix);
+
+        /// every key of the subtree starts with key: all of them sort before after unless key is a prefix of it
+        bool resuming = false;
+        if (!after.empty() && key <= after) {
+            if (!after.starts_with(key))
+                continue;
+            resuming = true;
+        }
+        if (frame.node->terminal && !resuming && !fn(key))
+            return;
+
+        children.clear();
+        ForEachChild(frame.node, [&children](uint8_t c, const Node *child) { children.emplace_back(c, child); });
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            stack.push_back({it->second, key.size(), it->first});
+        }
+    }
+}
+
+const KeyIndex::Node *KeyIndex::Descend(std::string_view prefix, std::string &path) const {
+    path.clear();
+    Node *node = root_;
+    size_t depth = 0;
+    while (node) {
+        std::string_view rest = prefix.substr(depth);
+        size_t n = std::min(rest.size(), node->prefix.size());
+        if (std::memcmp(node->prefix.data(), rest.data(), n) != 0)
+            return nullptr;
+
+        /// the prefix ends inside the compressed path of this node
+        if (rest.size() <= node->prefix.size())
+            return node;
+
+        path.append(node->prefix);
+        depth += node->prefix.size();
+        auto byte = static_cast<uint8_t>(prefix[depth]);
+        Node **child = FindChild(node, byte);
+        if (!child)
+            return nullptr;
+
+        path.push_back(static_cast<char>(byte));
+        ++depth;
+        node = *child;
+    }
+    return nullptr;
+}
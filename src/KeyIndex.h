@@ -0,0 +1,75 @@
+//
+// Created by Manh Nguyen Viet on 9/16/25.
+//
+
+#ifndef REDIS_CRAFT_KEYINDEX_H
+#define REDIS_CRAFT_KEYINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// a node of the tree, defined in KeyIndex.cpp
+struct KeyIndexNode;
+
+/*
+ * Ordered index of the key names, an adaptive radix tree (ART).
+ *
+ * Every node stands for the bytes on its path from the root. It keeps the run of bytes all its keys share below its
+ * parent edge (path compression, so "tenant:42:order:" is stored once, not once per key), whether a key ends right
+ * there, and its children in one of four layouts chosen by their number: 4 or 16 sorted bytes, a 256 byte index into
+ * 48 children, or 256 direct children. A node only grows to the next layout when it is full and shrinks back when it
+ * gets sparse, so small fan-outs stay small.
+ *
+ * Every node also counts the keys of its subtree, so CountPrefix() costs the length of the prefix and ForEachPrefix()
+ * the number of matching keys, whatever the size of the keyspace.
+ * */
+class KeyIndex {
+public:
+    KeyIndex() = default;
+
+    ~KeyIndex() { Clear(); }
+
+    KeyIndex(const KeyIndex &) = delete;
+
+    KeyIndex &operator=(const KeyIndex &) = delete;
+
+    /// return false if @param key was already there
+    bool Insert(std::string_view key);
+
+    /// return false if @param key was not there
+    bool Erase(std::string_view key);
+
+    bool Contains(std::string_view key) const;
+
+    void Clear();
+
+    size_t Size() const;
+
+    /// number of keys starting with @param prefix
+    size_t CountPrefix(std::string_view prefix) const;
+
+    /// call @param fn with the keys starting with @param prefix that sort after @param after, all of them when it is
+    /// empty, in lexicographic order until @param fn returns false. The subtrees before @param after are skipped
+    /// whole, so resuming costs the depth of @param after and not the number of keys before it
+    void ForEachPrefix(std::string_view prefix, std::string_view after,
+                       const std::function<bool(const std::string &)> &fn) const;
+
+    void Swap(KeyIndex &other) noexcept { std::swap(root_, other.root_); }
+
+    /// bytes of the nodes of all the indexes, without the prefixes too long to be kept inline
+    static size_t NodeMemory();
+
+private:
+    using Node = KeyIndexNode;
+
+    /// the node covering every key starting with @param prefix, nullptr if none. @param path is set to the bytes
+    /// before the compressed prefix of that node
+    const Node *Descend(std::string_view prefix, std::string &path) const;
+
+    Node *root_ = nullptr;
+};
+
+#endif //REDIS_CRAFT_KEYINDEX_H
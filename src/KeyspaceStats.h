@@ -0,0 +1,77 @@
+//
+// Created by Manh Nguyen Viet on 9/22/25.
+//
+
+#ifndef REDIS_CRAFT_KEYSPACESTATS_H
+#define REDIS_CRAFT_KEYSPACESTATS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/// prefixes tracked by one table, the others are counted together under KEYSPACE_STATS_OTHER
+#define KEYSPACE_STATS_MAX_PREFIXES 1024
+#define KEYSPACE_STATS_OTHER "(other)"
+
+typedef struct PrefixUsage {
+    int64_t keys = 0;
+    int64_t bytes = 0;      /// key names, values and their objects. The values moved to the value log are not counted
+    uint64_t reads = 0;     /// key accesses by commands that do not write
+    uint64_t writes = 0;
+
+    PrefixUsage &operator+=(const PrefixUsage &other) {
+        keys += other.keys;
+        bytes += other.bytes;
+        reads += other.reads;
+        writes += other.writes;
+        return *this;
+    }
+} PrefixUsage;
+
+/*
+ * Usage counters per key prefix, the part of a key before the first keyspace-stats-delimiter. A key without the
+ * delimiter counts under the empty prefix.
+ *
+ * The counters are updated as the keys change, so reading them never walks the keyspace. Every stripe keeps its own
+ * table under its lock, which a flush clears and SWAPDB exchanges along with the keys. Not thread safe.
+ * */
+class PrefixStats {
+public:
+    /// lookups by std::string_view, without building a std::string
+    struct Hash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    using Map = std::unordered_map<std::string, PrefixUsage, Hash, std::equal_to<>>;
+
+    /// the counters of @param prefix, created on first use
+    PrefixUsage &Of(std::string_view prefix) {
+        auto it = prefixes_.find(prefix);
+        if (it != prefixes_.end())
+            return it->second;
+
+        if (prefixes_.size() >= KEYSPACE_STATS_MAX_PREFIXES)
+            return prefixes_[KEYSPACE_STATS_OTHER];
+        return prefixes_.emplace(std::string(prefix), PrefixUsage()).first->second;
+    }
+
+    void Clear() { prefixes_.clear(); }
+
+    void Swap(PrefixStats &other) noexcept { prefixes_.swap(other.prefixes_); }
+
+    /// add the counters of every prefix to @param total
+    void MergeInto(Map &total) const {
+        for (auto &[prefix, usage]: prefixes_) {
+            total[prefix] += usage;
+        }
+    }
+
+private:
+    Map prefixes_;
+};
+
+#endif //REDIS_CRAFT_KEYSPACESTATS_H
@@ -0,0 +1,54 @@
+//
+// Created by Manh Nguyen Viet on 9/13/25.
+//
+
+#include "LazyFree.h"
+#include "Epoch.h"
+
+LazyFree *LazyFree::GetInstance() {
+    /// never destroyed, the worker keeps running until the process exits
+    static LazyFree *instance = new LazyFree();
+    return instance;
+}
+
+LazyFree::LazyFree() {
+    worker_ = std::thread(&LazyFree::Run, this);
+    worker_.detach();
+}
+
+void LazyFree::FreeObject(RedisObject &&obj, bool lazy) {
+    if (!lazy || obj.FreeEffort() <= LAZYFREE_THRESHOLD) {
+        RedisObject released(std::move(obj));
+        return;
+    }
+
+    auto detached = new RedisObject(std::move(obj));
+    Submit([detached]() { delete detached; });
+}
+
+void LazyFree::Submit(std::function<void()> job) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lock(m_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void LazyFree::Run() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_);
+            cv_.wait(lock, [this]() { return !jobs_.empty(); });
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job();
+        /// what the job retired while readers were pinned would otherwise wait for the next job
+        Epoch::Reclaim();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        freed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,59 @@
+//
+// Created by Manh Nguyen Viet on 9/13/25.
+//
+
+#ifndef REDIS_CRAFT_LAZYFREE_H
+#define REDIS_CRAFT_LAZYFREE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "RedisObject.h"
+
+/// values whose free effort is above this are released in the background, the rest is cheaper to free inline
+#define LAZYFREE_THRESHOLD 64
+
+/*
+ * Background thread releasing the memory of values detached from the keyspace.
+ *
+ * The event loop only unlinks a big value (or swaps a whole table out) in O(1) and hands it over here, the destructors
+ * walking millions of nodes then run off the event loop.
+ * */
+class LazyFree {
+public:
+    LazyFree(const LazyFree &) = delete;
+
+    LazyFree &operator=(const LazyFree &) = delete;
+
+    static LazyFree *GetInstance();
+
+    /// release @param obj, in the background when @param lazy and its free effort is above LAZYFREE_THRESHOLD
+    void FreeObject(RedisObject &&obj, bool lazy);
+
+    /// run @param job on the background thread
+    void Submit(std::function<void()> job);
+
+    /// number of jobs not released yet
+    size_t Pending() const { return pending_.load(std::memory_order_relaxed); }
+
+    /// number of jobs released since the start
+    size_t Freed() const { return freed_.load(std::memory_order_relaxed); }
+
+private:
+    LazyFree();
+
+    void Run();
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> freed_{0};
+    std::thread worker_;
+};
+
+#endif //REDIS_CRAFT_LAZYFREE_H
@@ -0,0 +1,402 @@
+//
+// Created by Manh Nguyen Viet on 9/23/25.
+//
+
+#include "Listpack.h"
+#include "Utils.h"
+#include "Zmalloc.h"
+
+#include <charconv>
+#include <cstring>
+
+/// first byte of an element, the masked bits telling the encoding
+#define LP_ENC_7BIT_UINT 0x00       /// 0xxxxxxx
+#define LP_ENC_6BIT_STR 0x80        /// 10xxxxxx, the length then the bytes
+#define LP_ENC_13BIT_INT 0xC0       /// 110xxxxx yyyyyyyy
+#define LP_ENC_12BIT_STR 0xE0       /// 1110xxxx yyyyyyyy, the length then the bytes
+#define LP_ENC_32BIT_STR 0xF0       /// a 32 bit length then the bytes
+#define LP_ENC_16BIT_INT 0xF1
+#define LP_ENC_24BIT_INT 0xF2
+#define LP_ENC_32BIT_INT 0xF3
+#define LP_ENC_64BIT_INT 0xF4
+
+/// the encoding bytes of an element and the string bytes following them, the backward length excluded
+typedef struct Encoded {
+    unsigned char hdr[9];
+    size_t hdr_len = 0;
+    std::string_view data;
+
+    size_t Size() const { return hdr_len + data.size(); }
+} Encoded;
+
+static size_t TotalBytes(const unsigned char *lp) {
+    uint32_t bytes;
+    std::memcpy(&bytes, lp, sizeof(bytes));
+    return bytes;
+}
+
+static void SetTotalBytes(unsigned char *lp, size_t bytes) {
+    auto v = static_cast<uint32_t>(bytes);
+    std::memcpy(lp, &v, sizeof(v));
+}
+
+static uint16_t Count(const unsigned char *lp) {
+    uint16_t count;
+    std::memcpy(&count, lp + 4, sizeof(count));
+    return count;
+}
+
+static void SetCount(unsigned char *lp, size_t count) {
+    auto v = static_cast<uint16_t>(count < LP_COUNT_UNKNOWN ? count : LP_COUNT_UNKNOWN);
+    std::memcpy(lp + 4, &v, sizeof(v));
+}
+
+/// little endian, whatever the host
+static uint64_t ReadLe(const unsigned char *p, int n) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+static void WriteLe(unsigned char *p, uint64_t v, int n) {
+    for (int i = 0; i < n; ++i)
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+static Encoded Encode(std::string_view s) {
+    Encoded enc;
+    int64_t v;
+    if (StringToInt64(s, v)) {
+        auto u = static_cast<uint64_t>(v);
+        if (v >= 0 && v <= 127) {
+            enc.hdr[0] = static_cast<unsigned char>(v);
+            enc.hdr_len = 1;
+        } else if (v >= -4096 && v <= 4095) {
+            u &= (1 << 13) - 1;
+            enc.hdr[0] = static_cast<unsigned char>(LP_ENC_13BIT_INT | (u >> 8));
+            enc.hdr[1] = static_cast<unsigned char>(u);
+            enc.hdr_len = 2;
+        } else if (v >= INT16_MIN && v <= INT16_MAX) {
+            enc.hdr[0] = LP_ENC_16BIT_INT;
+            WriteLe(enc.hdr + 1, u, 2);
+            enc.hdr_len = 3;
+        } else if (v >= -(1 << 23) && v < (1 << 23)) {
+            enc.hdr[0] = LP_ENC_24BIT_INT;
+            WriteLe(enc.hdr + 1, u, 3);
+            enc.hdr_len = 4;
+        } else if (v >= INT32_MIN && v <= INT32_MAX) {
+            enc.hdr[0] = LP_ENC_32BIT_INT;
+            WriteLe(enc.hdr + 1, u, 4);
+            enc.hdr_len = 5;
+        } else {
+            enc.hdr[0] = LP_ENC_64BIT_INT;
+            WriteLe(enc.hdr + 1, u, 8);
+            enc.hdr_len = 9;
+        }
+        return enc;
+    }
+
+    size_t len = s.size();
+    if (len < 64) {
+        enc.hdr[0] = static_cast<unsigned char>(LP_ENC_6BIT_STR | len);
+        enc.hdr_len = 1;
+    } else if (len < 4096) {
+        enc.hdr[0] = static_cast<unsigned char>(LP_ENC_12BIT_STR | (len >> 8));
+        enc.hdr[1] = static_cast<unsigned char>(len);
+        enc.hdr_len = 2;
+    } else {
+        enc.hdr[0] = LP_ENC_32BIT_STR;
+        WriteLe(enc.hdr + 1, len, 4);
+        enc.hdr_len = 5;
+    }
+    enc.data = s;
+    return enc;
+}
+
+/// bytes of the element at @param p, its backward length excluded
+static size_t EncodedSize(const unsigned char *p) {
+    unsigned char b = p[0];
+    if ((b & 0x80) == LP_ENC_7BIT_UINT)
+        return 1;
+    if ((b & 0xC0) == LP_ENC_6BIT_STR)
+        return 1 + (b & 0x3F);
+    if ((b & 0xE0) == LP_ENC_13BIT_INT)
+        return 2;
+    if ((b & 0xF0) == LP_ENC_12BIT_STR)
+        return 2 + (((b & 0x0F) << 8) | p[1]);
+
+    switch (b) {
+        case LP_ENC_32BIT_STR:
+            return 5 + ReadLe(p + 1, 4);
+        case LP_ENC_16BIT_INT:
+            return 3;
+        case LP_ENC_24BIT_INT:
+            return 4;
+        case LP_ENC_32BIT_INT:
+            return 5;
+        case LP_ENC_64BIT_INT:
+            return 9;
+        default:
+            return 1;
+    }
+}
+
+/// bytes taken by the backward length @param len
+static size_t BacklenSize(size_t len) {
+    if (len <= 127)
+        return 1;
+    if (len < 16383)
+        return 2;
+    if (len < 2097151)
+        return 3;
+    if (len < 268435455)
+        return 4;
+    return 5;
+}
+
+/// the most significant 7 bits first, every byte but the first flagged with 128, so it reads from its last byte
+static void EncodeBacklen(unsigned char *p, size_t len) {
+    size_t n = BacklenSize(len);
+    for (size_t i = 0; i < n; ++i) {
+        size_t shift = 7 * (n - 1 - i);
+        p[i] = static_cast<unsigned char>((len >> shift) & 127);
+        if (i > 0)
+            p[i] |= 128;
+    }
+}
+
+/// the backward length ending at @param p, its last byte
+static size_t DecodeBacklen(const unsigned char *p) {
+    size_t len = 0;
+    size_t shift = 0;
+    while (true) {
+        len |= static_cast<size_t>(p[0] & 127) << shift;
+        if (!(p[0] & 128))
+            break;
+        shift += 7;
+        --p;
+    }
+    return len;
+}
+
+static size_t ElementSize(const unsigned char *p) {
+    size_t len = EncodedSize(p);
+    return len + BacklenSize(len);
+}
+
+/// replace the @param old_len bytes at @param offset of @param lp with @param new_len bytes left for the caller to
+/// fill, moving what follows. The buffer is reallocated when it is too small, or when it would stay less than half used
+static unsigned char *Resize(unsigned char *lp, size_t offset, size_t old_len, size_t new_len) {
+    size_t total = TotalBytes(lp);
+    size_t new_total = total - old_len + new_len;
+    size_t tail = total - offset - old_len;
+    size_t capacity = ZmallocSize(lp);
+    if (new_total <= capacity && new_total * 2 >= capacity) {
+        std::memmove(lp + offset + new_len, lp + offset + old_len, tail);
+    } else {
+        auto buf = new unsigned char[new_total];
+        std::memcpy(buf, lp, offset);
+        std::memcpy(buf + offset + new_len, lp + offset + old_len, tail);
+        delete[] lp;
+        lp = buf;
+    }
+
+    SetTotalBytes(lp, new_total);
+    return lp;
+}
+
+std::string_view Listpack::Value::View(char (&buf)[LP_INT_STR_LEN]) const {
+    if (!is_int)
+        return str;
+
+    auto [end, ec] = std::to_chars(buf, buf + LP_INT_STR_LEN, integer);
+    return {buf, static_cast<size_t>(end - buf)};
+}
+
+unsigned char *Listpack::New() {
+    auto lp = new unsigned char[LP_HDR_SIZE + 1];
+    SetTotalBytes(lp, LP_HDR_SIZE + 1);
+    SetCount(lp, 0);
+    lp[LP_HDR_SIZE] = LP_EOF;
+    return lp;
+}
+
+size_t Listpack::Bytes(const unsigned char *lp) {
+    return TotalBytes(lp);
+}
+
+size_t Listpack::Length(const unsigned char *lp) {
+    uint16_t count = Count(lp);
+    if (count != LP_COUNT_UNKNOWN)
+        return count;
+
+    size_t n = 0;
+    for (auto p = lp + LP_HDR_SIZE; *p != LP_EOF; p += ElementSize(p))
+        ++n;
+    return n;
+}
+
+unsigned char *Listpack::First(unsigned char *lp) {
+    unsigned char *p = lp + LP_HDR_SIZE;
+    return (*p == LP_EOF) ? nullptr : p;
+}
+
+unsigned char *Listpack::Last(unsigned char *lp) {
+    return Prev(lp, lp + TotalBytes(lp) - 1);
+}
+
+unsigned char *Listpack::Next(unsigned char *, unsigned char *p) {
+    p += ElementSize(p);
+    return (*p == LP_EOF) ? nullptr : p;
+}
+
+unsigned char *Listpack::Prev(unsigned char *lp, unsigned char *p) {
+    if (p <= lp + LP_HDR_SIZE)
+        return nullptr;
+
+    size_t len = DecodeBacklen(p - 1);
+    return p - BacklenSize(len) - len;
+}
+
+unsigned char *Listpack::Seek(unsigned char *lp, long index) {
+    if (index >= 0) {
+        unsigned char *p = First(lp);
+        for (; p && index > 0; --index)
+            p = Next(lp, p);
+        return p;
+    }
+
+    unsigned char *p = Last(lp);
+    for (; p && index < -1; ++index)
+        p = Prev(lp, p);
+    return p;
+}
+
+Listpack::Value Listpack::Get(const unsigned char *p) {
+    Value v;
+    unsigned char b = p[0];
+    auto as_str = [&v, p](size_t hdr_len, size_t len) {
+        v.str = {reinterpret_cast<const char *>(p + hdr_len), len};
+        return v;
+    };
+
+    v.is_int = true;
+    if ((b & 0x80) == LP_ENC_7BIT_UINT) {
+        v.integer = b;
+        return v;
+    }
+    if ((b & 0xE0) == LP_ENC_13BIT_INT) {
+        uint64_t u = ((b & 0x1F) << 8) | p[1];
+        v.integer = (u >= (1 << 12)) ? static_cast<int64_t>(u) - (1 << 13) : static_cast<int64_t>(u);
+        return v;
+    }
+
+    switch (b) {
+        case LP_ENC_16BIT_INT:
+            v.integer = static_cast<int16_t>(ReadLe(p + 1, 2));
+            return v;
+        case LP_ENC_24BIT_INT: {
+            auto u = static_cast<int64_t>(ReadLe(p + 1, 3));
+            v.integer = (u >= (1 << 23)) ? u - (1 << 24) : u;
+            return v;
+        }
+        case LP_ENC_32BIT_INT:
+            v.integer = static_cast<int32_t>(ReadLe(p + 1, 4));
+            return v;
+        case LP_ENC_64BIT_INT:
+            v.integer = static_cast<int64_t>(ReadLe(p + 1, 8));
+            return v;
+        default:
+            break;
+    }
+
+    v.is_int = false;
+    if ((b & 0xC0) == LP_ENC_6BIT_STR)
+        return as_str(1, b & 0x3F);
+    if ((b & 0xF0) == LP_ENC_12BIT_STR)
+        return as_str(2, ((b & 0x0F) << 8) | p[1]);
+    return as_str(5, ReadLe(p + 1, 4));
+}
+
+/// @param s_int tells whether @param s is an integer, @param s_value then being its value
+static bool Matches(const unsigned char *p, std::string_view s, bool s_int, int64_t s_value) {
+    auto v = Listpack::Get(p);
+    /// a string that is the canonical form of an integer is always stored as one
+    return v.is_int ? (s_int && v.integer == s_value) : v.str == s;
+}
+
+bool Listpack::Equals(const unsigned char *p, std::string_view s) {
+    int64_t value = 0;
+    bool is_int = StringToInt64(s, value);
+    return Matches(p, s, is_int, value);
+}
+
+unsigned char *Listpack::Find(unsigned char *lp, unsigned char *p, std::string_view s, size_t skip) {
+    int64_t value = 0;
+    bool is_int = StringToInt64(s, value);
+    size_t skipped = 0;
+    for (; p; p = Next(lp, p)) {
+        if (skipped > 0) {
+            --skipped;
+            continue;
+        }
+        if (Matches(p, s, is_int, value))
+            return p;
+        skipped = skip;
+    }
+    return nullptr;
+}
+
+unsigned char *Listpack::Insert(unsigned char *lp, std::string_view s, unsigned char *p, Where where,
+                                unsigned char **newp) {
+    Encoded enc = Encode(s);
+    size_t enc_size = enc.Size();
+    size_t entry_size = enc_size + BacklenSize(enc_size);
+
+    /// where the element goes, and the bytes it takes over
+    unsigned char *at = p ? p : lp + TotalBytes(lp) - 1;
+    size_t old_len = 0;
+    if (p && where == After) {
+        at = p + ElementSize(p);
+    } else if (p && where == Replace) {
+        old_len = ElementSize(p);
+    }
+
+    size_t offset = at - lp;
+    size_t count = Length(lp);
+    lp = Resize(lp, offset, old_len, entry_size);
+
+    unsigned char *dst = lp + offset;
+    std::memcpy(dst, enc.hdr, enc.hdr_len);
+    if (!enc.data.empty())
+        std::memcpy(dst + enc.hdr_len, enc.data.data(), enc.data.size());
+    EncodeBacklen(dst + enc_size, enc_size);
+
+    if (old_len == 0)
+        SetCount(lp, count + 1);
+    if (newp)
+        *newp = dst;
+    return lp;
+}
+
+unsigned char *Listpack::Delete(unsigned char *lp, unsigned char *p, size_t count, unsigned char **next) {
+    unsigned char *end = p;
+    size_t deleted = 0;
+    for (; deleted < count && *end != LP_EOF; ++deleted)
+        end += ElementSize(end);
+
+    size_t offset = p - lp;
+    size_t length = Length(lp);
+    lp = Resize(lp, offset, end - p, 0);
+    SetCount(lp, length - deleted);
+
+    if (next)
+        *next = (lp[offset] == LP_EOF) ? nullptr : lp + offset;
+    return lp;
+}
+
+size_t Listpack::EntrySize(std::string_view s) {
+    size_t len = Encode(s).Size();
+    return len + BacklenSize(len);
+}
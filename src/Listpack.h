@@ -0,0 +1,105 @@
+//
+// Created by Manh Nguyen Viet on 9/23/25.
+//
+
+#ifndef REDIS_CRAFT_LISTPACK_H
+#define REDIS_CRAFT_LISTPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/// total bytes (uint32_t) then number of elements (uint16_t)
+#define LP_HDR_SIZE 6
+#define LP_EOF 0xFF
+/// the element count saturates there, Length() then walks the elements
+#define LP_COUNT_UNKNOWN UINT16_MAX
+/// room for the decimal form of any int64_t
+#define LP_INT_STR_LEN 21
+
+/*
+ * A sequence of strings in one contiguous buffer, the layout of the listpacks of Redis:
+ *
+ *   <total bytes> <count> <element> ... <element> <EOF>
+ *
+ * An element is an encoding byte, followed by the length and the bytes of a string, or by an integer when the string
+ * is the canonical form of one (0..127 take a single byte), then by its own length in 1 to 5 bytes, read backwards,
+ * so the elements can be walked in both directions. Small collections take a single allocation this way, and no
+ * pointer or padding per element.
+ *
+ * The buffer is allocated with new[]. The functions changing a listpack take it and return it, as it may have moved;
+ * the element pointers taken before such a call are invalid afterwards. A listpack grows in place while the block the
+ * allocator gave is big enough.
+ * */
+class Listpack {
+public:
+    /// an element, either a string or the integer the string was stored as
+    typedef struct Value {
+        std::string_view str;       /// when !is_int
+        int64_t integer = 0;
+        bool is_int = false;
+
+        /// the element as a string, an integer being formatted into @param buf
+        std::string_view View(char (&buf)[LP_INT_STR_LEN]) const;
+    } Value;
+
+    enum Where {
+        Before = 0,
+        After = 1,
+        Replace = 2,
+    };
+
+    /// an empty listpack
+    static unsigned char *New();
+
+    static void Free(unsigned char *lp) { delete[] lp; }
+
+    /// bytes of @param lp, its header and EOF included
+    static size_t Bytes(const unsigned char *lp);
+
+    /// number of elements
+    static size_t Length(const unsigned char *lp);
+
+    /// the first / last element, nullptr when empty
+    static unsigned char *First(unsigned char *lp);
+
+    static unsigned char *Last(unsigned char *lp);
+
+    /// the element after / before @param p, nullptr at the end
+    static unsigned char *Next(unsigned char *lp, unsigned char *p);
+
+    static unsigned char *Prev(unsigned char *lp, unsigned char *p);
+
+    /// the element at @param index, negative counting from the tail (-1 is the last one). nullptr when out of range
+    static unsigned char *Seek(unsigned char *lp, long index);
+
+    static Value Get(const unsigned char *p);
+
+    /// whether the element at @param p is @param s
+    static bool Equals(const unsigned char *p, std::string_view s);
+
+    /// the first element equal to @param s from @param p on, comparing only one element every @param skip + 1:
+    /// the fields of a hash of field value pairs with a skip of 1. nullptr when not found
+    static unsigned char *Find(unsigned char *lp, unsigned char *p, std::string_view s, size_t skip);
+
+    /// insert @param s before or after the element at @param p, or replace it. A nullptr @param p with Before appends.
+    /// @param newp, if not null, is set to the inserted element
+    static unsigned char *Insert(unsigned char *lp, std::string_view s, unsigned char *p, Where where,
+                                 unsigned char **newp = nullptr);
+
+    static unsigned char *Append(unsigned char *lp, std::string_view s) { return Insert(lp, s, nullptr, Before); }
+
+    static unsigned char *Prepend(unsigned char *lp, std::string_view s) {
+        return Insert(lp, s, First(lp), Before);
+    }
+
+    /// remove @param count elements from @param p on, or up to the end if fewer. @param next, if not null, is set to
+    /// the element following them, nullptr at the end
+    static unsigned char *Delete(unsigned char *lp, unsigned char *p, size_t count = 1,
+                                 unsigned char **next = nullptr);
+
+    /// bytes an element holding @param s takes, to decide whether it still fits before inserting it
+    static size_t EntrySize(std::string_view s);
+};
+
+#endif //REDIS_CRAFT_LISTPACK_H
@@ -0,0 +1,260 @@
+//
+// Created by Manh Nguyen Viet on 9/24/25.
+//
+
+#include "Quicklist.h"
+#include "Listpack.h"
+#include "Zmalloc.h"
+#include "lzf.h"
+
+#include <algorithm>
+#include <cstring>
+
+/// the bytes of a node for the negative fills, -1 to -5
+static const size_t fill_sizes[] = {4096, 8192, 16384, 32768, 65536};
+/// a node filled by count does not grow past that many bytes, unless it holds a single element
+#define QUICKLIST_SIZE_SAFETY_LIMIT 8192
+
+Quicklist::Quicklist(int fill, int compress_depth) : fill_(fill), compress_depth_(compress_depth) {}
+
+Quicklist::~Quicklist() {
+    for (Node *node = head_; node;) {
+        Node *next = node->next;
+        delete[] node->data;
+        delete node;
+        node = next;
+    }
+}
+
+bool Quicklist::AllowsInsert(const Node *node, size_t entry_size) const {
+    if (!node)
+        return false;
+
+    size_t new_sz = node->sz + entry_size;
+    if (fill_ >= 0)
+        return node->count < static_cast<size_t>(std::max(fill_, 1)) && new_sz <= QUICKLIST_SIZE_SAFETY_LIMIT;
+    return new_sz <= fill_sizes[std::min(-fill_, -QUICKLIST_MIN_FILL) - 1];
+}
+
+Quicklist::Node *Quicklist::InsertNode(Node *prev) {
+    auto node = new Node();
+    node->prev = prev;
+    node->next = prev ? prev->next : head_;
+    if (node->next)
+        node->next->prev = node;
+    else
+        tail_ = node;
+    if (prev)
+        prev->next = node;
+    else
+        head_ = node;
+
+    ++nodes_;
+    bytes_ += ZmallocSize(node);
+    SetListpack(node, Listpack::New());
+    return node;
+}
+
+void Quicklist::UnlinkNode(Node *node) {
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        head_ = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        tail_ = node->prev;
+
+    --nodes_;
+    bytes_ -= ZmallocSize(node) + node->alloc;
+    delete[] node->data;
+    delete node;
+}
+
+void Quicklist::SetListpack(Node *node, unsigned char *lp) {
+    /// the previous buffer is already freed when the listpack moved
+    bytes_ -= node->data ? node->alloc : 0;
+    node->data = lp;
+    node->alloc = static_cast<uint32_t>(ZmallocSize(lp));
+    node->sz = static_cast<uint32_t>(Listpack::Bytes(lp));
+    node->incompressible = false;
+    bytes_ += node->alloc;
+}
+
+unsigned char *Quicklist::NodeListpack(const Node *node, std::string &scratch) {
+    if (node->compressed_len == 0)
+        return node->data;
+
+    scratch.resize(node->sz);
+    DecompressLzf(node->data, node->compressed_len, scratch.data(), node->sz);
+    return reinterpret_cast<unsigned char *>(scratch.data());
+}
+
+void Quicklist::Decompress(Node *node) {
+    if (node->compressed_len == 0)
+        return;
+
+    auto lp = new unsigned char[node->sz];
+    DecompressLzf(node->data, node->compressed_len, lp, node->sz);
+    delete[] node->data;
+    bytes_ -= node->alloc;
+    node->data = nullptr;
+    node->compressed_len = 0;
+    SetListpack(node, lp);
+}
+
+void Quicklist::Compress(Node *node) {
+    if (node->compressed_len > 0 || node->incompressible || node->sz < QUICKLIST_MIN_COMPRESS_BYTES)
+        return;
+
+    /// kept raw unless it saves at least 8 bytes
+    thread_local std::string scratch;
+    scratch.resize(node->sz);
+    unsigned int len = CompressLzf(node->data, node->sz, scratch.data(), node->sz - 8);
+    if (len == 0) {
+        node->incompressible = true;
+        return;
+    }
+
+    auto buf = new unsigned char[len];
+    std::memcpy(buf, scratch.data(), len);
+    delete[] node->data;
+    bytes_ -= node->alloc;
+    node->data = buf;
+    node->alloc = static_cast<uint32_t>(ZmallocSize(buf));
+    node->compressed_len = len;
+    bytes_ += node->alloc;
+}
+
+void Quicklist::UpdateCompression() {
+    if (compress_depth_ <= 0)
+        return;
+
+    Node *forward = head_;
+    Node *backward = tail_;
+    for (int i = 0; i < compress_depth_ && forward; ++i) {
+        Decompress(forward);
+        forward = forward->next;
+    }
+    for (int i = 0; i < compress_depth_ && backward; ++i) {
+        Decompress(backward);
+        backward = backward->prev;
+    }
+
+    /// with fewer nodes, the two ends cover them all
+    if (nodes_ <= 2 * static_cast<size_t>(compress_depth_))
+        return;
+    Compress(forward);
+    Compress(backward);
+}
+
+void Quicklist::Push(std::string_view s, bool head) {
+    Node *node = head ? head_ : tail_;
+    if (!AllowsInsert(node, Listpack::EntrySize(s)))
+        node = InsertNode(head ? nullptr : tail_);
+
+    Decompress(node);
+    SetListpack(node, head ? Listpack::Prepend(node->data, s) : Listpack::Append(node->data, s));
+    ++node->count;
+    ++count_;
+    UpdateCompression();
+}
+
+bool Quicklist::Pop(std::string &s, bool head) {
+    Node *node = head ? head_ : tail_;
+    if (!node)
+        return false;
+
+    Decompress(node);
+    unsigned char *p = head ? Listpack::First(node->data) : Listpack::Last(node->data);
+    char buf[LP_INT_STR_LEN];
+    s = Listpack::Get(p).View(buf);
+    if (node->count == 1) {
+        UnlinkNode(node);
+    } else {
+        SetListpack(node, Listpack::Delete(node->data, p));
+        --node->count;
+    }
+
+    --count_;
+    UpdateCompression();
+    return true;
+}
+
+Quicklist::Node *Quicklist::FindNode(size_t index, size_t &offset) const {
+    Node *node;
+    if (index < count_ / 2) {
+        for (node = head_; index >= node->count; node = node->next)
+            index -= node->count;
+        offset = index;
+    } else {
+        size_t back = count_ - 1 - index;
+        for (node = tail_; back >= node->count; node = node->prev)
+            back -= node->count;
+        offset = node->count - 1 - back;
+    }
+    return node;
+}
+
+/// the element at @param offset of @param lp of @param count elements, sought from the closest end
+static unsigned char *SeekNode(unsigned char *lp, size_t offset, size_t count) {
+    auto index = static_cast<long>(offset);
+    return Listpack::Seek(lp, (offset <= count / 2) ? index : index - static_cast<long>(count));
+}
+
+bool Quicklist::Index(long index, std::string &s) const {
+    if (index < 0)
+        index += static_cast<long>(count_);
+    if (index < 0 || static_cast<size_t>(index) >= count_)
+        return false;
+
+    size_t offset;
+    Node *node = FindNode(index, offset);
+    std::string scratch;
+    unsigned char *lp = NodeListpack(node, scratch);
+    char buf[LP_INT_STR_LEN];
+    s = Listpack::Get(SeekNode(lp, offset, node->count)).View(buf);
+    return true;
+}
+
+void Quicklist::Range(size_t start, size_t count, const std::function<void(std::string_view)> &fn) const {
+    if (start >= count_ || count == 0)
+        return;
+
+    size_t offset;
+    Node *node = FindNode(start, offset);
+    std::string scratch;
+    char buf[LP_INT_STR_LEN];
+    for (; node && count > 0; node = node->next, offset = 0) {
+        unsigned char *lp = NodeListpack(node, scratch);
+        for (auto p = SeekNode(lp, offset, node->count); p && count > 0; p = Listpack::Next(lp, p), --count) {
+            fn(Listpack::Get(p).View(buf));
+        }
+    }
+}
+
+void Quicklist::DeleteRange(size_t start, size_t count) {
+    if (start >= count_)
+        return;
+    count = std::min(count, count_ - start);
+
+    size_t offset;
+    Node *node = FindNode(start, offset);
+    while (count > 0) {
+        Node *next = node->next;
+        size_t n = std::min<size_t>(count, node->count - offset);
+        if (n == node->count) {
+            UnlinkNode(node);
+        } else {
+            Decompress(node);
+            SetListpack(node, Listpack::Delete(node->data, SeekNode(node->data, offset, node->count), n));
+            node->count -= n;
+        }
+
+        count_ -= n;
+        count -= n;
+        node = next;
+        offset = 0;
+    }
+    UpdateCompression();
+}
@@ -0,0 +1,122 @@
+//
+// Created by Manh Nguyen Viet on 9/24/25.
+//
+
+#ifndef REDIS_CRAFT_QUICKLIST_H
+#define REDIS_CRAFT_QUICKLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/// list-max-listpack-size: a positive fill is a number of elements per node, a negative one a size per node, from
+/// -1 for 4 KB to -5 for 64 KB
+#define QUICKLIST_DEFAULT_FILL (-2)
+#define QUICKLIST_MIN_FILL (-5)
+#define QUICKLIST_MAX_FILL (1 << 15)
+/// a node is not compressed under that many bytes, LZF would not save anything
+#define QUICKLIST_MIN_COMPRESS_BYTES 48
+
+/*
+ * A list as a doubly linked list of nodes, each one a Listpack of consecutive elements. The nodes are filled up to
+ * list-max-listpack-size, so a list costs a node every few hundred elements instead of an allocation per element,
+ * and LRANGE walks contiguous memory.
+ *
+ * With a compress depth d > 0, the nodes more than d nodes away from both ends are kept LZF compressed: the ends,
+ * where pushes and pops happen, stay raw, while the middle of a long queue takes less memory. A compressed node read
+ * by LINDEX or LRANGE is decompressed into a scratch buffer, it is only stored back raw when changed.
+ *
+ * Not thread safe.
+ * */
+class Quicklist {
+public:
+    explicit Quicklist(int fill = QUICKLIST_DEFAULT_FILL, int compress_depth = 0);
+
+    ~Quicklist();
+
+    Quicklist(const Quicklist &) = delete;
+
+    Quicklist &operator=(const Quicklist &) = delete;
+
+    /// number of elements
+    size_t Length() const { return count_; }
+
+    size_t Nodes() const { return nodes_; }
+
+    /// heap bytes of the nodes and their listpacks, the Quicklist itself excluded. Kept up to date, O(1)
+    size_t MemoryUsage() const { return bytes_; }
+
+    void PushHead(std::string_view s) { Push(s, true); }
+
+    void PushTail(std::string_view s) { Push(s, false); }
+
+    /// remove the first / last element into @param s. Return false when empty
+    bool PopHead(std::string &s) { return Pop(s, true); }
+
+    bool PopTail(std::string &s) { return Pop(s, false); }
+
+    /// the element at @param index, negative counting from the tail. Return false when out of range
+    bool Index(long index, std::string &s) const;
+
+    /// call @param fn with the @param count elements from @param start on, in order. The views are only valid during
+    /// the call
+    void Range(size_t start, size_t count, const std::function<void(std::string_view)> &fn) const;
+
+    /// remove the @param count elements from @param start on
+    void DeleteRange(size_t start, size_t count);
+
+private:
+    typedef struct Node {
+        Node *prev = nullptr;
+        Node *next = nullptr;
+        unsigned char *data = nullptr;  /// the listpack, or its LZF bytes when compressed_len > 0
+        uint32_t sz = 0;                /// bytes of the listpack, even while compressed
+        uint32_t count = 0;             /// elements of the listpack
+        uint32_t compressed_len = 0;
+        uint32_t alloc = 0;             /// usable bytes of data, as accounted in bytes_
+        bool incompressible = false;    /// LZF did not save anything since the last change
+    } Node;
+
+    void Push(std::string_view s, bool head);
+
+    bool Pop(std::string &s, bool head);
+
+    /// whether an element of @param entry_size bytes still fits in @param node per the fill
+    bool AllowsInsert(const Node *node, size_t entry_size) const;
+
+    /// a new empty node linked after @param prev, at the head when nullptr
+    Node *InsertNode(Node *prev);
+
+    void UnlinkNode(Node *node);
+
+    /// the listpack of @param node, decompressed into @param scratch if it is compressed
+    static unsigned char *NodeListpack(const Node *node, std::string &scratch);
+
+    /// decompress @param node in place, before changing it
+    void Decompress(Node *node);
+
+    /// LZF compress @param node in place when it saves something
+    void Compress(Node *node);
+
+    /// keep the compress depth nodes at both ends raw, and compress the ones right after them, which changes of the
+    /// ends may have moved inwards
+    void UpdateCompression();
+
+    /// replace the listpack of the raw @param node by @param lp, as returned by a change of it
+    void SetListpack(Node *node, unsigned char *lp);
+
+    /// find the node holding the element at @param index, set @param offset to its index in that node
+    Node *FindNode(size_t index, size_t &offset) const;
+
+    Node *head_ = nullptr;
+    Node *tail_ = nullptr;
+    size_t count_ = 0;
+    size_t nodes_ = 0;
+    size_t bytes_ = 0;
+    int fill_;
+    int compress_depth_;
+};
+
+#endif //REDIS_CRAFT_QUICKLIST_H
@@ -8,6 +8,7 @@
 #include "RedisOption.h"
 #include "Server.h"
 #include "RedisDef.h"
+#include "Zmalloc.h"
 
 LogLevel global_log_level = LogLevel::Silent;
 RedisConfig *globale_cfg = nullptr;
@@ -48,9 +49,14 @@ static int redis_parse_options(int argc, char **argv, RedisConfig *cfg) {
 }
 
 static void redis_set_global_config() {
-    Database::GetInstance()->SetConfig(globale_cfg);
+    /// Database::SetConfig() loads the dataset, which is not part of the startup memory
+    Database *db = Database::GetInstance();
+    size_t before_load = ZmallocUsedMemory();
+    db->SetConfig(globale_cfg);
+    size_t after_load = ZmallocUsedMemory();
 
     Server::GetInstance()->SetConfig(globale_cfg);
+    Server::GetInstance()->SetLoadedMemory((after_load > before_load) ? after_load - before_load : 0);
 }
 
 static void set_log_level(LogLevel lvl) {
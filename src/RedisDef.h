@@ -20,6 +20,13 @@ enum struct LogLevel {
 };
 
 #define BUFFER_SIZE 4096
+#define CRON_INTERVAL_MS 100    /// period of Server::ServerCron
+#define CRON_REHASH_MS 1        /// budget of the incremental rehash per cron
+#define CRON_EXPIRE_MS 25       /// budget of the active expire cycle per cron
+#define CRON_SPILL_MS 2         /// budget of moving the cold values to the value log per cron
+#define CRON_COMPACT_MS 1       /// budget of the value log compaction per cron
+#define SCAN_DEFAULT_COUNT 10
+#define SCAN_MAX_ITERATIONS_PER_KEY 10  /// bound the work of one SCAN call on a sparse table
 #define BULK_SIZE 1<<20
 
 #define RESP_PONG "+PONG\r\n"
@@ -32,6 +39,33 @@ enum struct LogLevel {
 
 #define RESP_FULLRESYNC "+FULLRESYNC"
 
+#define RESP_WRONGTYPE "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n"
+#define RESP_NOT_INTEGER "-ERR value is not an integer or out of range\r\n"
+#define RESP_NOT_FLOAT "-ERR value is not a valid float\r\n"
+#define RESP_INCR_OVERFLOW "-ERR increment or decrement would overflow\r\n"
+#define RESP_HASH_NOT_INTEGER "-ERR hash value is not an integer\r\n"
+#define RESP_NOT_POSITIVE "-ERR value is out of range, must be positive\r\n"
+#define RESP_TIMEOUT_NOT_FLOAT "-ERR timeout is not a float or out of range\r\n"
+#define RESP_TIMEOUT_NEGATIVE "-ERR timeout is negative\r\n"
+#define RESP_NUMKEYS_NOT_POSITIVE "-ERR numkeys should be greater than 0\r\n"
+#define RESP_NUMKEYS_TOO_MANY "-ERR Number of keys can't be greater than number of args\r\n"
+#define RESP_LIMIT_NEGATIVE "-ERR LIMIT can't be negative\r\n"
+#define RESP_INCR_NAN "-ERR increment would produce NaN or Infinity\r\n"
+#define RESP_SYNTAX_ERROR "-ERR syntax error\r\n"
+#define RESP_OOM "-OOM command not allowed when used memory > 'maxmemory'.\r\n"
+#define RESP_DB_OUT_OF_RANGE "-ERR DB index is out of range\r\n"
+#define RESP_HOTKEYS_OFF "-ERR hotkeys tracking is disabled, set hotkeys-sample-rate to enable it\r\n"
+#define RESP_KEYSPACE_STATS_OFF "-ERR keyspace stats are disabled, set keyspace-stats-delimiter to enable them\r\n"
+#define RESP_QUEUED "+QUEUED\r\n"
+#define RESP_NIL_ARRAY "*-1\r\n"
+#define RESP_UNKNOWN_COMMAND "-ERR unknown command\r\n"
+#define RESP_MULTI_NESTED "-ERR MULTI calls can not be nested\r\n"
+#define RESP_EXEC_WITHOUT_MULTI "-ERR EXEC without MULTI\r\n"
+#define RESP_DISCARD_WITHOUT_MULTI "-ERR DISCARD without MULTI\r\n"
+#define RESP_WATCH_IN_MULTI "-ERR WATCH inside MULTI is not allowed\r\n"
+#define RESP_EXECABORT "-EXECABORT Transaction discarded because of previous errors.\r\n"
+#define RESP_SAME_OBJECT "-ERR source and destination objects are the same\r\n"
+
 extern LogLevel global_log_level;
 extern const char TAG[];
 
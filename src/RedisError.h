@@ -26,10 +26,18 @@ enum Error {
     SyncReadError = -15,
     InvalidXaddEntryIdError = -16,
     NonMonotonicEntryIdError = -17,
+    WrongTypeError = -18,
+    NotIntegerError = -19,
+    IncrOverflowError = -20,
+    NotFloatError = -21,
+    IncrNanOrInfinityError = -22,
+    OutOfMemoryError = -23,
+    HashValueNotIntegerError = -24,
 
 
     /// retriable errors
     IncompletedCommand = -30,
+    WaitingSpilledValues = -31,     /// the command runs once its values are read back from the value log
 
     UnknownError = -101,
 };
@@ -0,0 +1,780 @@
+//
+// Created by Manh Nguyen Viet on 9/9/25.
+//
+
+#include "RedisObject.h"
+#include "Epoch.h"
+#include "Utils.h"
+#include "ValueLog.h"
+#include "Zmalloc.h"
+#include "lzf.h"
+
+#include <algorithm>
+#include <charconv>
+
+RedisObject RedisObject::CreateString(std::string_view s, int64_t expire_ts) {
+    RedisObject obj;
+    obj.type_ = ObjString;
+    obj.expire_ = expire_ts;
+
+    int64_t value;
+    if (StringToInt64(s, value)) {
+        obj.SetInteger(value);
+    } else if (s.size() <= OBJ_EMBSTR_MAX_LEN) {
+        obj.encoding_ = EncEmbStr;
+        obj.small_[0] = static_cast<uint8_t>(s.size());
+        std::memcpy(obj.small_ + 1, s.data(), s.size());
+    } else {
+        /// only the bytes, the length lives in the object
+        char *buf = new char[s.size()];
+        std::memcpy(buf, s.data(), s.size());
+        obj.encoding_ = EncRaw;
+        obj.SetHeapLen(static_cast<uint32_t>(s.size()));
+        obj.SetPtr(buf);
+    }
+
+    return obj;
+}
+
+RedisObject RedisObject::CreateInteger(int64_t value, int64_t expire_ts) {
+    RedisObject obj;
+    obj.type_ = ObjString;
+    obj.expire_ = expire_ts;
+    obj.SetInteger(value);
+    return obj;
+}
+
+RedisObject RedisObject::CreateStream() {
+    RedisObject obj;
+    obj.SetHeapPtr(ObjStream, EncStream, new Stream());
+    return obj;
+}
+
+RedisObject RedisObject::CreateHash() {
+    RedisObject obj;
+    obj.SetHeapPtr(ObjHash, EncListpack, Listpack::New());
+    return obj;
+}
+
+RedisObject RedisObject::CreateSet() {
+    RedisObject obj;
+    obj.SetHeapPtr(ObjSet, EncIntset, Intset::New());
+    return obj;
+}
+
+RedisObject RedisObject::CreateList(int fill, int compress_depth) {
+    RedisObject obj;
+    obj.SetHeapPtr(ObjList, EncQuicklist, new List(fill, compress_depth));
+    return obj;
+}
+
+RedisObject RedisObject::FromParsedResult(RdbParser::ParsedResult &result, int list_fill, int list_compress_depth) {
+    RedisObject obj;
+    const std::string &type = result.type;
+    if (type == "string") {
+        obj = CreateString(result.kv_value);
+    } else if (type == "list") {
+        obj = CreateList(list_fill, list_compress_depth);
+        for (auto &e: result.list_value)
+            obj.GetList()->PushTail(e);
+    } else if (type == "set") {
+        auto set = new Set();
+        for (auto &member: result.set_value)
+            set->Emplace(member, NoValue());
+        obj.SetHeapPtr(ObjSet, EncHashSet, set);
+    } else if (type == "zset") {
+        obj.SetHeapPtr(ObjZset, EncTreeZset, new Zset(std::move(result.zset_value)));
+    } else if (type == "hash") {
+        auto hash = new Hash();
+        for (auto &[field, value]: result.map_value)
+            hash->Set(field, std::move(value));
+        obj.SetHeapPtr(ObjHash, EncHashTable, hash);
+    } else if (type == "stream") {
+        obj.SetHeapPtr(ObjStream, EncStream, new Stream(std::move(result.stream)));
+    } else {
+        return obj;
+    }
+
+    obj.expire_ = (result.expire_time > 0) ? result.expire_time : 0;
+    return obj;
+}
+
+const char *RedisObject::TypeName() const {
+    switch (type_) {
+        case ObjString:
+            return "string";
+        case ObjList:
+            return "list";
+        case ObjSet:
+            return "set";
+        case ObjZset:
+            return "zset";
+        case ObjHash:
+            return "hash";
+        case ObjStream:
+            return "stream";
+        default:
+            return "none";
+    }
+}
+
+std::string RedisObject::String() const {
+    if (encoding_ == EncLzf)
+        return Decompress();
+
+    char buf[OBJ_INT_STR_LEN];
+    std::string scratch;
+    return std::string(StringView(buf, scratch));
+}
+
+std::string_view RedisObject::StringView(char (&buf)[OBJ_INT_STR_LEN], std::string &scratch) const {
+    if (encoding_ == EncInt) {
+        auto [end, ec] = std::to_chars(buf, buf + OBJ_INT_STR_LEN, Int());
+        return {buf, static_cast<size_t>(end - buf)};
+    }
+
+    if (encoding_ == EncLzf) {
+        scratch = Decompress();
+        return scratch;
+    }
+
+    return StringView();
+}
+
+bool RedisObject::Compress(size_t min_len) {
+    if (type_ != ObjString || encoding_ != EncRaw || HeapLen() < min_len)
+        return false;
+
+    /// compress into a scratch buffer first, so the value keeps exactly the bytes it needs
+    uint32_t raw_len = HeapLen();
+    thread_local std::string scratch;
+    scratch.resize(raw_len - raw_len / 8);
+    unsigned int len = CompressLzf(Ptr(), raw_len, scratch.data(), scratch.size());
+    if (len == 0)
+        return false;
+
+    /// the original length first, then the LZF bytes
+    char *buf = new char[sizeof(raw_len) + len];
+    std::memcpy(buf, &raw_len, sizeof(raw_len));
+    std::memcpy(buf + sizeof(raw_len), scratch.data(), len);
+
+    ReleaseBuffer();
+    encoding_ = EncLzf;
+    SetHeapLen(static_cast<uint32_t>(len));
+    SetPtr(buf);
+    return true;
+}
+
+bool RedisObject::GetCompressed(std::string_view &compressed, uint32_t &raw_len) const {
+    if (encoding_ != EncLzf)
+        return false;
+
+    auto buf = static_cast<const char *>(Ptr());
+    std::memcpy(&raw_len, buf, sizeof(raw_len));
+    compressed = {buf + sizeof(raw_len), HeapLen()};
+    return true;
+}
+
+std::string RedisObject::Decompress() const {
+    std::string_view compressed;
+    uint32_t raw_len;
+    GetCompressed(compressed, raw_len);
+
+    std::string s(raw_len, '\0');
+    DecompressLzf(compressed.data(), compressed.size(), s.data(), raw_len);
+    return s;
+}
+
+bool RedisObject::GetSpillPayload(int &encoding, std::string_view &payload) const {
+    if (type_ != ObjString || (encoding_ != EncRaw && encoding_ != EncLzf))
+        return false;
+
+    /// an LZF buffer starts with the original length
+    encoding = encoding_;
+    size_t len = (encoding_ == EncLzf) ? sizeof(uint32_t) + HeapLen() : HeapLen();
+    payload = {static_cast<const char *>(Ptr()), len};
+    return true;
+}
+
+void RedisObject::Spill(uint64_t location, uint32_t len) {
+    ReleaseBuffer();
+    encoding_ = EncSpilled;
+    SetHeapLen(len);
+    Relocate(location);
+}
+
+bool RedisObject::GetSpilled(uint64_t &location, uint32_t &len) const {
+    if (encoding_ != EncSpilled)
+        return false;
+
+    std::memcpy(&location, small_ + 4, sizeof(location));
+    len = HeapLen();
+    return true;
+}
+
+void RedisObject::Unspill(int encoding, std::string_view payload) {
+    uint64_t location;
+    uint32_t len;
+    if (GetSpilled(location, len))
+        ValueLog::GetInstance()->Discard(location, len);
+
+    char *buf = new char[payload.size()];
+    std::memcpy(buf, payload.data(), payload.size());
+    encoding_ = encoding;
+    SetHeapLen(static_cast<uint32_t>((encoding == EncLzf) ? payload.size() - sizeof(uint32_t) : payload.size()));
+    SetPtr(buf);
+}
+
+bool RedisObject::GetInteger(int64_t &value) const {
+    if (type_ != ObjString)
+        return false;
+
+    if (encoding_ == EncInt) {
+        value = Int();
+        return true;
+    }
+
+    if (encoding_ == EncLzf)
+        return StringToInt64(Decompress(), value);
+
+    return StringToInt64(StringView(), value);
+}
+
+void RedisObject::SetInteger(int64_t value) {
+    if ((encoding_ == EncRaw || encoding_ == EncLzf) && type_ == ObjString) {
+        ReleaseBuffer();
+    }
+
+    type_ = ObjString;
+    encoding_ = EncInt;
+    std::memcpy(small_ + 4, &value, sizeof(value));
+}
+
+size_t RedisObject::HashLength() const {
+    if (encoding_ == EncListpack)
+        return Listpack::Length(ListpackPtr()) / 2;
+    return GetHash()->Size();
+}
+
+bool RedisObject::HashGet(std::string_view field, std::string_view &value, char (&buf)[OBJ_INT_STR_LEN]) const {
+    if (encoding_ == EncListpack) {
+        auto lp = ListpackPtr();
+        auto p = Listpack::Find(lp, Listpack::First(lp), field, 1);
+        if (!p)
+            return false;
+
+        value = Listpack::Get(Listpack::Next(lp, p)).View(buf);
+        return true;
+    }
+
+    auto found = GetHash()->Find(field);
+    if (!found)
+        return false;
+
+    value = *found;
+    return true;
+}
+
+bool RedisObject::HashSet(std::string_view field, std::string_view value, size_t max_entries, size_t max_value) {
+    if (encoding_ == EncListpack && (field.size() > max_value || value.size() > max_value))
+        ConvertHashToTable();
+
+    if (encoding_ == EncHashTable) {
+        auto [slot, inserted] = GetHash()->Emplace(field, std::string(value));
+        if (!inserted)
+            slot->assign(value);
+        return inserted;
+    }
+
+    auto lp = ListpackPtr();
+    auto p = Listpack::Find(lp, Listpack::First(lp), field, 1);
+    if (p) {
+        SetPtr(Listpack::Insert(lp, value, Listpack::Next(lp, p), Listpack::Replace));
+        return false;
+    }
+
+    lp = Listpack::Append(lp, field);
+    SetPtr(Listpack::Append(lp, value));
+    if (HashLength() > max_entries)
+        ConvertHashToTable();
+    return true;
+}
+
+bool RedisObject::HashDelete(std::string_view field) {
+    if (encoding_ == EncHashTable)
+        return GetHash()->Erase(field);
+
+    auto lp = ListpackPtr();
+    auto p = Listpack::Find(lp, Listpack::First(lp), field, 1);
+    if (!p)
+        return false;
+
+    /// the field and its value
+    SetPtr(Listpack::Delete(lp, p, 2));
+    return true;
+}
+
+void RedisObject::HashForEach(const std::function<void(std::string_view, std::string_view)> &fn) const {
+    if (encoding_ == EncHashTable) {
+        GetHash()->ForEach([&fn](Hash::Entry &entry) { fn(entry.key, entry.value); });
+        return;
+    }
+
+    auto lp = ListpackPtr();
+    char field_buf[OBJ_INT_STR_LEN], value_buf[OBJ_INT_STR_LEN];
+    for (auto p = Listpack::First(lp); p; p = Listpack::Next(lp, p)) {
+        auto field = Listpack::Get(p).View(field_buf);
+        p = Listpack::Next(lp, p);
+        fn(field, Listpack::Get(p).View(value_buf));
+    }
+}
+
+void RedisObject::ConvertHashToTable() {
+    auto lp = ListpackPtr();
+    auto hash = new Hash();
+    HashForEach([hash](std::string_view field, std::string_view value) {
+        hash->Set(field, std::string(value));
+    });
+
+    Listpack::Free(lp);
+    SetHeapPtr(ObjHash, EncHashTable, hash);
+}
+
+bool RedisObject::CompactHash(size_t max_entries, size_t max_value) {
+    auto hash = GetHash();
+    if (!hash || hash->Size() > max_entries)
+        return false;
+    bool fits = true;
+    hash->ForEach([&](Hash::Entry &entry) {
+        fits = fits && entry.key.size() <= max_value && entry.value.size() <= max_value;
+    });
+    if (!fits)
+        return false;
+
+    auto lp = Listpack::New();
+    hash->ForEach([&lp](Hash::Entry &entry) {
+        lp = Listpack::Append(lp, entry.key);
+        lp = Listpack::Append(lp, entry.value);
+    });
+
+    delete hash;
+    SetHeapPtr(ObjHash, EncListpack, lp);
+    return true;
+}
+
+/// @param value formatted into @param buf
+static std::string_view IntView(int64_t value, char (&buf)[OBJ_INT_STR_LEN]) {
+    auto [end, ec] = std::to_chars(buf, buf + OBJ_INT_STR_LEN, value);
+    return {buf, static_cast<size_t>(end - buf)};
+}
+
+size_t RedisObject::SetLength() const {
+    if (encoding_ == EncIntset)
+        return Intset::Length(IntsetPtr());
+    return GetSet()->Size();
+}
+
+bool RedisObject::SetContains(std::string_view member) const {
+    if (encoding_ == EncHashSet)
+        return GetSet()->Contains(member);
+
+    int64_t value;
+    return StringToInt64(member, value) && Intset::Find(IntsetPtr(), value);
+}
+
+bool RedisObject::SetAdd(std::string_view member, size_t max_intset_entries) {
+    int64_t value = 0;
+    if (encoding_ == EncIntset && !StringToInt64(member, value))
+        ConvertSetToTable();
+
+    if (encoding_ == EncHashSet)
+        return GetSet()->Emplace(member, NoValue()).second;
+
+    bool added;
+    SetPtr(Intset::Add(IntsetPtr(), value, added));
+    if (added && SetLength() > max_intset_entries)
+        ConvertSetToTable();
+    return added;
+}
+
+bool RedisObject::SetRemove(std::string_view member) {
+    if (encoding_ == EncHashSet)
+        return GetSet()->Erase(member);
+
+    int64_t value;
+    if (!StringToInt64(member, value))
+        return false;
+
+    bool removed;
+    SetPtr(Intset::Remove(IntsetPtr(), value, removed));
+    return removed;
+}
+
+void RedisObject::SetForEach(const std::function<void(std::string_view)> &fn) const {
+    if (encoding_ == EncHashSet) {
+        GetSet()->ForEach([&fn](Set::Entry &entry) { fn(entry.key); });
+        return;
+    }
+
+    auto is = IntsetPtr();
+    const int64_t *data = Intset::Data(is);
+    char buf[OBJ_INT_STR_LEN];
+    for (size_t i = 0, len = Intset::Length(is); i < len; ++i) {
+        fn(IntView(data[i], buf));
+    }
+}
+
+void RedisObject::ConvertSetToTable() {
+    auto is = IntsetPtr();
+    auto set = new Set();
+    SetForEach([set](std::string_view member) {
+        set->Emplace(member, NoValue());
+    });
+
+    Intset::Free(is);
+    SetHeapPtr(ObjSet, EncHashSet, set);
+}
+
+bool RedisObject::CompactSet(size_t max_intset_entries) {
+    auto set = GetSet();
+    if (!set || set->Size() > max_intset_entries)
+        return false;
+
+    std::vector<int64_t> values;
+    values.reserve(set->Size());
+    bool integers = true;
+    set->ForEach([&](Set::Entry &entry) {
+        int64_t value;
+        if (integers && StringToInt64(entry.key, value))
+            values.push_back(value);
+        else
+            integers = false;
+    });
+    if (!integers)
+        return false;
+
+    auto is = Intset::New();
+    std::sort(values.begin(), values.end());
+    for (auto value: values) {
+        bool added;
+        is = Intset::Add(is, value, added);
+    }
+
+    delete set;
+    SetHeapPtr(ObjSet, EncIntset, is);
+    return true;
+}
+
+size_t RedisObject::SetIntersection(std::vector<const RedisObject *> sets, size_t limit,
+                                    const std::function<void(std::string_view)> &fn) {
+    for (auto set: sets) {
+        if (!set || set->SetLength() == 0)
+            return 0;
+    }
+
+    std::sort(sets.begin(), sets.end(), [](const RedisObject *a, const RedisObject *b) {
+        return a->SetLength() < b->SetLength();
+    });
+    std::vector<const RedisObject *> intsets, tables;
+    for (auto set: sets) {
+        (set->encoding_ == EncIntset ? intsets : tables).push_back(set);
+    }
+
+    size_t found = 0;
+    auto reached = [&found, limit]() { return limit > 0 && found == limit; };
+    if (intsets.empty()) {
+        /// every member of the smallest set is looked up in the others
+        sets[0]->SetForEach([&](std::string_view member) {
+            if (reached())
+                return;
+            for (size_t i = 1; i < sets.size(); ++i) {
+                if (!sets[i]->SetContains(member))
+                    return;
+            }
+            ++found;
+            if (fn)
+                fn(member);
+        });
+        return found;
+    }
+
+    /// the members common to the intsets, in one of the two buffers in turn
+    const int64_t *data = Intset::Data(intsets[0]->IntsetPtr());
+    size_t len = Intset::Length(intsets[0]->IntsetPtr());
+    std::vector<int64_t> common, scratch;
+    for (size_t i = 1; i < intsets.size() && len > 0; ++i) {
+        auto is = intsets[i]->IntsetPtr();
+        /// only the number of the members is wanted from the last step
+        bool count_only = i + 1 == intsets.size() && tables.empty() && !fn;
+        scratch.resize(count_only ? 0 : len);
+        len = Intset::Intersect(data, len, Intset::Data(is), Intset::Length(is), count_only ? nullptr : scratch.data());
+        common.swap(scratch);
+        data = common.data();
+        if (count_only)
+            return limit > 0 ? std::min(len, limit) : len;
+    }
+
+    char buf[OBJ_INT_STR_LEN];
+    for (size_t i = 0; i < len && !reached(); ++i) {
+        std::string_view member = IntView(data[i], buf);
+        bool everywhere = true;
+        for (size_t j = 0; j < tables.size() && everywhere; ++j) {
+            everywhere = tables[j]->SetContains(member);
+        }
+        if (!everywhere)
+            continue;
+
+        ++found;
+        if (fn)
+            fn(member);
+    }
+    return found;
+}
+
+size_t RedisObject::SetUnion(const std::vector<const RedisObject *> &sets,
+                             const std::function<void(std::string_view)> &fn) {
+    bool all_intsets = true;
+    for (auto set: sets) {
+        all_intsets = all_intsets && (!set || set->encoding_ == EncIntset);
+    }
+
+    if (!all_intsets) {
+        Set members;
+        for (auto set: sets) {
+            if (set)
+                set->SetForEach([&members](std::string_view member) { members.Emplace(member, NoValue()); });
+        }
+        members.ForEach([&fn](Set::Entry &entry) { fn(entry.key); });
+        return members.Size();
+    }
+
+    /// merged one intset after the other, the members stay sorted and unique
+    std::vector<int64_t> merged, scratch;
+    for (auto set: sets) {
+        if (!set)
+            continue;
+
+        auto is = set->IntsetPtr();
+        scratch.resize(merged.size() + Intset::Length(is));
+        scratch.resize(Intset::Union(merged.data(), merged.size(), Intset::Data(is), Intset::Length(is),
+                                     scratch.data()));
+        merged.swap(scratch);
+    }
+
+    char buf[OBJ_INT_STR_LEN];
+    for (auto value: merged) {
+        fn(IntView(value, buf));
+    }
+    return merged.size();
+}
+
+size_t RedisObject::SetDifference(const std::vector<const RedisObject *> &sets,
+                                  const std::function<void(std::string_view)> &fn) {
+    if (sets.empty() || !sets[0])
+        return 0;
+
+    std::vector<const RedisObject *> intsets, tables;
+    for (size_t i = 1; i < sets.size(); ++i) {
+        if (sets[i])
+            (sets[i]->encoding_ == EncIntset ? intsets : tables).push_back(sets[i]);
+    }
+
+    size_t found = 0;
+    if (sets[0]->encoding_ == EncHashSet) {
+        sets[0]->SetForEach([&](std::string_view member) {
+            for (size_t i = 1; i < sets.size(); ++i) {
+                if (sets[i] && sets[i]->SetContains(member))
+                    return;
+            }
+            ++found;
+            fn(member);
+        });
+        return found;
+    }
+
+    /// the intsets are taken out with the Intset kernels, in one of the two buffers in turn
+    const int64_t *data = Intset::Data(sets[0]->IntsetPtr());
+    size_t len = Intset::Length(sets[0]->IntsetPtr());
+    std::vector<int64_t> left, scratch;
+    for (size_t i = 0; i < intsets.size() && len > 0; ++i) {
+        auto is = intsets[i]->IntsetPtr();
+        scratch.resize(len);
+        len = Intset::Difference(data, len, Intset::Data(is), Intset::Length(is), scratch.data());
+        left.swap(scratch);
+        data = left.data();
+    }
+
+    char buf[OBJ_INT_STR_LEN];
+    for (size_t i = 0; i < len; ++i) {
+        std::string_view member = IntView(data[i], buf);
+        bool elsewhere = false;
+        for (size_t j = 0; j < tables.size() && !elsewhere; ++j) {
+            elsewhere = tables[j]->SetContains(member);
+        }
+        if (elsewhere)
+            continue;
+
+        ++found;
+        fn(member);
+    }
+    return found;
+}
+
+size_t RedisObject::FreeEffort() const {
+    switch (encoding_) {
+        case EncQuicklist:
+            return GetList()->Nodes();
+        case EncHashSet:
+            return GetSet()->Size();
+        case EncTreeZset:
+            return GetZset()->size();
+        case EncHashTable:
+            return GetHash()->Size();
+        case EncStream:
+            return GetStream()->size();
+        default:
+            return 1;
+    }
+}
+
+/// size of a node of std::set / std::map, the color and three links then the element
+#define TREE_NODE_SIZE(T) (4 * sizeof(void *) + sizeof(T))
+
+/// heap bytes of @param container of nodes of @param node_size bytes, @param element_heap(e) giving what an element
+/// holds on top of its node. Extrapolated from the first @param samples elements, all of them when 0
+template<typename C, typename Fn>
+static size_t ContainerSize(const C &container, size_t node_size, size_t samples, Fn &&element_heap) {
+    size_t bytes = ZmallocSizeFor(sizeof(C));
+    size_t sampled = 0, sampled_bytes = 0;
+    for (auto &e: container) {
+        if (samples > 0 && sampled == samples)
+            break;
+        sampled_bytes += ZmallocSizeFor(node_size) + element_heap(e);
+        ++sampled;
+    }
+
+    if (sampled > 0)
+        bytes += static_cast<size_t>(static_cast<double>(sampled_bytes) / sampled * container.size());
+    return bytes;
+}
+
+/// heap bytes of @param dict: its control bytes and slots, then @param entry_heap(e) for what every entry holds on
+/// top of its slot. Extrapolated from @param samples entries, all of them when 0
+template<typename V, typename Fn>
+static size_t DictSize(Dict<V> &dict, size_t samples, Fn &&entry_heap) {
+    size_t bytes = ZmallocSizeFor(sizeof(Dict<V>));
+    if (dict.Capacity() > 0)
+        bytes += ZmallocSizeFor(dict.Capacity()) + ZmallocSizeFor(dict.Capacity() * sizeof(typename Dict<V>::Entry));
+
+    size_t sampled = 0, sampled_bytes = 0;
+    auto visit = [&](typename Dict<V>::Entry &e) {
+        sampled_bytes += entry_heap(e);
+        ++sampled;
+        return true;
+    };
+    if (samples == 0)
+        dict.ForEach(visit);
+    else
+        dict.Sample(0, samples, visit);
+
+    if (sampled > 0)
+        bytes += static_cast<size_t>(static_cast<double>(sampled_bytes) / sampled * dict.Size());
+    return bytes;
+}
+
+size_t RedisObject::MemoryUsage(size_t samples) const {
+    switch (encoding_) {
+        case EncRaw:
+        case EncLzf:
+            return ZmallocSize(Ptr());
+        case EncQuicklist:
+            /// counted as the nodes change, nothing to sample
+            return ZmallocSizeFor(sizeof(List)) + GetList()->MemoryUsage();
+        case EncHashSet:
+            return DictSize(*GetSet(), samples, [](const Set::Entry &e) { return ZmallocStringSize(e.key); });
+        case EncTreeZset:
+            return ContainerSize(*GetZset(), TREE_NODE_SIZE(Zset::value_type), samples,
+                                 [](const Zset::value_type &e) { return ZmallocStringSize(e.first); });
+        case EncHashTable:
+            return DictSize(*GetHash(), samples, [](const Hash::Entry &e) {
+                return ZmallocStringSize(e.key) + ZmallocStringSize(e.value);
+            });
+        case EncListpack:
+        case EncIntset:
+            return ZmallocSize(Ptr());
+        case EncStream:
+            /// every entry is a vector of field and value strings
+            return ContainerSize(*GetStream(), TREE_NODE_SIZE(Stream::value_type), samples,
+                                 [](const Stream::value_type &e) {
+                                     size_t bytes = e.second.empty() ? 0 : ZmallocSizeFor(
+                                             e.second.capacity() * sizeof(std::string));
+                                     for (auto &s: e.second)
+                                         bytes += ZmallocStringSize(s);
+                                     return bytes;
+                                 });
+        default:
+            /// inline in the object
+            return 0;
+    }
+}
+
+std::string_view RedisObject::StringView() const {
+    switch (encoding_) {
+        case EncEmbStr:
+            return {reinterpret_cast<const char *>(small_ + 1), small_[0]};
+        case EncRaw:
+            return {static_cast<const char *>(Ptr()), HeapLen()};
+        default:
+            return {};
+    }
+}
+
+void RedisObject::ReleaseBuffer() {
+    Epoch::RetireArray(static_cast<char *>(Ptr()));
+}
+
+void RedisObject::Release() {
+    if (type_ == ObjNone)
+        return;
+
+    switch (encoding_) {
+        case EncRaw:
+        case EncLzf:
+            ReleaseBuffer();
+            break;
+        case EncQuicklist:
+            delete static_cast<List *>(Ptr());
+            break;
+        case EncHashSet:
+            delete static_cast<Set *>(Ptr());
+            break;
+        case EncIntset:
+            Intset::Free(IntsetPtr());
+            break;
+        case EncTreeZset:
+            delete static_cast<Zset *>(Ptr());
+            break;
+        case EncHashTable:
+            delete static_cast<Hash *>(Ptr());
+            break;
+        case EncListpack:
+            Listpack::Free(ListpackPtr());
+            break;
+        case EncStream:
+            delete static_cast<Stream *>(Ptr());
+            break;
+        case EncSpilled: {
+            /// the record in the log is dead
+            uint64_t location;
+            uint32_t len;
+            GetSpilled(location, len);
+            ValueLog::GetInstance()->Discard(location, len);
+            break;
+        }
+        default:
+            break;
+    }
+
+    type_ = ObjNone;
+    encoding_ = EncRaw;
+}
@@ -0,0 +1,319 @@
+//
+// Created by Manh Nguyen Viet on 9/9/25.
+//
+
+#ifndef REDIS_CRAFT_REDISOBJECT_H
+#define REDIS_CRAFT_REDISOBJECT_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Dict.h"
+#include "Intset.h"
+#include "Listpack.h"
+#include "Quicklist.h"
+#include "rdbparse.h"
+
+/// longest string stored inline in the object, without any allocation
+#define OBJ_EMBSTR_MAX_LEN 11
+/// room for the decimal form of any int64_t
+#define OBJ_INT_STR_LEN 21
+
+enum ObjectType {
+    ObjString = 0,
+    ObjList = 1,
+    ObjSet = 2,
+    ObjZset = 3,
+    ObjHash = 4,
+    ObjStream = 5,
+    ObjNone = 15,
+};
+
+/// number of the object types, ObjNone excluded
+#define OBJ_TYPES (ObjStream + 1)
+
+enum ObjectEncoding {
+    EncRaw = 0,         /// string in its own heap buffer
+    EncEmbStr = 1,      /// string inline in the object
+    EncQuicklist = 2,   /// Quicklist, nodes of listpacks
+    EncHashSet = 3,     /// Dict of the members, without values
+    EncTreeZset = 4,    /// std::map<std::string, double>
+    EncHashTable = 5,   /// Dict of the fields and their values
+    EncStream = 6,      /// RdbParser::Stream
+    EncInt = 7,         /// string that is a 64 bit integer, kept as int64_t inline in the object
+    EncLzf = 8,         /// string compressed with LZF in its own heap buffer, see Compress()
+    EncSpilled = 9,     /// string moved out to the value log, the object only keeps its location, see Spill()
+    EncListpack = 10,   /// small hash, its fields and values in turn in a Listpack
+    EncIntset = 11,     /// set of integers, sorted in an Intset
+};
+
+/// value of the members of a set, they are the keys of its Dict
+typedef struct NoValue {
+} NoValue;
+
+/*
+ * Value of a key in the keyspace, 24 bytes.
+ *
+ * The header keeps the type, the encoding and 24 bits of LRU/LFU data, followed by 12 bytes of payload:
+ * either an inline string (1 byte length + up to 11 bytes), an int64_t for integer strings, or the length and the
+ * pointer of a heap allocation holding the type-specific structure. The absolute expire time in ms is kept here as
+ * well, <= 0 means no expiry. Only the structure of the actual type is ever allocated.
+ * */
+class RedisObject {
+public:
+    using List = Quicklist;
+    using Set = Dict<NoValue>;
+    using Zset = std::map<std::string, double>;
+    using Hash = Dict<std::string>;
+    using Stream = RdbParser::Stream;
+
+    RedisObject() : type_(ObjNone), encoding_(EncRaw), lru_(0), small_{}, expire_(0) {}
+
+    ~RedisObject() { Release(); }
+
+    RedisObject(const RedisObject &) = delete;
+
+    RedisObject &operator=(const RedisObject &) = delete;
+
+    RedisObject(RedisObject &&other) noexcept: RedisObject() {
+        MoveFrom(other);
+    }
+
+    RedisObject &operator=(RedisObject &&other) noexcept {
+        if (this != &other) {
+            Release();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    /// strings that are canonical 64 bit integers are encoded as EncInt
+    static RedisObject CreateString(std::string_view s, int64_t expire_ts = 0);
+
+    static RedisObject CreateInteger(int64_t value, int64_t expire_ts = 0);
+
+    static RedisObject CreateStream();
+
+    /// an empty hash, as a listpack
+    static RedisObject CreateHash();
+
+    /// an empty set, as an intset
+    static RedisObject CreateSet();
+
+    /// an empty list, @param fill and @param compress_depth as list-max-listpack-size and list-compress-depth
+    static RedisObject CreateList(int fill, int compress_depth);
+
+    /// take over the value parsed from a RDB file, a list being built with @param list_fill and
+    /// @param list_compress_depth
+    static RedisObject FromParsedResult(RdbParser::ParsedResult &result, int list_fill = QUICKLIST_DEFAULT_FILL,
+                                        int list_compress_depth = 0);
+
+    int Type() const { return type_; }
+
+    int Encoding() const { return encoding_; }
+
+    bool Empty() const { return type_ == ObjNone; }
+
+    /// name of the type, as replied by the TYPE command
+    const char *TypeName() const;
+
+    int64_t Expire() const { return expire_; }
+
+    void SetExpire(int64_t expire_ts) { expire_ = expire_ts; }
+
+    bool IsExpired(int64_t now) const { return expire_ > 0 && expire_ < now; }
+
+    uint32_t Lru() const { return lru_; }
+
+    void SetLru(uint32_t lru) { lru_ = lru & 0xFFFFFF; }
+
+    /// only valid for ObjString
+    std::string String() const;
+
+    /// the bytes of a string without copying them when possible: an EncInt is formatted into @param buf and an EncLzf
+    /// decompressed into @param scratch. Only valid for ObjString
+    std::string_view StringView(char (&buf)[OBJ_INT_STR_LEN], std::string &scratch) const;
+
+    /// LZF compress a raw string of at least @param min_len bytes in place. It stays raw and false is returned when
+    /// compressing does not save at least 1/8 of its size
+    bool Compress(size_t min_len);
+
+    /// the LZF bytes of an EncLzf string and its original length, in the form of a RDB_ENC_LZF string of a RDB file.
+    /// Return false for any other encoding
+    bool GetCompressed(std::string_view &compressed, uint32_t &raw_len) const;
+
+    /// the bytes to write to the value log for an EncRaw or EncLzf string, and its encoding. Return false for any
+    /// other encoding
+    bool GetSpillPayload(int &encoding, std::string_view &payload) const;
+
+    /// free the bytes of a string written to the value log at @param location, in a record of @param len bytes. It
+    /// becomes an EncSpilled stub keeping its type, expire time and access history
+    void Spill(uint64_t location, uint32_t len);
+
+    /// the record of an EncSpilled stub. Return false for any other encoding
+    bool GetSpilled(uint64_t &location, uint32_t &len) const;
+
+    /// point a stub to the copy of its record a compaction wrote at @param location
+    void Relocate(uint64_t location) { std::memcpy(small_ + 4, &location, sizeof(location)); }
+
+    /// turn a stub back into the string read from its record, @param encoding and @param payload as
+    /// GetSpillPayload() gave them. The record is discarded
+    void Unspill(int encoding, std::string_view payload);
+
+    /// get the value of a string as an integer, without parsing when it is EncInt. Return false if it is not one
+    bool GetInteger(int64_t &value) const;
+
+    /// replace the value of a string with @param value in place, no allocation unless it held a heap buffer
+    void SetInteger(int64_t value);
+
+    /// roughly the number of allocations to release, 1 for strings and the number of elements for collections
+    size_t FreeEffort() const;
+
+    /// heap bytes held by the value, the object itself excluded. Collections are estimated from their first
+    /// @param samples elements, 0 means all of them
+    size_t MemoryUsage(size_t samples) const;
+
+    Stream *GetStream() const { return (encoding_ == EncStream) ? static_cast<Stream *>(Ptr()) : nullptr; }
+
+    List *GetList() const { return (encoding_ == EncQuicklist) ? static_cast<List *>(Ptr()) : nullptr; }
+
+    Set *GetSet() const { return (encoding_ == EncHashSet) ? static_cast<Set *>(Ptr()) : nullptr; }
+
+    Zset *GetZset() const { return (encoding_ == EncTreeZset) ? static_cast<Zset *>(Ptr()) : nullptr; }
+
+    Hash *GetHash() const { return (encoding_ == EncHashTable) ? static_cast<Hash *>(Ptr()) : nullptr; }
+
+    /// number of fields, only valid for ObjHash
+    size_t HashLength() const;
+
+    /// the value of @param field, an integer of a listpack being formatted into @param buf. Return false if the field
+    /// does not exist. Only valid for ObjHash
+    bool HashGet(std::string_view field, std::string_view &value, char (&buf)[OBJ_INT_STR_LEN]) const;
+
+    /// set @param field to @param value. A listpack turns into a hashtable once it has more than @param max_entries
+    /// fields, or a field or value longer than @param max_value bytes. Return true if the field is new.
+    /// Only valid for ObjHash
+    bool HashSet(std::string_view field, std::string_view value, size_t max_entries, size_t max_value);
+
+    /// remove @param field. Return false if it did not exist. Only valid for ObjHash
+    bool HashDelete(std::string_view field);
+
+    /// call @param fn with every field and its value. Only valid for ObjHash
+    void HashForEach(const std::function<void(std::string_view, std::string_view)> &fn) const;
+
+    /// turn a hashtable within @param max_entries and @param max_value into a listpack, as a hash loaded from a RDB
+    /// file is. Return whether it was converted
+    bool CompactHash(size_t max_entries, size_t max_value);
+
+    /// number of members, only valid for ObjSet
+    size_t SetLength() const;
+
+    /// whether @param member is in the set. Only valid for ObjSet
+    bool SetContains(std::string_view member) const;
+
+    /// add @param member. An intset turns into a hashtable for a member that is not an integer, or past
+    /// @param max_intset_entries members. Return true if the member is new. Only valid for ObjSet
+    bool SetAdd(std::string_view member, size_t max_intset_entries);
+
+    /// remove @param member. Return false if it was not there. Only valid for ObjSet
+    bool SetRemove(std::string_view member);
+
+    /// call @param fn with every member, an intset in increasing order. Only valid for ObjSet
+    void SetForEach(const std::function<void(std::string_view)> &fn) const;
+
+    /// turn a hashtable of at most @param max_intset_entries integers into an intset, as a set loaded from a RDB file
+    /// is. Return whether it was converted
+    bool CompactSet(size_t max_intset_entries);
+
+    /// SINTER, SINTERCARD: the members of all the @param sets, a nullptr one being empty. Up to @param limit of them
+    /// (0: no limit) are given to @param fn, when set, and their number is returned. The intsets are intersected with
+    /// the Intset kernels, smallest first, what is left is looked up in the hashtables
+    static size_t SetIntersection(std::vector<const RedisObject *> sets, size_t limit,
+                                  const std::function<void(std::string_view)> &fn);
+
+    /// SUNION: the members of any of the @param sets to @param fn, each once. Return their number
+    static size_t SetUnion(const std::vector<const RedisObject *> &sets,
+                           const std::function<void(std::string_view)> &fn);
+
+    /// SDIFF: the members of the first of the @param sets found in none of the others to @param fn. Return their number
+    static size_t SetDifference(const std::vector<const RedisObject *> &sets,
+                                const std::function<void(std::string_view)> &fn);
+
+private:
+    /// bytes of EncEmbStr and EncRaw strings
+    std::string_view StringView() const;
+
+    unsigned char *ListpackPtr() const { return static_cast<unsigned char *>(Ptr()); }
+
+    unsigned char *IntsetPtr() const { return static_cast<unsigned char *>(Ptr()); }
+
+    /// move the fields of a listpack hash to a hashtable
+    void ConvertHashToTable();
+
+    /// move the members of an intset to a hashtable
+    void ConvertSetToTable();
+
+    /// the original bytes of an EncLzf string
+    std::string Decompress() const;
+
+    int64_t Int() const {
+        int64_t v;
+        std::memcpy(&v, small_ + 4, sizeof(v));
+        return v;
+    }
+
+    void *Ptr() const {
+        void *p;
+        std::memcpy(&p, small_ + 4, sizeof(p));
+        return p;
+    }
+
+    void SetPtr(void *p) { std::memcpy(small_ + 4, &p, sizeof(p)); }
+
+    uint32_t HeapLen() const {
+        uint32_t len;
+        std::memcpy(&len, small_, sizeof(len));
+        return len;
+    }
+
+    void SetHeapLen(uint32_t len) { std::memcpy(small_, &len, sizeof(len)); }
+
+    void SetHeapPtr(int type, int encoding, void *p) {
+        type_ = type;
+        encoding_ = encoding;
+        SetPtr(p);
+    }
+
+    void MoveFrom(RedisObject &other) {
+        type_ = other.type_;
+        encoding_ = other.encoding_;
+        lru_ = other.lru_;
+        std::memcpy(small_, other.small_, sizeof(small_));
+        expire_ = other.expire_;
+
+        other.type_ = ObjNone;
+        other.encoding_ = EncRaw;
+    }
+
+    /// free the heap structure, if any
+    void Release();
+
+    /// free the bytes of an EncRaw or EncLzf string. A reader without the stripe lock may still be copying them, so
+    /// they go through Epoch
+    void ReleaseBuffer();
+
+    uint32_t type_: 4;
+    uint32_t encoding_: 4;
+    uint32_t lru_: 24;
+    uint8_t small_[12];
+    int64_t expire_;
+};
+
+static_assert(sizeof(RedisObject) == 24, "RedisObject should stay compact");
+
+#endif //REDIS_CRAFT_REDISOBJECT_H
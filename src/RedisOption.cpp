@@ -3,8 +3,12 @@
 //
 
 #include "RedisOption.h"
+#include "HotKeys.h"
+#include "Quicklist.h"
+#include "ValueLog.h"
 
 #include <cstring>
+#include <strings.h>
 #include <sstream>
 #include <iostream>
 
@@ -63,12 +67,238 @@ static int opt_replicaof(RedisConfig *redis_cfg, const char *arg) {
     return -1;
 }
 
+/// parse a yes | no option
+static int opt_yes_no(const char *arg, bool &value) {
+    if (strcasecmp(arg, "yes") == 0) {
+        value = true;
+        return 0;
+    } else if (strcasecmp(arg, "no") == 0) {
+        value = false;
+        return 0;
+    }
+
+    std::cerr << "Invalid value " << arg << ", expect yes or no" << std::endl;
+    return -1;
+}
+
+static int opt_lazyfree_lazy_expire(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->lazyfree_lazy_expire) : -1;
+}
+
+static int opt_lazyfree_lazy_server_del(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->lazyfree_lazy_server_del) : -1;
+}
+
+static int opt_lazyfree_lazy_user_del(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->lazyfree_lazy_user_del) : -1;
+}
+
+static int opt_lazyfree_lazy_user_flush(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->lazyfree_lazy_user_flush) : -1;
+}
+
+static int opt_replica_lazy_flush(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->replica_lazy_flush) : -1;
+}
+
+static int opt_lazyfree_lazy_eviction(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->lazyfree_lazy_eviction) : -1;
+}
+
+static const char *maxmemory_policy_names[] = {
+        "noeviction",
+        "allkeys-lru",
+        "volatile-lru",
+        "allkeys-lfu",
+        "volatile-lfu",
+        "allkeys-random",
+        "volatile-random",
+        "volatile-ttl",
+};
+
+const char *MaxMemoryPolicyName(int policy) {
+    if (policy < 0 || policy >= static_cast<int>(sizeof(maxmemory_policy_names) / sizeof(maxmemory_policy_names[0])))
+        return "unknown";
+
+    return maxmemory_policy_names[policy];
+}
+
+/// parse a memory size as "1gb", "100mb", "64kb" or a number of bytes into @param bytes
+static int opt_memory_size(const char *name, const char *arg, size_t &bytes) {
+    char *end = nullptr;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (end == arg) {
+        std::cerr << "Invalid " << name << " " << arg << std::endl;
+        return -1;
+    }
+
+    unsigned long long mul = 1;
+    if (strcasecmp(end, "k") == 0) {
+        mul = 1000;
+    } else if (strcasecmp(end, "kb") == 0) {
+        mul = 1024;
+    } else if (strcasecmp(end, "m") == 0) {
+        mul = 1000 * 1000;
+    } else if (strcasecmp(end, "mb") == 0) {
+        mul = 1024 * 1024;
+    } else if (strcasecmp(end, "g") == 0) {
+        mul = 1000L * 1000 * 1000;
+    } else if (strcasecmp(end, "gb") == 0) {
+        mul = 1024L * 1024 * 1024;
+    } else if (*end != '\0') {
+        std::cerr << "Invalid " << name << " " << arg << std::endl;
+        return -1;
+    }
+
+    bytes = value * mul;
+    return 0;
+}
+
+static int opt_maxmemory(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_memory_size("maxmemory", arg, redis_cfg->maxmemory) : -1;
+}
+
+static int opt_maxmemory_policy(RedisConfig *redis_cfg, const char *arg) {
+    if (!redis_cfg)
+        return -1;
+
+    for (int i = 0; i < static_cast<int>(sizeof(maxmemory_policy_names) / sizeof(maxmemory_policy_names[0])); ++i) {
+        if (strcasecmp(arg, maxmemory_policy_names[i]) == 0) {
+            redis_cfg->maxmemory_policy = i;
+            return 0;
+        }
+    }
+
+    std::cerr << "Invalid maxmemory-policy " << arg << std::endl;
+    return -1;
+}
+
+/// parse an integer in [@param min, @param max]
+static int opt_int(const char *arg, int min, int max, int &value) {
+    try {
+        int v = std::stoi(arg);
+        if (v < min || v > max)
+            return -1;
+        value = v;
+        return 0;
+    }
+    catch (const std::exception &e) {
+        return -1;
+    }
+}
+
+static int opt_maxmemory_samples(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 1, 64, redis_cfg->maxmemory_samples) : -1;
+}
+
+static int opt_lfu_log_factor(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->lfu_log_factor) : -1;
+}
+
+static int opt_lfu_decay_time(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->lfu_decay_time) : -1;
+}
+
+static int opt_key_index(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_yes_no(arg, redis_cfg->key_index) : -1;
+}
+
+static int opt_databases(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 1, MAX_DATABASES, redis_cfg->databases) : -1;
+}
+
+static int opt_string_compression_threshold(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->string_compression_threshold) : -1;
+}
+
+static int opt_tiered_max_memory(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_memory_size("tiered-max-memory", arg, redis_cfg->tiered_max_memory) : -1;
+}
+
+static int opt_tiered_min_value_size(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 1, INT32_MAX, redis_cfg->tiered_min_value_size) : -1;
+}
+
+static int opt_tiered_segment_size(RedisConfig *redis_cfg, const char *arg) {
+    if (!redis_cfg || opt_memory_size("tiered-segment-size", arg, redis_cfg->tiered_segment_size) < 0)
+        return -1;
+    /// the offsets in a segment have VLOG_OFFSET_BITS bits
+    return (redis_cfg->tiered_segment_size > 0 && redis_cfg->tiered_segment_size <= VLOG_OFFSET_MASK) ? 0 : -1;
+}
+
+static int opt_tiered_compact_percent(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 1, 100, redis_cfg->tiered_compact_percent) : -1;
+}
+
+static int opt_hotkeys_sample_rate(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->hotkeys_sample_rate) : -1;
+}
+
+static int opt_hotkeys_top_k(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 1, HOTKEYS_MAX_TOP_K, redis_cfg->hotkeys_top_k) : -1;
+}
+
+static int opt_hash_max_listpack_entries(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->hash_max_listpack_entries) : -1;
+}
+
+static int opt_hash_max_listpack_value(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->hash_max_listpack_value) : -1;
+}
+
+static int opt_list_max_listpack_size(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, QUICKLIST_MIN_FILL, QUICKLIST_MAX_FILL, redis_cfg->list_max_listpack_size) : -1;
+}
+
+static int opt_list_compress_depth(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT16_MAX, redis_cfg->list_compress_depth) : -1;
+}
+
+static int opt_set_max_intset_entries(RedisConfig *redis_cfg, const char *arg) {
+    return redis_cfg ? opt_int(arg, 0, INT32_MAX, redis_cfg->set_max_intset_entries) : -1;
+}
+
+static int opt_keyspace_stats_delimiter(RedisConfig *redis_cfg, const char *arg) {
+    if (redis_cfg) {
+        redis_cfg->keyspace_stats_delimiter = arg;
+        return 0;
+    }
+
+    return -1;
+}
+
 const RedisOptionDef redis_options[] =
         {
-                {"dir",        opt_dir},
-                {"dbfilename", opt_dbfilename},
-                {"port",       opt_port},
-                {"replicaof",  opt_replicaof},
+                {"dir",                      opt_dir},
+                {"dbfilename",               opt_dbfilename},
+                {"port",                     opt_port},
+                {"replicaof",                opt_replicaof},
+                {"lazyfree-lazy-expire",     opt_lazyfree_lazy_expire},
+                {"lazyfree-lazy-server-del", opt_lazyfree_lazy_server_del},
+                {"lazyfree-lazy-user-del",   opt_lazyfree_lazy_user_del},
+                {"lazyfree-lazy-user-flush", opt_lazyfree_lazy_user_flush},
+                {"replica-lazy-flush",       opt_replica_lazy_flush},
+                {"lazyfree-lazy-eviction",   opt_lazyfree_lazy_eviction},
+                {"maxmemory",                opt_maxmemory},
+                {"maxmemory-policy",         opt_maxmemory_policy},
+                {"maxmemory-samples",        opt_maxmemory_samples},
+                {"lfu-log-factor",           opt_lfu_log_factor},
+                {"lfu-decay-time",           opt_lfu_decay_time},
+                {"key-index",                opt_key_index},
+                {"databases",                opt_databases},
+                {"string-compression-threshold", opt_string_compression_threshold},
+                {"tiered-max-memory",        opt_tiered_max_memory},
+                {"tiered-min-value-size",    opt_tiered_min_value_size},
+                {"tiered-segment-size",      opt_tiered_segment_size},
+                {"tiered-compact-percent",   opt_tiered_compact_percent},
+                {"hotkeys-sample-rate",      opt_hotkeys_sample_rate},
+                {"hotkeys-top-k",            opt_hotkeys_top_k},
+                {"hash-max-listpack-entries", opt_hash_max_listpack_entries},
+                {"hash-max-listpack-value",  opt_hash_max_listpack_value},
+                {"list-max-listpack-size",   opt_list_max_listpack_size},
+                {"list-compress-depth",      opt_list_compress_depth},
+                {"set-max-intset-entries",   opt_set_max_intset_entries},
+                {"keyspace-stats-delimiter", opt_keyspace_stats_delimiter},
                 {nullptr}
         };
 
@@ -10,6 +10,21 @@
 
 extern int server_port;
 
+/// what to do when the used memory reaches maxmemory
+enum MaxMemoryPolicy {
+    MaxMemoryNoEviction = 0,    /// reply an OOM error to the commands which may grow the dataset
+    MaxMemoryAllKeysLru,
+    MaxMemoryVolatileLru,       /// volatile: only among the keys with an expire time
+    MaxMemoryAllKeysLfu,
+    MaxMemoryVolatileLfu,
+    MaxMemoryAllKeysRandom,
+    MaxMemoryVolatileRandom,
+    MaxMemoryVolatileTtl,       /// the key which expires first
+};
+
+/// name of @param policy as in the config, e.g "allkeys-lru"
+const char *MaxMemoryPolicyName(int policy);
+
 typedef struct RedisConfig {
     std::string dir_path;
     std::string dbfilename;
@@ -19,8 +34,65 @@ typedef struct RedisConfig {
     std::string master_host;
     int master_port;
 
+    /// free in the background (lazy free) instead of inline
+    bool lazyfree_lazy_expire;          /// the values of expired keys
+    bool lazyfree_lazy_server_del;      /// the old values overwritten or deleted by the server itself
+    bool lazyfree_lazy_user_del;        /// the values deleted by DEL, i.e DEL behaves as UNLINK
+    bool lazyfree_lazy_user_flush;      /// the dataset of FLUSHALL / FLUSHDB without option
+    bool replica_lazy_flush;            /// the dataset of a replica discarded by a full sync
+    bool lazyfree_lazy_eviction;        /// the values of evicted keys
+
+    size_t maxmemory;                   /// bytes, 0 means no limit
+    int maxmemory_policy;               /// MaxMemoryPolicy
+    int maxmemory_samples;              /// keys sampled per eviction
+    int lfu_log_factor;
+    int lfu_decay_time;                 /// minutes
+
+    bool key_index;                     /// keep the ordered KeyIndex of the key names for the prefix lookups
+
+    int databases;                      /// number of logical databases
+
+    int string_compression_threshold;   /// bytes, string values at least that long are kept LZF compressed, 0 means never
+
+    /// tiered storage: the coldest string values are moved to a value log on disk while the used memory is above
+    /// tiered-max-memory, 0 disables it
+    size_t tiered_max_memory;           /// bytes
+    int tiered_min_value_size;          /// bytes, the smaller values are not worth moving
+    size_t tiered_segment_size;         /// bytes of a segment file of the value log
+    int tiered_compact_percent;         /// a segment is compacted once that share of its bytes is dead
+
+    int hotkeys_sample_rate;            /// one key access in that many is recorded by HotKeys, 0 disables the tracking
+    int hotkeys_top_k;                  /// hottest keys kept by HotKeys
+
+    /// a hash is kept as a listpack while it has at most hash-max-listpack-entries fields, and no field or value longer
+    /// than hash-max-listpack-value bytes, and converted to a hashtable past them
+    int hash_max_listpack_entries;
+    int hash_max_listpack_value;        /// bytes
+
+    /// the size of a node of a list: a positive number of elements, or -1 to -5 for 4 KB to 64 KB
+    int list_max_listpack_size;
+    /// the nodes of a list farther than that from both ends are LZF compressed, 0 disables the compression
+    int list_compress_depth;
+
+    /// a set of integers is kept as an intset while it has at most that many members, and converted to a hashtable
+    /// past it
+    int set_max_intset_entries;
+
+    /// the keys, bytes and operations are accounted per key prefix, the part of a key before its first delimiter.
+    /// Empty disables the accounting
+    std::string keyspace_stats_delimiter;
+
     RedisConfig() : port(DEFAULT_REDIS_PORT), is_replica(0), dir_path("./"),
-                    dbfilename("dump.rdb") {} // Default port is 6379
+                    dbfilename("dump.rdb"), lazyfree_lazy_expire(true), lazyfree_lazy_server_del(true),
+                    lazyfree_lazy_user_del(true), lazyfree_lazy_user_flush(true),
+                    replica_lazy_flush(true), lazyfree_lazy_eviction(true), maxmemory(0),
+                    maxmemory_policy(MaxMemoryNoEviction), maxmemory_samples(5), lfu_log_factor(10),
+                    lfu_decay_time(1), key_index(false),
+                    databases(DEFAULT_DATABASES), string_compression_threshold(0), tiered_max_memory(0),
+                    tiered_min_value_size(512), tiered_segment_size(64 * 1024 * 1024),
+                    tiered_compact_percent(50), hotkeys_sample_rate(16), hotkeys_top_k(16),
+                    hash_max_listpack_entries(128), hash_max_listpack_value(64),
+                    list_max_listpack_size(-2), list_compress_depth(0), set_max_intset_entries(512) {} // Default port is 6379
 } RedisConfig;
 
 typedef struct RedisOptionDef {
@@ -0,0 +1,55 @@
+//
+// Created by Manh Nguyen Viet on 9/2/25.
+//
+
+#include "RespWriter.h"
+
+#include <charconv>
+
+/// build "<prefix><i>\r\n" for every i in [0, N) at compile time
+template<size_t N>
+static constexpr std::array<SharedReply, N> BuildSharedReplies(const char prefix) {
+    std::array<SharedReply, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        char digits[8] = {0};
+        size_t num_digits = 0;
+        size_t v = i;
+        do {
+            digits[num_digits++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+
+        auto &entry = table[i];
+        size_t pos = 0;
+        entry.data[pos++] = prefix;
+        while (num_digits > 0) {
+            entry.data[pos++] = digits[--num_digits];
+        }
+        entry.data[pos++] = '\r';
+        entry.data[pos++] = '\n';
+        entry.len = static_cast<uint8_t>(pos);
+    }
+    return table;
+}
+
+constexpr std::array<SharedReply, SHARED_INTEGERS> shared_integers = BuildSharedReplies<SHARED_INTEGERS>(':');
+constexpr std::array<SharedReply, SHARED_HEADERS> shared_bulk_headers = BuildSharedReplies<SHARED_HEADERS>('$');
+constexpr std::array<SharedReply, SHARED_HEADERS> shared_array_headers = BuildSharedReplies<SHARED_HEADERS>('*');
+
+void RespWriter::AppendPrefixedNumber(const char prefix, const int64_t n) {
+    char buf[24];
+    buf[0] = prefix;
+    auto [end, ec] = std::to_chars(buf + 1, buf + sizeof(buf) - 2, n);
+    *end++ = '\r';
+    *end++ = '\n';
+    out_.append(buf, end - buf);
+}
+
+RespWriter &RespWriter::AppendEntryId(const RdbParser::EntryID &entry_id) {
+    /// max length of "<int64>-<int64>" is 41 bytes, so the header always comes from the shared table
+    char buf[48];
+    auto [mid, ec1] = std::to_chars(buf, buf + sizeof(buf), entry_id.timestamp);
+    *mid++ = '-';
+    auto [end, ec2] = std::to_chars(mid, buf + sizeof(buf), entry_id.sequence_number);
+    return AppendBulkStr(std::string_view(buf, end - buf));
+}
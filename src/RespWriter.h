@@ -0,0 +1,128 @@
+//
+// Created by Manh Nguyen Viet on 9/2/25.
+//
+
+#ifndef REDIS_CRAFT_RESPWRITER_H
+#define REDIS_CRAFT_RESPWRITER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rdbparse.h"
+
+/// number of entries in the shared integer table, serves ":0\r\n" .. ":9999\r\n"
+#define SHARED_INTEGERS 10000
+/// number of entries in the shared header tables, serves "$0\r\n" .. "$1023\r\n" and "*0\r\n" .. "*1023\r\n"
+#define SHARED_HEADERS 1024
+
+/// a precomputed reply fragment, at most 8 bytes
+typedef struct SharedReply {
+    char data[8];
+    uint8_t len;
+} SharedReply;
+
+extern const std::array<SharedReply, SHARED_INTEGERS> shared_integers;
+extern const std::array<SharedReply, SHARED_HEADERS> shared_bulk_headers;
+extern const std::array<SharedReply, SHARED_HEADERS> shared_array_headers;
+
+/*
+ * Streaming RESP encoder. Every Append* writes the header and the payload straight to the end of @out,
+ * so a reply of any depth is encoded in one pass without temporary strings.
+ * */
+class RespWriter {
+public:
+    explicit RespWriter(std::string &out) : out_(out) {}
+
+    RespWriter &AppendArrayHeader(size_t n) {
+        AppendHeader('*', n, shared_array_headers);
+        return *this;
+    }
+
+    RespWriter &AppendBulkStr(std::string_view s) {
+        AppendHeader('$', s.size(), shared_bulk_headers);
+        out_.append(s);
+        out_.append(CRLF_, 2);
+        return *this;
+    }
+
+    RespWriter &AppendSimpleStr(std::string_view s) {
+        out_.push_back('+');
+        out_.append(s);
+        out_.append(CRLF_, 2);
+        return *this;
+    }
+
+    /// @msg is the error without the leading '-', e.g "ERR syntax error"
+    RespWriter &AppendError(std::string_view msg) {
+        out_.push_back('-');
+        out_.append(msg);
+        out_.append(CRLF_, 2);
+        return *this;
+    }
+
+    RespWriter &AppendInteger(int64_t n) {
+        if (n >= 0 && n < SHARED_INTEGERS) {
+            auto &shared = shared_integers[n];
+            out_.append(shared.data, shared.len);
+        } else {
+            AppendPrefixedNumber(':', n);
+        }
+        return *this;
+    }
+
+    RespWriter &AppendNil() {
+        out_.append("$-1\r\n", 5);
+        return *this;
+    }
+
+    RespWriter &AppendNilArray() {
+        out_.append("*-1\r\n", 5);
+        return *this;
+    }
+
+    RespWriter &AppendOk() {
+        out_.append("+OK\r\n", 5);
+        return *this;
+    }
+
+    /// stream entry id as a bulk string "<timestamp>-<sequence_number>"
+    RespWriter &AppendEntryId(const RdbParser::EntryID &entry_id);
+
+    /// array of bulk strings, the wire format of a command
+    RespWriter &AppendCommand(const std::vector<std::string> &argv) {
+        AppendArrayHeader(argv.size());
+        for (auto &arg: argv) {
+            AppendBulkStr(arg);
+        }
+        return *this;
+    }
+
+    /// append already-encoded RESP data
+    RespWriter &AppendRaw(std::string_view raw) {
+        out_.append(raw);
+        return *this;
+    }
+
+    std::string &Buffer() { return out_; }
+
+private:
+    void AppendHeader(char prefix, size_t n, const std::array<SharedReply, SHARED_HEADERS> &table) {
+        if (n < SHARED_HEADERS) {
+            auto &shared = table[n];
+            out_.append(shared.data, shared.len);
+        } else {
+            AppendPrefixedNumber(prefix, static_cast<int64_t>(n));
+        }
+    }
+
+    void AppendPrefixedNumber(char prefix, int64_t n);
+
+    static constexpr char CRLF_[] = "\r\n";
+
+    std::string &out_;
+};
+
+#endif //REDIS_CRAFT_RESPWRITER_H
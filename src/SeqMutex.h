@@ -0,0 +1,63 @@
+//
+// Created by Manh Nguyen Viet on 9/20/25.
+//
+
+#ifndef REDIS_CRAFT_SEQMUTEX_H
+#define REDIS_CRAFT_SEQMUTEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * A mutex that also counts its critical sections, so that readers can go without taking it (a seqlock).
+ *
+ * The count is odd while the mutex is held. A reader notes it with ReadBegin(), reads, and keeps what it read only if
+ * Validate() finds the count unchanged: no writer ran in between, so the reads form a consistent snapshot. Until then
+ * the reader may see torn or stale data, so it only follows a pointer it read after a Validate() confirmed it, and the
+ * memory behind such a pointer must outlive the reader even if a writer unlinks it right after (see Epoch).
+ *
+ * Writers use it like any mutex, std::lock_guard and std::unique_lock included.
+ * */
+class SeqMutex {
+public:
+    void lock() {
+        m_.lock();
+        BeginWrite();
+    }
+
+    bool try_lock() {
+        if (!m_.try_lock())
+            return false;
+        BeginWrite();
+        return true;
+    }
+
+    void unlock() {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_.unlock();
+    }
+
+    /// the count to validate the reads against, see IsWriting()
+    uint64_t ReadBegin() const { return seq_.load(std::memory_order_acquire); }
+
+    /// a writer held the mutex when @param seq was read, nothing read under it can be trusted
+    static bool IsWriting(uint64_t seq) { return seq & 1; }
+
+    /// whether no writer ran since ReadBegin() returned @param seq
+    bool Validate(uint64_t seq) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq_.load(std::memory_order_relaxed) == seq;
+    }
+
+private:
+    void BeginWrite() {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    std::mutex m_;
+    std::atomic<uint64_t> seq_{0};
+};
+
+#endif //REDIS_CRAFT_SEQMUTEX_H
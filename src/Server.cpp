@@ -6,6 +6,10 @@
 #include "CommandExecutor.h"
 #include "Utils.h"
 #include "RedisError.h"
+#include "Epoch.h"
+#include "HotKeys.h"
+#include "LazyFree.h"
+#include "Zmalloc.h"
 #include "Utils.h"
 
 #include <arpa/inet.h>
@@ -19,7 +23,9 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -37,7 +43,8 @@ Server::Server(asio::io_context &io_context) : acceptor_(io_context, tcp::endpoi
                                                io_context_(io_context),
                                                replica_socket_(io_context),
                                                signal_(io_context, SIGCHLD),
-                                               timer_(io_context), heartbeat_retry_(0) {
+                                               timer_(io_context), cron_timer_(io_context),
+                                               blocked_clients_(io_context), heartbeat_retry_(0) {
 }
 
 Server *Server::GetInstance() {
@@ -56,10 +63,38 @@ Server::~Server() {
 
 void Server::OnReady() {
     LOG_LINE();
+    size_t used = ZmallocUsedMemory();
+    startup_memory_ = (used > loaded_memory_) ? used - loaded_memory_ : 0;
+
     CheckChildrenDone();
+    ServerCron();
     DoAccept();
 }
 
+void Server::ServerCron() {
+    ZmallocUpdatePeak();
+
+    /// reclaim the expired keys nobody reads anymore
+    Database::GetInstance()->ActiveExpireCycle(CRON_EXPIRE_MS);
+
+    /// finish resizing the keyspace even when no command touches it
+    Database::GetInstance()->ActiveRehash(CRON_REHASH_MS);
+
+    /// move the cold values to the value log, then reclaim its dead records
+    Database::GetInstance()->SpillColdValues(CRON_SPILL_MS);
+    Database::GetInstance()->CompactValueLog(CRON_COMPACT_MS);
+
+    /// free what was retired while lock-free readers were running
+    Epoch::Reclaim();
+
+    cron_timer_.expires_after(std::chrono::milliseconds(CRON_INTERVAL_MS));
+    cron_timer_.async_wait([this](const std::error_code &ec) {
+        if (!ec) {
+            ServerCron();
+        }
+    });
+}
+
 int Server::StartMaster() {
 
     OnReady();
@@ -77,9 +112,12 @@ int Server::StartReplica() {
 }
 
 void Server::SetConfig(RedisConfig *cfg) {
+    cfg_ = cfg;
     if (cfg) {
         /// TODO: add more config properties belong to network???
 
+        HotKeys::GetInstance()->Configure(cfg->hotkeys_sample_rate, cfg->hotkeys_top_k);
+
         if (cfg->is_replica) {
             replication_info_.role = ReplicationRole::Slave;
 
@@ -108,6 +146,124 @@ std::string Server::ShowReplicationInfo() const {
     return ss.str();
 }
 
+/// @param bytes as the used_memory_human of Redis, e.g 1.50M
+static std::string BytesToHuman(size_t bytes) {
+    static const char units[] = "BKMGTP";
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < sizeof(units) - 1) {
+        value /= 1024;
+        ++unit;
+    }
+
+    char buf[32];
+    if (unit == 0) {
+        snprintf(buf, sizeof(buf), "%zuB", bytes);
+    } else {
+        snprintf(buf, sizeof(buf), "%.2f%c", value, units[unit]);
+    }
+    return buf;
+}
+
+size_t Server::SlavesOutputBufferSize() const {
+    size_t bytes = 0;
+    for (auto &client: clients_) {
+        if (client->ClientType() & TypeSlave)
+            bytes += client->OutputBufferSize();
+    }
+    return bytes;
+}
+
+MemoryOverhead Server::GetMemoryOverhead() const {
+    ZmallocUpdatePeak();
+
+    MemoryOverhead mem;
+    mem.total = ZmallocUsedMemory();
+    mem.peak = ZmallocPeakMemory();
+    mem.startup = startup_memory_;
+    mem.repl_backlog = ReplicationBufferSize();
+    for (auto &client: clients_) {
+        /// the client itself embeds its fixed read and write buffers
+        size_t bytes = ZmallocSizeFor(sizeof(Client)) + client->OutputBufferSize();
+        if (client->ClientType() & TypeSlave) {
+            mem.clients_slaves += bytes;
+        } else {
+            mem.clients_normal += bytes;
+        }
+        mem.query_buffers += client->QueryBufferSize();
+    }
+    mem.key_index = KeyIndex::NodeMemory();
+
+    mem.overhead = mem.startup + mem.repl_backlog + mem.clients_slaves + mem.clients_normal + mem.query_buffers +
+                   mem.key_index;
+    auto db = Database::GetInstance();
+    for (int i = 0; i < db->Databases(); ++i) {
+        KeyspaceMemory keyspace = db->GetKeyspaceMemory(i);
+        mem.overhead += keyspace.hashtable_bytes + keyspace.expires_bytes;
+        if (keyspace.keys > 0)
+            mem.dbs.emplace_back(i, keyspace);
+    }
+
+    mem.dataset = (mem.total > mem.overhead) ? mem.total - mem.overhead : 0;
+    return mem;
+}
+
+std::string Server::ShowMemoryInfo() const {
+    MemoryOverhead mem = GetMemoryOverhead();
+    size_t rss = ZmallocRss();
+    size_t maxmemory = cfg_ ? cfg_->maxmemory : 0;
+    auto percent = [](size_t part, size_t whole) {
+        return (whole > 0) ? static_cast<double>(part) * 100 / static_cast<double>(whole) : 0.0;
+    };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "used_memory:" << mem.total << CRLF;
+    ss << "used_memory_human:" << BytesToHuman(mem.total) << CRLF;
+    ss << "used_memory_rss:" << rss << CRLF;
+    ss << "used_memory_rss_human:" << BytesToHuman(rss) << CRLF;
+    ss << "used_memory_peak:" << mem.peak << CRLF;
+    ss << "used_memory_peak_human:" << BytesToHuman(mem.peak) << CRLF;
+    ss << "used_memory_peak_perc:" << percent(mem.total, mem.peak) << "%" << CRLF;
+    ss << "used_memory_overhead:" << mem.overhead << CRLF;
+    ss << "used_memory_startup:" << mem.startup << CRLF;
+    ss << "used_memory_dataset:" << mem.dataset << CRLF;
+    ss << "used_memory_dataset_perc:"
+       << percent(mem.dataset, (mem.total > mem.startup) ? mem.total - mem.startup : 0) << "%" << CRLF;
+    ss << "maxmemory:" << maxmemory << CRLF;
+    ss << "maxmemory_human:" << BytesToHuman(maxmemory) << CRLF;
+    ss << "maxmemory_policy:" << MaxMemoryPolicyName(cfg_ ? cfg_->maxmemory_policy : MaxMemoryNoEviction) << CRLF;
+    ss << "mem_fragmentation_ratio:" << ((mem.total > 0) ? static_cast<double>(rss) / mem.total : 0.0) << CRLF;
+    ss << "mem_replication_backlog:" << mem.repl_backlog << CRLF;
+    ss << "mem_clients_slaves:" << mem.clients_slaves << CRLF;
+    ss << "mem_clients_normal:" << mem.clients_normal << CRLF;
+    ss << "mem_query_buffers:" << mem.query_buffers << CRLF;
+    ss << "mem_key_index:" << mem.key_index << CRLF;
+    ss << "lazyfree_pending_objects:" << LazyFree::GetInstance()->Pending() << CRLF;
+    ss << "evicted_keys:" << Database::GetInstance()->EvictedKeys() << CRLF;
+    ss << "tiered_spilled_values:" << Database::GetInstance()->SpilledValues() << CRLF;
+    ss << "tiered_loaded_values:" << Database::GetInstance()->LoadedValues() << CRLF;
+    ss << "tiered_log_bytes:" << ValueLog::GetInstance()->DiskBytes() << CRLF;
+    ss << "tiered_log_live_bytes:" << ValueLog::GetInstance()->LiveBytes() << CRLF;
+    ss << "tiered_log_segments:" << ValueLog::GetInstance()->Segments() << CRLF;
+
+    return ss.str();
+}
+
+std::string Server::ShowHotKeysInfo() const {
+    auto hot_keys = HotKeys::GetInstance();
+    std::stringstream ss;
+    ss << "hotkeys_sample_rate:" << hot_keys->SampleRate() << CRLF;
+    ss << "hotkeys_sampled:" << hot_keys->Sampled() << CRLF;
+    int rank = 0;
+    for (auto &[key, accesses]: hot_keys->Top(HOTKEYS_MAX_TOP_K, false)) {
+        ss << "hotkey" << rank++ << ":key=" << key << ",accesses=" << accesses
+           << ",writes=" << hot_keys->EstimateWrites(key) << CRLF;
+    }
+
+    return ss.str();
+}
+
 int Server::Setup() {
     /// 0. setup commands
     SetupCommands();
@@ -226,6 +382,9 @@ void Server::FullSyncRdbToReplica(const std::shared_ptr<Client> &slave) {
     std::string rdb_file_path = Database::GetInstance()->GetRdbPath();
 
     slave->PropagateRdb(rdb_file_path);;
+
+    /// the new replica does not know the database of the stream yet
+    repl_seldb_ = -1;
 }
 
 RedisCmd *Server::GetRedisCommand(const std::string &cmd_name) {
@@ -236,14 +395,18 @@ RedisCmd *Server::GetRedisCommand(const std::string &cmd_name) {
     }
 }
 
-void Server::AddCommand(const std::string &command, CommandType type, uint64_t flag) {
+void Server::AddCommand(const std::string &command, CommandType type, uint64_t flag, int first_key, int last_key,
+                        int key_step) {
     try {
         auto rcmd = global_commands_.at(command);
         rcmd->cmd_type = type;
         rcmd->flags |= flag;
+        rcmd->first_key = first_key;
+        rcmd->last_key = last_key;
+        rcmd->key_step = key_step;
     }
     catch (std::exception &ex) {
-        global_commands_[command] = new RedisCmd(type, flag);
+        global_commands_[command] = new RedisCmd(type, flag, first_key, last_key, key_step);
     }
 }
 
@@ -265,8 +428,8 @@ int Server::SetupCommands() {
 
     AddCommand("echo", EchoCmd, 0);
 
-    AddCommand("get", GetCmd, READ_CMD);
-    AddCommand("set", SetCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD);
+    AddCommand("get", GetCmd, READ_CMD, 1, 1, 1);
+    AddCommand("set", SetCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
 
     AddCommand("ping", PingCmd, MASTER_SEND | SLAVE_RECV);
 
@@ -285,10 +448,88 @@ int Server::SetupCommands() {
 
     AddCommand("wait", WaitCmd, READ_CMD);
 
-    AddCommand("type", TypeCmd, READ_CMD);
-    AddCommand("xadd", XAddCmd, READ_CMD);
-
-    AddCommand("xrange", XRangeCmd, READ_CMD);
+    AddCommand("type", TypeCmd, READ_CMD, 1, 1, 1);
+    AddCommand("xadd", XAddCmd, READ_CMD | DENYOOM_CMD, 1, 1, 1);
+
+    AddCommand("xrange", XRangeCmd, READ_CMD, 1, 1, 1);
+
+    AddCommand("incr", IncrCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("decr", DecrCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("incrby", IncrByCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("decrby", DecrByCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("incrbyfloat", IncrByFloatCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+
+    AddCommand("del", DelCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, -1, 1);
+    AddCommand("expire", ExpireCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("pexpire", PExpireCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("expireat", ExpireAtCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("pexpireat", PExpireAtCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("persist", PersistCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("ttl", TtlCmd, READ_CMD, 1, 1, 1);
+    AddCommand("pttl", PTtlCmd, READ_CMD, 1, 1, 1);
+
+    AddCommand("unlink", UnlinkCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, -1, 1);
+    AddCommand("flushall", FlushAllCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD);
+    AddCommand("flushdb", FlushDbCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD);
+
+    AddCommand("scan", ScanCmd, READ_CMD);
+    AddCommand("hscan", HScanCmd, READ_CMD, 1, 1, 1);
+    AddCommand("sscan", SScanCmd, READ_CMD, 1, 1, 1);
+    AddCommand("zscan", ZScanCmd, READ_CMD, 1, 1, 1);
+    AddCommand("prefixcount", PrefixCountCmd, READ_CMD);
+
+    AddCommand("select", SelectCmd, READ_CMD);
+    AddCommand("move", MoveCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("swapdb", SwapDbCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD);
+
+    AddCommand("mget", MGetCmd, READ_CMD, 1, -1, 1);
+    AddCommand("mset", MSetCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, -1, 2);
+    AddCommand("msetnx", MSetNxCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, -1, 2);
+
+    AddCommand("memory", "usage", MemoryUsageCmd, READ_CMD);
+    AddCommand("memory", "stats", MemoryStatsCmd, READ_CMD);
+
+    AddCommand("hotkeys", HotKeysCmd, READ_CMD);
+    AddCommand("keyspace-stats", KeyspaceStatsCmd, READ_CMD);
+
+    AddCommand("multi", MultiCmd, MULTI_CMD);
+    AddCommand("exec", ExecCmd, MULTI_CMD);
+    AddCommand("discard", DiscardCmd, MULTI_CMD);
+    AddCommand("watch", WatchCmd, READ_CMD | MULTI_CMD, 1, -1, 1);
+    AddCommand("unwatch", UnwatchCmd, MULTI_CMD);
+
+    AddCommand("hset", HSetCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("hget", HGetCmd, READ_CMD, 1, 1, 1);
+    AddCommand("hmget", HMGetCmd, READ_CMD, 1, 1, 1);
+    AddCommand("hgetall", HGetAllCmd, READ_CMD, 1, 1, 1);
+    AddCommand("hdel", HDelCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("hincrby", HIncrByCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("hlen", HLenCmd, READ_CMD, 1, 1, 1);
+    AddCommand("hexists", HExistsCmd, READ_CMD, 1, 1, 1);
+
+    AddCommand("lpush", LPushCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("rpush", RPushCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("lpop", LPopCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("rpop", RPopCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("lrange", LRangeCmd, READ_CMD, 1, 1, 1);
+    AddCommand("lindex", LIndexCmd, READ_CMD, 1, 1, 1);
+    AddCommand("llen", LLenCmd, READ_CMD, 1, 1, 1);
+    AddCommand("ltrim", LTrimCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("lmove", LMoveCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 2, 1);
+    AddCommand("blpop", BLPopCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, -2, 1);
+    AddCommand("brpop", BRPopCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, -2, 1);
+    AddCommand("blmove", BLMoveCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 2, 1);
+
+    AddCommand("sadd", SAddCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD | DENYOOM_CMD, 1, 1, 1);
+    AddCommand("srem", SRemCmd, MASTER_SEND | SLAVE_RECV | WRITE_CMD | REPL_CMD, 1, 1, 1);
+    AddCommand("sismember", SIsMemberCmd, READ_CMD, 1, 1, 1);
+    AddCommand("smismember", SMIsMemberCmd, READ_CMD, 1, 1, 1);
+    AddCommand("smembers", SMembersCmd, READ_CMD, 1, 1, 1);
+    AddCommand("scard", SCardCmd, READ_CMD, 1, 1, 1);
+    AddCommand("sinter", SInterCmd, READ_CMD, 1, -1, 1);
+    AddCommand("sintercard", SInterCardCmd, READ_CMD, 2, -1, 1);
+    AddCommand("sunion", SUnionCmd, READ_CMD, 1, -1, 1);
+    AddCommand("sdiff", SDiffCmd, READ_CMD, 1, -1, 1);
 
     return 0;
 }
@@ -424,6 +665,44 @@ ssize_t Server::SaveRdbBackground(const std::string &file_name) {
     return 0;
 }
 
+void Server::PropagateToSlaves(const std::string &resp_data) {
+    LOG_DEBUG(TAG, "There are %lu clients of this server", clients_.size());
+    for (const auto &cli: clients_) {
+        if (cli->ClientType() == ClientType::TypeSlave) {
+            /// FIXME: handle case copy the resp_data to output buffer fail
+            LOG_DEBUG(TAG, "Propagate command %s through sock %d", resp_data.c_str(),
+                      cli->Socket().native_handle());
+            cli->WriteAsync(resp_data, MASTER_SEND | SLAVE_RECV);
+        }
+    }
+}
+
+void Server::PropagateCommand(const std::vector<std::string> &argv) {
+    /// a replica never generates commands, it applies the ones of its master
+    if (replication_info_.is_replica)
+        return;
+
+    PropagateSelectDb(Database::SelectedDb());
+
+    std::string resp_data;
+    RespWriter(resp_data).AppendCommand(argv);
+
+    AddBackLogBuffer(resp_data);
+    PropagateToSlaves(resp_data);
+}
+
+void Server::PropagateSelectDb(int db) {
+    if (db == repl_seldb_)
+        return;
+
+    std::string resp_data;
+    RespWriter(resp_data).AppendCommand({"SELECT", std::to_string(db)});
+
+    AddBackLogBuffer(resp_data);
+    PropagateToSlaves(resp_data);
+    repl_seldb_ = db;
+}
+
 void Server::AddBackLogBuffer(const std::string &data) {
     if (replication_info_.is_replica) {
         LOG_DEBUG(TAG, "Add %zu bytes to backlog buffer, but this server is a replica, ignore", data.size());
@@ -16,7 +16,9 @@
 #include "CommandExecutor.h"
 #include "RedisDef.h"
 #include "Client.h"
+#include "BlockedClients.h"
 #include "CircularBuffer.h"
+#include "Database.h"
 
 #if ASIO_LIB
 
@@ -67,6 +69,21 @@ typedef struct ReplicationInfo {
     }
 } ReplicationInfo;
 
+/// where the memory goes, for INFO memory and MEMORY STATS
+typedef struct MemoryOverhead {
+    size_t total = 0;           /// ZmallocUsedMemory()
+    size_t peak = 0;
+    size_t startup = 0;         /// allocated by the empty server
+    size_t repl_backlog = 0;
+    size_t clients_slaves = 0;  /// the replicas and their output buffers
+    size_t clients_normal = 0;  /// the other clients and their output buffers
+    size_t query_buffers = 0;   /// query buffers and decoded batches of all the clients
+    size_t key_index = 0;       /// nodes of the key indexes
+    std::vector<std::pair<int, KeyspaceMemory>> dbs;    /// the databases holding keys
+    size_t overhead = 0;        /// all of the above but total and peak, plus the hash tables and expire indexes
+    size_t dataset = 0;         /// total - overhead
+} MemoryOverhead;
+
 class Server {
 private:
     static Server *instance_;
@@ -94,10 +111,17 @@ private:
     tcp::socket replica_socket_;        /// <replica only>: socket in the replica server connect to the master
     asio::signal_set signal_;           /// use to check the changing state of child process
     asio::steady_timer timer_;          /// use for periodical action (like heartbeat mechanism)
+    asio::steady_timer cron_timer_;     /// drive ServerCron every CRON_INTERVAL_MS
+    BlockedClients blocked_clients_;    /// the clients waiting in BLPOP, BRPOP and BLMOVE
     int heartbeat_retry_;
 
     CircularBuffer backlog_;
 
+    int repl_seldb_ = -1;   /// database of the last command written to the replication stream, -1 to force a SELECT
+    size_t startup_memory_ = 0;     /// allocated when the server got ready, the dataset loaded at startup excluded
+    size_t loaded_memory_ = 0;      /// taken by the dataset loaded at startup
+    RedisConfig *cfg_ = nullptr;
+
 private:
     Server() = default;
 
@@ -112,11 +136,16 @@ private:
 
     void CheckChildrenDone();
 
+    /// periodic background work of the event loop: incremental rehash, ...
+    void ServerCron();
+
     void OnSaveRdbBackgroundDone(const int exitcode);
 
     void FullSyncRdbToReplica(const std::shared_ptr<Client> &slave);
 
-    void AddCommand(const std::string &command, CommandType type, uint64_t flag);
+    /// @param first_key, last_key, key_step: positions of keys in argv, see RedisCmd
+    void AddCommand(const std::string &command, CommandType type, uint64_t flag, int first_key = 0, int last_key = 0,
+                    int key_step = 0);
 
     void AddCommand(const std::string &command, const std::string &subcmd, CommandType type, uint64_t flag);
 
@@ -166,6 +195,8 @@ public:
 
     std::vector<std::shared_ptr<Client>> GetClients() const { return clients_; }
 
+    BlockedClients &GetBlockedClients() { return blocked_clients_; }
+
     RedisCmd *GetRedisCommand(const std::string &cmd_name);
 
     int HandleFullResyncReply(const std::string &reply);
@@ -176,6 +207,33 @@ public:
 
     void AddBackLogBuffer(const std::string &data);
 
+    /// write the RESP encoded @param resp_data to the output buffer of every slave
+    void PropagateToSlaves(const std::string &resp_data);
+
+    /// propagate a command the server generated itself (e.g DEL of an expired key) to the backlog and the slaves
+    void PropagateCommand(const std::vector<std::string> &argv);
+
+    /// write SELECT @param db to the replication stream when the commands that follow apply to another database
+    void PropagateSelectDb(int db);
+
+    bool IsReplica() const { return replication_info_.is_replica; }
+
+    /// memory held by the replication backlog, not counted against maxmemory
+    size_t ReplicationBufferSize() const { return backlog_.data.capacity(); }
+
+    /// memory held by the output buffers of the replicas, not counted against maxmemory either
+    size_t SlavesOutputBufferSize() const;
+
+    void SetLoadedMemory(size_t bytes) { loaded_memory_ = bytes; }
+
+    /// account the used memory per subsystem, walking the clients and the databases
+    MemoryOverhead GetMemoryOverhead() const;
+
+    std::string ShowMemoryInfo() const;
+
+    /// the hottest keys estimated by HotKeys, for INFO hotkeys
+    std::string ShowHotKeysInfo() const;
+
     int64_t GetServerOffset() const {
         if (replication_info_.is_replica) {
             return replication_info_.repl_offset;
@@ -1,38 +1,35 @@
 //
 // Created by Manh Nguyen Viet on 7/21/25.
 //
+#include <algorithm>
 #include <bitset>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 
 #include "Utils.h"
+#include "RespWriter.h"
 #include "all.hpp"
 
-std::string EncodeArr2RespArr(std::vector<std::string> arr) {
+std::string EncodeArr2RespArr(const std::vector<std::string> &arr) {
     std::string resp_str;
-    resp::encoder<std::string> enc;
-    auto encoded_arr = enc.encode_arr(arr);
-    for (auto &encoded: encoded_arr) {
-        resp_str += encoded;
-    }
+    RespWriter(resp_str).AppendCommand(arr);
     return resp_str;
 }
 
-std::string EncodeArr2RespArr2(std::vector<std::string> arr) {
-    resp::encoder<std::string> enc;
-    return enc.encode_array(arr);
-}
-
-std::string EncodeRespSimpleStr(std::string s) {
-    resp::encoder<std::string> enc;
-    std::string resp_str = enc.encode_simple_str(s);
+std::string EncodeRespSimpleStr(const std::string &s) {
+    std::string resp_str;
+    RespWriter(resp_str).AppendSimpleStr(s);
     return resp_str;
 }
 
 std::string EncodeRespBulkStr(const std::string &s) {
-    resp::encoder<std::string> encoder;
-    auto resp_bulk = encoder.encode_bulk_str(s, s.size());
+    std::string resp_bulk;
+    RespWriter(resp_bulk).AppendBulkStr(s);
     return resp_bulk;
 }
 
@@ -42,6 +39,81 @@ void ResetQuery(Query &query) {
     query.cmd_args.clear();
 }
 
+int64_t CurrentTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool StringToInt64(std::string_view s, int64_t &value) {
+    if (s.empty() || s.size() > 20)
+        return false;
+
+    /// reject forms that would not print back to the same string
+    if (s[0] == '0' && s.size() > 1)
+        return false;
+    if (s[0] == '-' && (s.size() == 1 || s[1] == '0'))
+        return false;
+
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+bool StringToLongDouble(std::string_view s, long double &value) {
+    if (s.empty() || s.size() > 5 * 1024 || isspace(static_cast<unsigned char>(s[0])))
+        return false;
+
+    std::string buf(s);
+    char *end = nullptr;
+    errno = 0;
+    value = strtold(buf.c_str(), &end);
+    if (end != buf.c_str() + buf.size() || errno == ERANGE || std::isnan(value))
+        return false;
+
+    return true;
+}
+
+std::string LongDoubleToString(long double value) {
+    /// 17 digits is enough for the precision clients expect. Never in exponent form, as Redis replies it, so the
+    /// trailing zeros of the fraction are dropped by hand. The largest long double still fits the buffer
+    char buf[5 * 1024];
+    int len = snprintf(buf, sizeof(buf), "%.17Lf", value);
+    if (len <= 0 || static_cast<size_t>(len) >= sizeof(buf))
+        return "0";
+
+    if (std::memchr(buf, '.', len)) {
+        while (buf[len - 1] == '0')
+            --len;
+        if (buf[len - 1] == '.')
+            --len;
+    }
+    /// a negative result rounded to zero
+    if (len == 2 && buf[0] == '-' && buf[1] == '0')
+        return "0";
+    return {buf, static_cast<size_t>(len)};
+}
+
+std::string DoubleToString(double value) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    return {buf, static_cast<size_t>(end - buf)};
+}
+
+void GetQueryKeys(const Query &query, std::vector<std::string_view> &keys) {
+    if (!query.cmd || query.cmd->first_key <= 0)
+        return;
+
+    int argc = static_cast<int>(query.cmd_args.size());
+    int last = (query.cmd->last_key < 0) ? argc + query.cmd->last_key : query.cmd->last_key;
+    /// the keys of SINTERCARD follow their number
+    int64_t numkeys;
+    if (query.cmd->cmd_type == SInterCardCmd && argc > 1 && StringToInt64(query.cmd_args[1], numkeys))
+        last = static_cast<int>(std::clamp<int64_t>(numkeys + 1, 0, argc - 1));
+    int step = (query.cmd->key_step > 0) ? query.cmd->key_step : 1;
+    for (int i = query.cmd->first_key; i <= last && i < argc; i += step) {
+        keys.emplace_back(query.cmd_args[i]);
+    }
+}
+
 int RdbStat(const std::string &file_name, struct stat &st) {
     if (stat(file_name.c_str(), &st) == 0) {
         return 0;
@@ -132,8 +204,8 @@ void showBinFile(const std::string &filename) {
     infile.close();
 }
 
-std::string EncodeRespInteger(const int n) {
-    resp::encoder<std::string> enc;
-    std::string resp_str = enc.encode_integer(std::to_string(n));
+std::string EncodeRespInteger(const int64_t n) {
+    std::string resp_str;
+    RespWriter(resp_str).AppendInteger(n);
     return resp_str;
-}
\ No newline at end of file
+}
@@ -13,6 +13,8 @@
 
 #define CRLF "\r\n"
 #define DEFAULT_REDIS_PORT 6379
+#define DEFAULT_DATABASES 16
+#define MAX_DATABASES 1024
 
 #define DEFAULT_MASTER_REPLID "8371b4fb1155b71f4a04d3e1bc3e18c4a990aeeb"
 #define MASTER_ID_LENGTH 40
@@ -29,6 +31,8 @@
 #define WRITE_CMD   (1<<5)
 #define READ_CMD    (1<<6)
 #define REPL_CMD    (1<<7)
+#define DENYOOM_CMD (1<<8)      /// may grow the dataset, refused when the used memory is over maxmemory
+#define MULTI_CMD   (1<<9)      /// controls a transaction, executed at once rather than queued after MULTI
 
 
 enum CommandType {
@@ -50,6 +54,72 @@ enum CommandType {
     TypeCmd,
     XAddCmd,
     XRangeCmd,
+    IncrCmd,
+    DecrCmd,
+    IncrByCmd,
+    DecrByCmd,
+    IncrByFloatCmd,
+    DelCmd,
+    ExpireCmd,
+    PExpireCmd,
+    ExpireAtCmd,
+    PExpireAtCmd,
+    PersistCmd,
+    TtlCmd,
+    PTtlCmd,
+    UnlinkCmd,
+    FlushAllCmd,
+    FlushDbCmd,
+    ScanCmd,
+    HScanCmd,
+    SScanCmd,
+    ZScanCmd,
+    PrefixCountCmd,
+    SelectCmd,
+    MoveCmd,
+    SwapDbCmd,
+    MGetCmd,
+    MSetCmd,
+    MSetNxCmd,
+    MemoryUsageCmd,
+    MemoryStatsCmd,
+    HotKeysCmd,
+    KeyspaceStatsCmd,
+    MultiCmd,
+    ExecCmd,
+    DiscardCmd,
+    WatchCmd,
+    UnwatchCmd,
+    HSetCmd,
+    HGetCmd,
+    HMGetCmd,
+    HGetAllCmd,
+    HDelCmd,
+    HIncrByCmd,
+    HLenCmd,
+    HExistsCmd,
+    LPushCmd,
+    RPushCmd,
+    LPopCmd,
+    RPopCmd,
+    LRangeCmd,
+    LIndexCmd,
+    LLenCmd,
+    LTrimCmd,
+    LMoveCmd,
+    BLPopCmd,
+    BRPopCmd,
+    BLMoveCmd,
+    SAddCmd,
+    SRemCmd,
+    SIsMemberCmd,
+    SMIsMemberCmd,
+    SMembersCmd,
+    SCardCmd,
+    SInterCmd,
+    SInterCardCmd,
+    SUnionCmd,
+    SDiffCmd,
     UnknownCmd
 };
 
@@ -58,30 +128,52 @@ typedef struct RedisCmd {
     uint64_t flags;
     std::unordered_map<std::string, RedisCmd *> subcmd_dict;
 
-    explicit RedisCmd(CommandType type, uint64_t flag) : cmd_type(type), flags(flag) {}
+    /// key positions in argv: first key, last key (negative counts from the end), step. first_key == 0 means no key
+    int first_key;
+    int last_key;
+    int key_step;
+
+    explicit RedisCmd(CommandType type, uint64_t flag, int first = 0, int last = 0, int step = 0) :
+            cmd_type(type), flags(flag), first_key(first), last_key(last), key_step(step) {}
 } RedisCmd;
 
 typedef struct Query {
     RedisCmd *cmd;    /// point to the global cmd
     uint64_t flags;   /// flag of cmd, like MASTER_SEND, SLAVE_REVC, etc ...
-    std::vector<std::string> cmd_args;      /// the list argv for execution
+    std::vector<std::string> cmd_args;      /// the list argv for execution. The executor may rewrite it into the
+                                            /// form that is propagated, e.g. INCRBYFLOAT becomes SET ... KEEPTTL
 } Query;
 
 /// input: array of strings. Output: a string presents RESP Array
-std::string EncodeArr2RespArr(std::vector<std::string> arr);
-
-/// Input: array of strings. Each element in the input array must be in RESP format.
-/// Output: a string presents RESP Array
-std::string EncodeArr2RespArr2(std::vector<std::string> arr);
+std::string EncodeArr2RespArr(const std::vector<std::string> &arr);
 
-std::string EncodeRespSimpleStr(std::string s);
+std::string EncodeRespSimpleStr(const std::string &s);
 
 std::string EncodeRespBulkStr(const std::string &s);
 
-std::string EncodeRespInteger(const int n);
+std::string EncodeRespInteger(int64_t n);
 
 void ResetQuery(Query &query);
 
+/// current unix time in milliseconds
+int64_t CurrentTimeMs();
+
+/// strict conversion like string2ll() of Redis: no spaces, no '+', no leading zeros, fits in int64_t
+bool StringToInt64(std::string_view s, int64_t &value);
+
+/// convert @param s to long double, the whole string must be a number without spaces. Infinities are accepted as
+/// Redis does, NaN is not
+bool StringToLongDouble(std::string_view s, long double &value);
+
+/// human friendly format of a long double, used by INCRBYFLOAT
+std::string LongDoubleToString(long double value);
+
+/// shortest representation that parses back to the same @param value, as scores are replied
+std::string DoubleToString(double value);
+
+/// collect the keys of @param query into @param keys, following the key spec of its command
+void GetQueryKeys(const Query &query, std::vector<std::string_view> &keys);
+
 int RdbStat(const std::string &file_name, struct stat &st);
 
 std::string RdbHex2Bin(const std::string &hex);
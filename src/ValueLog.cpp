@@ -0,0 +1,251 @@
+//
+// Created by Manh Nguyen Viet on 9/19/25.
+//
+
+#include "ValueLog.h"
+#include "RedisDef.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+ValueLog::Segment::~Segment() {
+    if (fd >= 0)
+        close(fd);
+    if (dropped)
+        unlink(path.c_str());
+}
+
+ValueLog *ValueLog::GetInstance() {
+    /// never destroyed, the reader keeps running until the process exits
+    static ValueLog *instance = new ValueLog();
+    return instance;
+}
+
+ValueLog::ValueLog() {
+    worker_ = std::thread(&ValueLog::Run, this);
+    worker_.detach();
+}
+
+bool ValueLog::Open(const std::string &dir, size_t segment_size) {
+    std::lock_guard lock(m_);
+    dir_ = dir;
+    segment_size_ = segment_size;
+
+    std::error_code ec;
+    for (auto &entry: std::filesystem::directory_iterator(dir_, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.starts_with("values.") && name.ends_with(".vlog"))
+            std::filesystem::remove(entry.path(), ec);
+    }
+
+    open_ = Rotate();
+    return open_;
+}
+
+bool ValueLog::Rotate() {
+    auto segment = std::make_shared<Segment>();
+    segment->id = next_id_;
+    segment->path = dir_ + "/values." + std::to_string(next_id_) + ".vlog";
+    segment->fd = ::open(segment->path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment->fd < 0) {
+        LOG_ERROR("ValueLog", "Cannot create segment %s: %s", segment->path.c_str(), strerror(errno));
+        return false;
+    }
+
+    /// Discard() leaves the active segment alone, one whose records all died meanwhile goes now
+    if (active_ && active_->live == 0) {
+        active_->dropped = true;
+        segments_.erase(active_->id);
+    }
+
+    ++next_id_;
+    segments_[segment->id] = segment;
+    active_ = segment;
+    return true;
+}
+
+bool ValueLog::Append(std::string_view key, int encoding, std::string_view payload, uint64_t &location,
+                      uint32_t &len) {
+    std::string record;
+    record.resize(VLOG_RECORD_HEADER);
+    auto key_len = static_cast<uint32_t>(key.size());
+    auto value_len = static_cast<uint32_t>(payload.size());
+    std::memcpy(record.data(), &key_len, sizeof(key_len));
+    std::memcpy(record.data() + sizeof(key_len), &value_len, sizeof(value_len));
+    record[2 * sizeof(uint32_t)] = static_cast<char>(encoding);
+    record.append(key);
+    record.append(payload);
+
+    std::lock_guard lock(m_);
+    if (!open_)
+        return false;
+    if (active_->size > 0 && active_->size + record.size() > segment_size_ && !Rotate())
+        return false;
+
+    size_t offset = active_->size;
+    for (size_t written = 0; written < record.size();) {
+        ssize_t n = pwrite(active_->fd, record.data() + written, record.size() - written,
+                           static_cast<off_t>(offset + written));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("ValueLog", "Write to %s failed: %s", active_->path.c_str(), strerror(errno));
+            return false;
+        }
+        written += n;
+    }
+
+    active_->size += record.size();
+    active_->live += record.size();
+    location = (static_cast<uint64_t>(active_->id) << VLOG_OFFSET_BITS) | offset;
+    len = static_cast<uint32_t>(record.size());
+    return true;
+}
+
+std::shared_ptr<ValueLog::Segment> ValueLog::Find(uint64_t location) const {
+    std::lock_guard lock(m_);
+    auto it = segments_.find(SegmentOf(location));
+    return (it != segments_.end()) ? it->second : nullptr;
+}
+
+bool ValueLog::ReadRecord(const Segment &segment, uint64_t offset, uint32_t len, std::string_view key,
+                          int &encoding, std::string &payload) {
+    std::string record(len, '\0');
+    for (size_t done = 0; done < len;) {
+        ssize_t n = pread(segment.fd, record.data() + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            LOG_ERROR("ValueLog", "Read from %s failed: %s", segment.path.c_str(), n < 0 ? strerror(errno) : "eof");
+            return false;
+        }
+        done += n;
+    }
+
+    uint32_t key_len, value_len;
+    std::memcpy(&key_len, record.data(), sizeof(key_len));
+    std::memcpy(&value_len, record.data() + sizeof(key_len), sizeof(value_len));
+    if (VLOG_RECORD_HEADER + key_len + value_len != len ||
+        std::string_view(record).substr(VLOG_RECORD_HEADER, key_len) != key) {
+        LOG_ERROR("ValueLog", "Corrupted record at %lu of %s", offset, segment.path.c_str());
+        return false;
+    }
+
+    encoding = static_cast<uint8_t>(record[2 * sizeof(uint32_t)]);
+    payload = record.substr(VLOG_RECORD_HEADER + key_len);
+    return true;
+}
+
+bool ValueLog::Read(uint64_t location, uint32_t len, std::string_view key, int &encoding, std::string &payload) {
+    auto segment = Find(location);
+    if (!segment)
+        return false;
+
+    reads_.fetch_add(1, std::memory_order_relaxed);
+    return ReadRecord(*segment, location & VLOG_OFFSET_MASK, len, key, encoding, payload);
+}
+
+void ValueLog::ReadAsync(uint64_t location, uint32_t len, std::string key,
+                         std::function<void(bool, int, std::string &&)> done) {
+    /// the segment stays open until the read is done, even if it is dropped meanwhile
+    auto segment = Find(location);
+    {
+        std::lock_guard lock(jobs_m_);
+        jobs_.emplace_back([this, segment, location, len, key = std::move(key), done = std::move(done)]() {
+            int encoding = 0;
+            std::string payload;
+            bool ok = segment && ReadRecord(*segment, location & VLOG_OFFSET_MASK, len, key, encoding, payload);
+            reads_.fetch_add(1, std::memory_order_relaxed);
+            done(ok, encoding, std::move(payload));
+        });
+    }
+    cv_.notify_one();
+}
+
+void ValueLog::Submit(std::function<void()> job) {
+    {
+        std::lock_guard lock(jobs_m_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void ValueLog::Run() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(jobs_m_);
+            cv_.wait(lock, [this]() { return !jobs_.empty(); });
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job();
+    }
+}
+
+void ValueLog::Discard(uint64_t location, uint32_t len) {
+    std::lock_guard lock(m_);
+    auto it = segments_.find(SegmentOf(location));
+    if (it == segments_.end())
+        return;
+
+    auto &segment = it->second;
+    segment->live -= std::min<size_t>(segment->live, len);
+    /// nothing left to read in a sealed segment
+    if (segment->live == 0 && segment != active_) {
+        segment->dropped = true;
+        segments_.erase(it);
+    }
+}
+
+bool ValueLog::PickCompaction(int dead_percent, uint32_t &segment) {
+    std::lock_guard lock(m_);
+    size_t most_dead = 0;
+    bool found = false;
+    for (auto &[id, seg]: segments_) {
+        if (seg == active_ || seg->size == 0)
+            continue;
+
+        size_t dead = seg->size - seg->live;
+        if (dead * 100 >= seg->size * static_cast<size_t>(dead_percent) && dead > most_dead) {
+            most_dead = dead;
+            segment = id;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void ValueLog::DropDeadSegment(uint32_t segment) {
+    std::lock_guard lock(m_);
+    auto it = segments_.find(segment);
+    if (it == segments_.end() || it->second == active_ || it->second->live > 0)
+        return;
+
+    it->second->dropped = true;
+    segments_.erase(it);
+}
+
+size_t ValueLog::DiskBytes() const {
+    std::lock_guard lock(m_);
+    size_t bytes = 0;
+    for (auto &[id, segment]: segments_)
+        bytes += segment->size;
+    return bytes;
+}
+
+size_t ValueLog::LiveBytes() const {
+    std::lock_guard lock(m_);
+    size_t bytes = 0;
+    for (auto &[id, segment]: segments_)
+        bytes += segment->live;
+    return bytes;
+}
+
+size_t ValueLog::Segments() const {
+    std::lock_guard lock(m_);
+    return segments_.size();
+}
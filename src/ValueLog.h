@@ -0,0 +1,139 @@
+//
+// Created by Manh Nguyen Viet on 9/19/25.
+//
+
+#ifndef REDIS_CRAFT_VALUELOG_H
+#define REDIS_CRAFT_VALUELOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// a location keeps the segment in its top bits and the offset in the segment below, see RedisObject::Spill()
+#define VLOG_OFFSET_BITS 40
+#define VLOG_OFFSET_MASK ((uint64_t(1) << VLOG_OFFSET_BITS) - 1)
+/// key length, value length and encoding of a record
+#define VLOG_RECORD_HEADER (2 * sizeof(uint32_t) + 1)
+
+/*
+ * Append-only log on local disk of the values moved out of memory by the tiered storage.
+ *
+ * The log is a sequence of segment files, values.<id>.vlog in the data directory. Records are only appended to the
+ * active segment, which is sealed and replaced by a new one once it reaches its size. A record is the key length, the
+ * value length, the encoding of the value, the key then the value bytes as RedisObject kept them in memory. The key
+ * lets a read check it got the record it asked for.
+ *
+ * The keyspace keeps a stub per spilled value, holding the location and the length of its record. The log itself
+ * keeps no index, only the live bytes of every segment: a record is dead once its stub is faulted back in, deleted,
+ * overwritten or relocated (see Discard()). A sealed segment whose live bytes drop to 0 is deleted. One with enough
+ * dead bytes is compacted by the owner of the stubs, which copies its live records to the active segment until none
+ * is left.
+ *
+ * Appends and synchronous reads run on the caller thread. ReadAsync() and Submit() run on a background thread, so the
+ * event loop never waits for the disk. A segment stays open until the last read of it completes, even after it was
+ * deleted.
+ * */
+class ValueLog {
+public:
+    ValueLog(const ValueLog &) = delete;
+
+    ValueLog &operator=(const ValueLog &) = delete;
+
+    static ValueLog *GetInstance();
+
+    /// start an empty log in @param dir, with segments sealed at @param segment_size bytes. The segments of a previous
+    /// run are deleted, the stubs pointing at them did not survive the restart. Return false if the log cannot be
+    /// created
+    bool Open(const std::string &dir, size_t segment_size);
+
+    bool IsOpen() const { return open_; }
+
+    /// append the record of @param key holding @param payload of @param encoding. Its location and length are set to
+    /// @param location and @param len. Return false on I/O error
+    bool Append(std::string_view key, int encoding, std::string_view payload, uint64_t &location, uint32_t &len);
+
+    /// read the record at @param location, of @param len bytes, on the calling thread. Return false on I/O error or
+    /// when the record does not belong to @param key
+    bool Read(uint64_t location, uint32_t len, std::string_view key, int &encoding, std::string &payload);
+
+    /// Read() on the background thread, then call @param done(ok, encoding, payload) there
+    void ReadAsync(uint64_t location, uint32_t len, std::string key,
+                   std::function<void(bool, int, std::string &&)> done);
+
+    /// run @param job on the background thread, after the reads and jobs queued before it. The job may call Append()
+    /// and Read()
+    void Submit(std::function<void()> job);
+
+    /// the record at @param location, of @param len bytes, is no longer referenced. Thread safe
+    void Discard(uint64_t location, uint32_t len);
+
+    /// a sealed segment holding at least @param dead_percent % of dead bytes, the most garbage first. Return false if
+    /// none needs to be compacted
+    bool PickCompaction(int dead_percent, uint32_t &segment);
+
+    /// delete the sealed @param segment if none of its records is referenced anymore
+    void DropDeadSegment(uint32_t segment);
+
+    static uint32_t SegmentOf(uint64_t location) { return static_cast<uint32_t>(location >> VLOG_OFFSET_BITS); }
+
+    /// bytes of all the segments on disk
+    size_t DiskBytes() const;
+
+    /// bytes of the records still referenced by a stub
+    size_t LiveBytes() const;
+
+    size_t Segments() const;
+
+    /// number of records read back since the start
+    size_t Reads() const { return reads_.load(std::memory_order_relaxed); }
+
+private:
+    typedef struct Segment {
+        uint32_t id;
+        int fd = -1;
+        std::string path;
+        size_t size = 0;        /// bytes written, only grows while the segment is active
+        size_t live = 0;        /// bytes of the records still referenced
+        bool dropped = false;   /// the file is deleted when the last reference goes away
+
+        ~Segment();
+    } Segment;
+
+    ValueLog();
+
+    /// seal the active segment and start a new one, must hold m_
+    bool Rotate();
+
+    /// the segment of @param location, nullptr if it was dropped. Takes m_
+    std::shared_ptr<Segment> Find(uint64_t location) const;
+
+    static bool ReadRecord(const Segment &segment, uint64_t offset, uint32_t len, std::string_view key,
+                           int &encoding, std::string &payload);
+
+    void Run();
+
+    mutable std::mutex m_;      /// guards the segments and their counters
+    std::map<uint32_t, std::shared_ptr<Segment>> segments_;
+    std::shared_ptr<Segment> active_;
+    std::string dir_;
+    size_t segment_size_ = 0;
+    uint32_t next_id_ = 0;
+    std::atomic<bool> open_{false};
+    std::atomic<size_t> reads_{0};
+
+    /// the background reads and jobs
+    std::mutex jobs_m_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::thread worker_;
+};
+
+#endif //REDIS_CRAFT_VALUELOG_H
@@ -0,0 +1,122 @@
+//
+// Created by Manh Nguyen Viet on 9/15/25.
+//
+
+#include "Zmalloc.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <unistd.h>
+
+static std::atomic<size_t> used_memory{0};
+static std::atomic<size_t> peak_memory{0};
+
+size_t ZmallocUsedMemory() {
+    return used_memory.load(std::memory_order_relaxed);
+}
+
+size_t ZmallocPeakMemory() {
+    return peak_memory.load(std::memory_order_relaxed);
+}
+
+void ZmallocUpdatePeak() {
+    size_t used = ZmallocUsedMemory();
+    size_t peak = peak_memory.load(std::memory_order_relaxed);
+    while (used > peak && !peak_memory.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+    }
+}
+
+size_t ZmallocRss() {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+
+    /// second field: resident pages
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return (n == 2) ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+size_t ZmallocSize(const void *p) {
+    return p ? malloc_usable_size(const_cast<void *>(p)) : 0;
+}
+
+size_t ZmallocSizeFor(size_t size) {
+    /// glibc: chunks of 16 bytes granularity with an 8 bytes header, 32 bytes at least
+    size_t chunk = (size + sizeof(size_t) + 15) & ~static_cast<size_t>(15);
+    return ((chunk < 32) ? 32 : chunk) - sizeof(size_t);
+}
+
+static inline void *ZmallocCount(void *p) {
+    if (p) {
+        used_memory.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    }
+    return p;
+}
+
+static inline void ZfreeCount(void *p) {
+    if (p) {
+        used_memory.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+static void *ZmallocOrThrow(size_t size) {
+    if (size == 0)
+        size = 1;
+
+    while (true) {
+        void *p = std::malloc(size);
+        if (p)
+            return ZmallocCount(p);
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *operator new(size_t size) {
+    return ZmallocOrThrow(size);
+}
+
+void *operator new[](size_t size) {
+    return ZmallocOrThrow(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return ZmallocCount(std::malloc(size ? size : 1));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return ZmallocCount(std::malloc(size ? size : 1));
+}
+
+void operator delete(void *p) noexcept {
+    ZfreeCount(p);
+}
+
+void operator delete[](void *p) noexcept {
+    ZfreeCount(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    ZfreeCount(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    ZfreeCount(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    ZfreeCount(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    ZfreeCount(p);
+}
@@ -0,0 +1,40 @@
+//
+// Created by Manh Nguyen Viet on 9/15/25.
+//
+
+#ifndef REDIS_CRAFT_ZMALLOC_H
+#define REDIS_CRAFT_ZMALLOC_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Memory accounting of the process. The global operator new / delete are replaced to add and subtract the usable
+ * size of every block, so the count includes the allocator rounding, as used_memory of Redis does.
+ * */
+
+/// bytes currently allocated through operator new
+size_t ZmallocUsedMemory();
+
+/// highest ZmallocUsedMemory() seen by ZmallocUpdatePeak(), which the server cron calls
+size_t ZmallocPeakMemory();
+
+void ZmallocUpdatePeak();
+
+/// resident set size of the process in bytes, 0 if unknown
+size_t ZmallocRss();
+
+/// usable size of the block @param p, allocated through operator new
+size_t ZmallocSize(const void *p);
+
+/// usable size the allocator gives to a request of @param size bytes, to estimate the blocks of the containers whose
+/// allocations are not reachable (nodes of std::map, std::list, ...)
+size_t ZmallocSizeFor(size_t size);
+
+/// heap bytes of @param s, 0 while it fits in its inline buffer
+inline size_t ZmallocStringSize(const std::string &s) {
+    static const size_t inline_capacity = std::string().capacity();
+    return (s.capacity() > inline_capacity) ? ZmallocSize(s.data()) : 0;
+}
+
+#endif //REDIS_CRAFT_ZMALLOC_H